@@ -25,6 +25,7 @@
 #include "debug.h"
 #include "buffer.h"
 #include "session.h"
+#include "regexp.h"
 
 #define dbg()    yzDebug("YZAction")
 #define err()    yzError("YZAction")
@@ -366,19 +367,11 @@ YCursor YZAction::match( YView* pView, const YCursor cursor, bool *found ) const
 //mBegin is always the beginning of the search so if reverseSearch is true , we have mEnd < mBegin ;)
 // which makes reverseSearch redundant.  It's now calculated within the function based on a test of mEnd < mBegin
 
-YCursor YZAction::search( YBuffer* pBuffer, const QString& _what, const YCursor mBegin, const YCursor mEnd, int *matchlength, bool *found ) const
+YCursor YZAction::search( YBuffer* pBuffer, const QString& what, const YCursor mBegin, const YCursor mEnd, int *matchlength, bool *found ) const
 {
-    // dbg() << " Searching " << _what << " from " << mBegin << " to " << mEnd << " Reverse : " << reverseSearch << endl;
+    // dbg() << " Searching " << what << " from " << mBegin << " to " << mEnd << " Reverse : " << reverseSearch << endl;
     bool reverseSearch = mEnd < mBegin;
-    bool cs = true;
-    QString what = _what;
-    if ( what.endsWith("\\c") ) {
-        what.truncate(what.length() - 2);
-        cs = false;
-    }
-    // dbg() << " Casesensitive: " << cs << endl;
-    QRegExp ex( what );
-    ex.setCaseSensitivity(cs ? Qt::CaseSensitive : Qt::CaseInsensitive );
+    YRegExp ex( what, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
 
     int currentMatchLine;
     int currentMatchColumn;
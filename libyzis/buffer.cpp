@@ -34,8 +34,11 @@
 #include "luaengine.h"
 #include "resourcemgr.h"
 #include "search.h"
+#include "regexp.h"
+#include "vimregexp.h"
 #include "mark.h"
 #include "yzisinfo.h"
+#include "folding.h"
 
 #include "kate/syntaxhighlight.h"
 
@@ -45,6 +48,9 @@
 
 /* Qt */
 #include <QTextCodec>
+#include <QThread>
+#include <QMutex>
+#include <QCoreApplication>
 
 #define dbg()    yzDebug("YBuffer")
 #define err()    yzError("YBuffer")
@@ -67,6 +73,134 @@
 
 static QString Null = QString();
 
+/* number of lines given to each background highlighting job */
+#define HL_JOB_LINES 2048
+/* delay between two checks of the background highlighting job */
+#define HL_POLL_MSEC 10
+/* on buffers of this size, the highlighting of the lines which are not
+ * displayed is dropped to save memory... */
+#define HL_DROP_MIN_LINES 20000
+/* ...except for the lines just before the displayed ones... */
+#define HL_DROP_MARGIN 256
+/* ...and one line out of HL_CHECKPOINT_LINES keeps its context, the lines
+ * after it can be highlighted again from there */
+#define HL_CHECKPOINT_LINES 64
+/* bytes read at the beginning of a file to detect its highlighting */
+#define HL_DETECT_SAMPLE_SIZE 16384
+
+/*
+ * Background highlighting of a buffer: the timer is run by the event loop,
+ * each timeout applies the lines highlighted by the current job and starts
+ * the next one.
+ */
+class YBufferHlTimer : public QObject
+{
+public:
+    YBufferHlTimer( YBuffer* buffer ) : mBuffer(buffer), mTimer(0)
+    {}
+
+    void start()
+    {
+        if ( mTimer == 0 && QCoreApplication::instance() )
+            mTimer = startTimer( HL_POLL_MSEC );
+    }
+    void stop()
+    {
+        if ( mTimer != 0 ) {
+            killTimer( mTimer );
+            mTimer = 0;
+        }
+    }
+
+protected:
+    virtual void timerEvent( QTimerEvent* )
+    {
+        // a long operation is changing the buffer, wait for its end
+        if ( YSession::self()->isProcessingEvents() )
+            return;
+        if ( !mBuffer->highlightSlice() )
+            stop();
+    }
+
+private:
+    YBuffer* mBuffer;
+    int mTimer;
+};
+
+/**
+ * Highlights a chunk of lines in its own thread.
+ * It works on a copy of their text and of the context they start in, the
+ * results are kept in its own lines: the buffer itself is never accessed.
+ * The buffer only applies the results if it was not modified meanwhile,
+ * which it knows from its highlighting version.
+ */
+class YBufferHlJob : public QThread
+{
+public:
+    YBufferHlJob( YzisHighlighting* highlight, int first, const YLine* prev, const QVector<QString>& lines, int version )
+            : mHighlight(highlight), mFirst(first), mLines(lines), mVersion(version), mCancelled(false)
+    {
+        if ( prev ) {
+            mPrev.setContext( prev->ctxArray() );
+            mPrev.setHlLineContinue( prev->hlLineContinue() );
+        }
+    }
+    virtual ~YBufferHlJob()
+    {
+        foreach( YLine* l, mResults )
+            delete l;
+    }
+
+    virtual void run()
+    {
+        YLine* prev = &mPrev;
+        for ( int i = 0; i < mLines.count() && !isCancelled(); ++i ) {
+            YLine* l = new YLine( mLines[ i ] );
+            QVector<uint> foldingList;
+            mHighlight->doHighlight( prev, l, &foldingList, NULL );
+            mResults.append( l );
+            prev = l;
+        }
+    }
+
+    /* the results will be dropped, stop as soon as possible */
+    void cancel()
+    {
+        QMutexLocker locker(&mMutex);
+        mCancelled = true;
+    }
+
+    bool isCancelled()
+    {
+        QMutexLocker locker(&mMutex);
+        return mCancelled;
+    }
+
+    int first() const
+    {
+        return mFirst;
+    }
+    int version() const
+    {
+        return mVersion;
+    }
+    /* the highlighted copies of the lines, only once the job is finished */
+    const QVector<YLine*>& results() const
+    {
+        return mResults;
+    }
+
+private:
+    YzisHighlighting* mHighlight;
+    int mFirst;
+    YLine mPrev;
+    QVector<QString> mLines;
+    int mVersion;
+    QMutex mMutex;
+    bool mCancelled;
+    QVector<YLine*> mResults;
+};
+
 struct YBuffer::Private
 {
     Private()
@@ -96,6 +230,18 @@ struct YBuffer::Private
     // flag to disable drawing of updates
     mutable bool isHLUpdating;
 
+    // the lines before this one are highlighted, the other ones are
+    // highlighted when they are displayed or in the background
+    int hlValidLine;
+    YBufferHlTimer* hlTimer;
+    // background highlighting job, if any. Its results are only valid
+    // for the version of the buffer it was started with: the version is
+    // increased by any change of the text or of the highlighted lines
+    YBufferHlJob* hlJob;
+    int hlVersion;
+    // the highlighting was detected from this path
+    QString hlDetectedPath;
+
     // pointers to sub-objects
     YZAction* action;
     YViewMarker* viewMarks;
@@ -123,8 +269,12 @@ YBuffer::YBuffer()
     d->isHLUpdating = false;
     d->isFileNew = true;
     d->isLoading = false;
+    d->hlValidLine = 0;
+    d->hlVersion = 0;
 
     // sub-objects
+    d->hlTimer = new YBufferHlTimer( this );
+    d->hlJob = NULL;
     d->highlight = NULL;
     d->undoBuffer = NULL;
     d->action = NULL;
@@ -148,6 +298,7 @@ YBuffer::~YBuffer()
     // These two aren't deleted when the buffer is made BufferInactive
     delete d->docMarks;
     delete d->viewMarks;
+    delete d->hlTimer;
 }
 
 QString YBuffer::toString() const
@@ -275,7 +426,9 @@ YCursor YBuffer::insertRegion( const YCursor& begin, const YRawData& data )
 		d->swapFile->addToSwap(YBufferOperation::OpAddRegion, data, opInterval);
 	}
 
-	/* syntax highlighting update */
+	/* syntax highlighting update. Inserted at the start of a line, the
+	 * lines go before it: its text is moved to the last one */
+	shiftHL(begin.column() == 0 && !rdata.isEmpty() ? begin.line() : begin.line() + 1, ln - begin.line());
 	int el = begin.line();
 	int nl; // next line not affected by HL update
 	while( el <= ln ) {
@@ -327,6 +480,10 @@ void YBuffer::deleteRegion( const YInterval& bi )
 	rdata = textline(end.line()).mid(end.column());
 	l->setData(ldata + rdata);
 
+	/* when nothing is kept of the first line, the lines deleted are the
+	 * ones above the last, whose end is moved up */
+	bool firstDeleted = begin.column() == 0 && end.line() < lineCount();
+
 	/* delete ylines */
 	int ln = begin.line() + 1;
 	int n = end.line() - begin.line();
@@ -342,6 +499,7 @@ void YBuffer::deleteRegion( const YInterval& bi )
 	}
 
 	/* syntax highlighting update */
+	shiftHL(firstDeleted ? begin.line() : begin.line() + 1, begin.line() - end.line());
 	ln = updateHL(begin.line());
 	if ( ln > begin.line() ) {
 		--ln;
@@ -373,6 +531,249 @@ YCursor YBuffer::replaceRegion( const YInterval& bi, const YRawData& data )
 	return insertRegion(begin, data);
 }
 
+void YBuffer::replaceLines( int fromLine, int toLine, const YRawData& lines )
+{
+	YASSERT(fromLine <= toLine + 1 && toLine < lineCount());
+	int nOld = toLine - fromLine + 1;
+	int nNew = lines.count();
+
+	/* the buffer keeps an empty line: removing all the lines is replacing
+	 * them by that line, so that undo and redo find it in the operation */
+	if ( nNew == 0 && nOld == lineCount() ) {
+		replaceLines(fromLine, toLine, YRawData() << QString());
+		return;
+	}
+
+	/* nothing to undo nor to save when the lines are the same */
+	if ( nNew == nOld ) {
+		int i = 0;
+		while ( i < nNew && textline(fromLine + i) == lines[i] ) {
+			++i;
+		}
+		if ( i == nNew ) {
+			return;
+		}
+	}
+
+	if ( !d->isLoading ) {
+		YRawData replacedText;
+		for ( int i = fromLine; i <= toLine; ++i ) {
+			replacedText << textline(i);
+		}
+		YInterval opInterval(YCursor(0,fromLine), YBound(YCursor(0,toLine+1), true));
+		d->undoBuffer->addBufferOperation(YBufferOperation::OpReplaceLines, lines, opInterval, replacedText);
+		d->swapFile->addToSwap(YBufferOperation::OpReplaceLines, lines, opInterval);
+	}
+
+	/* lines present on both sides are updated in place, so that unchanged
+	 * lines keep their highlighting */
+	QList<int> changedLines;
+	int common = qMin(nOld, nNew);
+	int i;
+	for ( i = 0; i < common; ++i ) {
+		YLine* l = yzline(fromLine + i);
+		if ( l->data() != lines[i] ) {
+			l->setData(lines[i]);
+			changedLines << fromLine + i;
+		}
+	}
+	if ( nNew > nOld ) {
+		d->text->insert(fromLine + common, nNew - nOld, NULL);
+		for ( ; i < nNew; ++i ) {
+			(*d->text)[fromLine + i] = new YLine(lines[i]);
+			changedLines << fromLine + i;
+		}
+	} else if ( nOld > nNew ) {
+		QVector<YLine*>::iterator it = d->text->begin() + fromLine + common;
+		for ( int n = nOld - nNew; n > 0; --n ) {
+			delete (*it);
+			it = d->text->erase(it);
+		}
+		if ( fromLine + common < lineCount() ) {
+			changedLines << fromLine + common;
+		}
+	}
+	shiftHL(fromLine + common, nNew - nOld);
+	updateLines(changedLines, nNew != nOld);
+}
+
+void YBuffer::reorderLines( int fromLine, int toLine, const QVector<int>& order )
+{
+	YASSERT(fromLine <= toLine && toLine < lineCount());
+	int nOld = toLine - fromLine + 1;
+	int nNew = order.count();
+	YASSERT(nNew <= nOld);
+
+	/* all the lines go, see replaceLines */
+	if ( nNew == 0 && nOld == lineCount() ) {
+		replaceLines(fromLine, toLine, YRawData() << QString());
+		return;
+	}
+
+	/* the lines stay where they are */
+	if ( nNew == nOld ) {
+		int i = 0;
+		while ( i < nNew && order[i] == i ) {
+			++i;
+		}
+		if ( i == nNew ) {
+			return;
+		}
+	}
+
+	if ( !d->isLoading ) {
+		YRawData replacedText;
+		YRawData newText;
+		for ( int i = fromLine; i <= toLine; ++i ) {
+			replacedText << textline(i);
+		}
+		foreach( int i, order ) {
+			newText << replacedText[i];
+		}
+		YInterval opInterval(YCursor(0,fromLine), YBound(YCursor(0,toLine+1), true));
+		d->undoBuffer->addBufferOperation(YBufferOperation::OpReplaceLines, newText, opInterval, replacedText);
+		d->swapFile->addToSwap(YBufferOperation::OpReplaceLines, newText, opInterval);
+	}
+
+	/* the YLine objects are moved, the lines left out are deleted */
+	QVector<YLine*> moved(nNew);
+	QVector<bool> kept(nOld, false);
+	for ( int i = 0; i < nNew; ++i ) {
+		moved[i] = d->text->at(fromLine + order[i]);
+		kept[order[i]] = true;
+	}
+	for ( int i = 0; i < nOld; ++i ) {
+		if ( !kept[i] ) {
+			delete d->text->at(fromLine + i);
+		}
+	}
+
+	QList<int> changedLines;
+	for ( int i = 0; i < nNew; ++i ) {
+		if ( d->text->at(fromLine + i) != moved[i] ) {
+			(*d->text)[fromLine + i] = moved[i];
+			changedLines << fromLine + i;
+		}
+	}
+	if ( nOld > nNew ) {
+		d->text->remove(fromLine + nNew, nOld - nNew);
+		if ( fromLine + nNew < lineCount() ) {
+			changedLines << fromLine + nNew;
+		}
+	}
+	shiftHL(fromLine + nNew, nNew - nOld);
+
+	updateLines(changedLines, nNew != nOld);
+}
+
+void YBuffer::deleteMarkedLines( int fromLine, int toLine )
+{
+	YASSERT(fromLine <= toLine && toLine < lineCount());
+
+	/* the runs of marked lines, from the last one up */
+	QList<int> runs;
+	for ( int i = toLine; i >= fromLine; --i ) {
+		if ( !yzline(i)->isMarked() ) {
+			continue;
+		}
+		int last = i;
+		while ( i > fromLine && yzline(i - 1)->isMarked() ) {
+			--i;
+		}
+		runs << i << last;
+	}
+	if ( runs.isEmpty() ) {
+		return;
+	}
+
+	/* one operation from the first marked line to the last one, the lines
+	 * kept between the runs are its new text */
+	if ( !d->isLoading ) {
+		int first = runs[runs.count() - 2];
+		int last = runs[1];
+		YRawData replacedText;
+		YRawData newText;
+		for ( int l = first; l <= last; ++l ) {
+			replacedText << textline(l);
+			if ( !yzline(l)->isMarked() ) {
+				newText << textline(l);
+			}
+		}
+		/* all the lines go, see replaceLines */
+		if ( newText.isEmpty() && replacedText.count() == lineCount() ) {
+			newText << QString();
+		}
+		YInterval opInterval(YCursor(0,first), YBound(YCursor(0,last+1), true));
+		d->undoBuffer->addBufferOperation(YBufferOperation::OpReplaceLines, newText, opInterval, replacedText);
+		d->swapFile->addToSwap(YBufferOperation::OpReplaceLines, newText, opInterval);
+	}
+
+	/* the kept YLine objects move up in one pass */
+	int to = fromLine;
+	for ( int i = fromLine; i <= toLine; ++i ) {
+		YLine* l = d->text->at(i);
+		if ( l->isMarked() ) {
+			delete l;
+		} else {
+			(*d->text)[to++] = l;
+		}
+	}
+	d->text->remove(to, toLine + 1 - to);
+	if ( lineCount() == 0 ) {
+		d->text->append(new YLine());
+	}
+
+	for ( int r = 0; r < runs.count(); r += 2 ) {
+		shiftHL(runs[r], runs[r] - runs[r + 1] - 1);
+	}
+
+	/* the first line after each run, where it is now, or the last line
+	 * if the run went to the end */
+	QList<int> changedLines;
+	int removed = 0;
+	for ( int r = runs.count() - 2; r >= 0; r -= 2 ) {
+		int line = qMin(runs[r] - removed, lineCount() - 1);
+		if ( changedLines.isEmpty() || changedLines.last() != line ) {
+			changedLines << line;
+		}
+		removed += runs[r + 1] - runs[r] + 1;
+	}
+	updateLines(changedLines, true);
+}
+
+void YBuffer::updateLines( const QList<int>& changedLines, bool shifted )
+{
+	if ( changedLines.isEmpty() ) {
+		return;
+	}
+
+	/* one paint for the whole batch */
+	foreach( YView* v, views() ) {
+		v->setPaintAutoCommit(false);
+	}
+
+	/* syntax highlighting update, each line is highlighted at most once */
+	int el = changedLines.first();
+	foreach( int line, changedLines ) {
+		if ( line >= el ) {
+			el = qMax(updateHL(line), line + 1);
+		}
+	}
+
+	YInterval bi(YCursor(0,changedLines.first()), YBound(YCursor(0,qMax(el, changedLines.last() + 1)), true));
+	if ( shifted ) {
+		bi.setToPos(YCursor(0,lineCount()));
+	}
+
+	/* inform views */
+	foreach( YView* v, views() ) {
+		v->updateBufferInterval(bi);
+		v->commitPaintEvent();
+	}
+
+	setChanged( true );
+}
+
 YRawData YBuffer::dataRegion( const YInterval& bi ) const
 {
 	YRawData d;
@@ -567,13 +968,12 @@ void YBuffer::load(const QString& file)
 
     QFile fl( d->path );
 
-    //HL mode selection
-    detectHighLight();
-
     //opens and eventually create the file
     d->undoBuffer->setInsideUndo( true );
     d->currentEncoding = getLocalStringOption( "encoding" );
     if ( QFile::exists(d->path) && fl.open( QIODevice::ReadOnly ) ) {
+        //HL mode selection, the beginning of the file helps when its name is not enough
+        detectHighLight( fl.peek( HL_DETECT_SAMPLE_SIZE ) );
         QTextCodec* codec;
         if ( d->currentEncoding == "locale" ) {
             codec = QTextCodec::codecForLocale();
@@ -599,8 +999,10 @@ void YBuffer::load(const QString& file)
 		}
 		insertRegion(YCursor(0,0), data);
         fl.close();
-    } else if (QFile::exists(d->path)) {
-        YSession::self()->guiPopupMessage(_("Failed opening file %1 for reading : %2").arg(d->path).arg(fl.errorString()));
+    } else {
+        detectHighLight();
+        if (QFile::exists(d->path))
+            YSession::self()->guiPopupMessage(_("Failed opening file %1 for reading : %2").arg(d->path).arg(fl.errorString()));
     }
     setChanged( false );
     //check for a swap file left after a crash
@@ -621,6 +1023,8 @@ void YBuffer::load(const QString& file)
     // d->swapFile->init(); // whatever happened before, create a new swapfile
     d->isLoading = false;
     d->undoBuffer->setInsideUndo( false );
+    // the views highlight what they show, the rest is done in the background
+    d->hlTimer->start();
     //reenable
     d->enableUpdateView = true;
     updateAllViews();
@@ -685,9 +1089,12 @@ bool YBuffer::save()
 
     saveYzisInfo( firstView() );
 
-    int hlMode = YzisHlManager::self()->detectHighlighting (this);
-    if ( hlMode >= 0 && d->highlight != YzisHlManager::self()->getHl( hlMode ) )
-        setHighLight( hlMode );
+    if ( d->path != d->hlDetectedPath ) {
+        d->hlDetectedPath = d->path;
+        int hlMode = YzisHlManager::self()->detectHighlighting (this);
+        if ( hlMode >= 0 && d->highlight != YzisHlManager::self()->getHl( hlMode ) )
+            setHighLight( hlMode );
+    }
     return true;
 }
 
@@ -793,6 +1200,7 @@ void YBuffer::setHighLight( int mode, bool warnGUI )
     YzisHighlighting *h = YzisHlManager::self()->getHl( mode );
 
     if ( h != d->highlight ) { //HL is changing
+        cancelHLJob();
         if ( d->highlight != 0L )
             d->highlight->release(); //free memory
 
@@ -801,6 +1209,7 @@ void YBuffer::setHighLight( int mode, bool warnGUI )
 
         d->highlight = h;
 
+        resetHL();
         makeAttribs();
         if ( warnGUI )
             highlightingChanged();
@@ -831,21 +1240,22 @@ void YBuffer::makeAttribs()
 {
     d->highlight->clearAttributeArrays();
 
-    bool ctxChanged = true;
-    int hlLine = 0;
-    if ( !d->isLoading ) {
-        while ( hlLine < lineCount()) {
-            QVector<uint> foldingList;
-            YLine *l = new YLine();
-            d->highlight->doHighlight( ( hlLine >= 1 ? yzline( hlLine - 1 ) : l), yzline( hlLine ), &foldingList, &ctxChanged );
-            delete l;
-            hlLine++;
-        }
-	} else {
-		dbg() << "makeAttribs aborted because YBuffer marked as loading" << endl;
-	}
-    updateAllViews();
+    /* the lines store attribute numbers, the views look them up again in
+     * the new arrays when they paint */
+    foreach( YView *view, d->views )
+        view->highlightAttributesChanged();
+}
+
+void YBuffer::resetHL()
+{
+    invalidateHLJob();
+    foldMarkersChanged( 0 );
 
+    /* nothing is highlighted now: the views highlight what they draw,
+     * the rest is done in the background */
+    d->hlValidLine = 0;
+    d->hlTimer->start();
+    updateAllViews();
 }
 
 void YBuffer::setPath( const QString& _path )
@@ -866,39 +1276,225 @@ void YBuffer::setPath( const QString& _path )
     filenameChanged();
 }
 
-bool YBuffer::substitute( const QString& _what, const QString& with, bool wholeline, int line )
+/*
+ * Applies the substitution on @arg l, returns true if it was changed
+ */
+static bool substituteLine( const YRegExp& rx, const QString& with, bool wholeline, QString* l )
 {
-    QString l = textline(line);
-    bool cs = true;
-    QString what = _what;
-    if ( what.endsWith("\\c") ) {
-        what.truncate(what.length() - 2);
-        cs = false;
-    }
-    QRegExp rx( what );
-    rx.setCaseSensitivity(cs ? Qt::CaseSensitive : Qt::CaseInsensitive );
     bool changed = false;
     int pos = 0;
     int offset = 0;
-    while ( (pos = rx.indexIn(l, offset) ) != -1 ) {
-		int matched_length = rx.matchedLength();
-		// extract matching part
-		QString matching = l.mid(pos, matched_length);
-		// apply substitution
-		matching = matching.replace(rx, with);
-
-		// replace part
-		l = l.replace(pos, matched_length, matching);
-		offset = pos + matching.length();
-		changed = true;
+    while ( offset <= l->length() && (pos = rx.indexIn(*l, offset) ) != -1 ) {
+        int matched_length = rx.matchedLength();
+        // apply substitution
+        QString matching = rx.expand(with);
+
+        // replace part
+        l->replace(pos, matched_length, matching);
+        offset = pos + matching.length();
+        if ( matched_length == 0 ) ++offset;
+        changed = true;
 
         if ( !wholeline ) break;
     }
-    if ( changed ) {
-        setTextline( line, l );
-        return true;
+    return changed;
+}
+
+/* under this number of lines, substitutions are not worth a thread */
+#define SUBSTITUTE_MIN_LINES_PER_JOB 20000
+/* the jobs report their progress every this number of lines */
+#define SUBSTITUTE_PROGRESS_LINES 256
+/* without jobs, the gui is refreshed every this number of lines */
+#define SUBSTITUTE_SLICE_LINES 4096
+
+/*
+ * Progress and cancellation shared by the substitution jobs and the
+ * thread waiting for them.
+ */
+class YSubstituteProgress
+{
+public:
+    YSubstituteProgress() : mCancelled(false), mDone(0)
+    {}
+
+    /* adds @arg lines to the lines done, false if the jobs must stop */
+    bool advance( int lines )
+    {
+        QMutexLocker locker(&mMutex);
+        mDone += lines;
+        return !mCancelled;
+    }
+
+    void cancel()
+    {
+        QMutexLocker locker(&mMutex);
+        mCancelled = true;
+    }
+
+    bool isCancelled()
+    {
+        QMutexLocker locker(&mMutex);
+        return mCancelled;
+    }
+
+    /* lines done so far by all the jobs */
+    int done()
+    {
+        QMutexLocker locker(&mMutex);
+        return mDone;
+    }
+
+private:
+    QMutex mMutex;
+    bool mCancelled;
+    int mDone;
+};
+
+/*
+ * Applies the substitution on the lines @arg first to @arg last (excluded)
+ * of @arg lines. Null lines are skipped, and the lines which didn't change
+ * become null.
+ */
+static void substituteLines( const YRegExp& rx, const QString& with, bool wholeline, QVector<QString>* lines, int first, int last, YSubstituteProgress* progress )
+{
+    int i;
+    for ( i = first; i < last; ++i ) {
+        QString& l = (*lines)[i];
+        if ( !l.isNull() && !substituteLine(rx, with, wholeline, &l) )
+            l = QString(); // unchanged
+        if ( (i - first + 1) % SUBSTITUTE_PROGRESS_LINES == 0 && !progress->advance(SUBSTITUTE_PROGRESS_LINES) )
+            return;
+    }
+    progress->advance((i - first) % SUBSTITUTE_PROGRESS_LINES);
+}
+
+/**
+ * Computes the substitutions of a chunk of lines in its own thread.
+ * It works on a copy of the lines (the QString are implicitly shared, so
+ * this is only a reference count) and on its own copy of the compiled
+ * regexp, the buffer itself is never accessed.
+ */
+class YSubstituteJob : public QThread
+{
+public:
+    YSubstituteJob( const YRegExp& rx, const QString& with, bool wholeline, const QVector<QString>& lines, YSubstituteProgress* progress )
+            : mRx(rx), mWith(with), mWholeline(wholeline), mLines(lines), mProgress(progress)
+    {}
+
+    virtual void run()
+    {
+        substituteLines(mRx, mWith, mWholeline, &mLines, 0, mLines.count(), mProgress);
+    }
+
+    /* the new lines, null for the lines which didn't change */
+    const QVector<QString>& lines() const
+    {
+        return mLines;
+    }
+
+private:
+    YRegExp mRx;
+    QString mWith;
+    bool mWholeline;
+    QVector<QString> mLines;
+    YSubstituteProgress* mProgress;
+};
+
+int YBuffer::substitute( const QString& what, const QString& with, bool wholeline, int fromLine, int toLine, bool markedOnly )
+{
+    YRegExp rx( what, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
+    // compiles it here, the jobs only get copies of the compiled program
+    if ( !rx.isValid() )
+        return -1;
+    // what ~ matches from now on, the pattern above used the previous one
+    YVimRegExp::setLastSubstitute( with );
+    toLine = qMin( toLine, lineCount() - 1 );
+    int nLines = toLine - fromLine + 1;
+    if ( nLines <= 0 )
+        return -1;
+
+    /* snapshot of the range, the lines to skip are null */
+    QVector<QString> result( nLines );
+    for ( int i = 0; i < nLines; ++i ) {
+        const YLine* yl = yzline( fromLine + i );
+        if ( markedOnly && !yl->isMarked() )
+            continue;
+        result[i] = yl->data().isNull() ? QString("") : yl->data();
+    }
+
+    YSubstituteProgress progress;
+    int nJobs = 1;
+#if QT_VERSION >= 0x040300
+    nJobs = qMin( QThread::idealThreadCount(), nLines / SUBSTITUTE_MIN_LINES_PER_JOB );
+#endif
+    if ( nJobs <= 1 ) {
+        /* in this thread, a slice at a time to show the progress and poll <C-c> */
+        for ( int first = 0; first < nLines && !progress.isCancelled(); first += SUBSTITUTE_SLICE_LINES ) {
+            substituteLines( rx, with, wholeline, &result, first, qMin(first + SUBSTITUTE_SLICE_LINES, nLines), &progress );
+            if ( first + SUBSTITUTE_SLICE_LINES >= nLines )
+                break;
+            foreach( YView* v, views() )
+                v->displayInfo( _("Substituting... %1%").arg(progress.done() * 100 / nLines) );
+            if ( YSession::self()->processPendingEvents() )
+                progress.cancel();
+        }
+    } else {
+        /* one chunk of the snapshot per job */
+        QList<YSubstituteJob*> jobs;
+        int chunk = (nLines + nJobs - 1) / nJobs;
+        for ( int first = 0; first < nLines; first += chunk ) {
+            QVector<QString> lines( qMin(chunk, nLines - first) );
+            for ( int i = 0; i < lines.count(); ++i )
+                lines[i] = result[first + i];
+            YSubstituteJob* job = new YSubstituteJob( rx, with, wholeline, lines, &progress );
+            jobs << job;
+            job->start();
+        }
+
+        /* wait for the jobs, showing the progress and polling <C-c> */
+        foreach( YSubstituteJob* job, jobs ) {
+            while ( !job->wait(100) ) {
+                foreach( YView* v, views() )
+                    v->displayInfo( _("Substituting... %1%").arg(progress.done() * 100 / nLines) );
+                if ( YSession::self()->processPendingEvents() )
+                    progress.cancel();
+            }
+        }
+        result.clear();
+        foreach( YSubstituteJob* job, jobs ) {
+            if ( !progress.isCancelled() )
+                result += job->lines();
+            delete job;
+        }
+    }
+    if ( progress.isCancelled() ) {
+        YSession::self()->resetInterrupt();
+        foreach( YView* v, views() )
+            v->displayInfo( _("Interrupted") );
+        return -1;
+    }
+
+    /* commit the changes in order, in one transaction */
+    YRawData newLines;
+    int firstLine = -1;
+    int lastLine = -1;
+    for ( int i = 0; i < nLines; ++i ) {
+        if ( result[i].isNull() )
+            continue;
+        int line = fromLine + i;
+        if ( firstLine == -1 ) {
+            firstLine = line;
+        } else {
+            /* keep the lines between two changes, replaceLines skips them */
+            for ( int j = lastLine + 1; j < line; ++j )
+                newLines << textline(j);
+        }
+        newLines << result[i];
+        lastLine = line;
     }
-    return false;
+    if ( firstLine != -1 )
+        replaceLines( firstLine, lastLine, newLines );
+    return lastLine;
 }
 
 QChar YBuffer::getCharAt( const YCursor at ) const
@@ -966,13 +1562,20 @@ QStringList YBuffer::getLocalListOption( const QString& option ) const
 int YBuffer::updateHL( int line )
 {
     // dbg() << "updateHL " << line << endl;
+    invalidateHLJob();
 
     int hlLine = line;
 	int nElines = 0;
-    if ( d->highlight != 0L ) {
+	/* the lines after the highlighted ones will be highlighted from the
+	 * right context anyway */
+    if ( d->highlight != 0L && line < d->hlValidLine ) {
 		bool ctxChanged = true;
 		bool hlChanged = false;
-		int maxLine = lineCount();
+		int maxLine = d->hlValidLine;
+
+		if ( line > 0 && yzline(line-1)->hlContextDropped() ) {
+			restoreHL(line-1);
+		}
 
 		YLine* yl = NULL;
 		YLine* last_yl = hlLine > 0 ? yzline(hlLine-1) : new YLine();
@@ -980,7 +1583,10 @@ int YBuffer::updateHL( int line )
 		for( ; ctxChanged && hlLine < maxLine; ++hlLine ) {
 			yl = yzline(hlLine);
 			QVector<uint> foldingList;
+			int foldEnds = yl->foldEnds(), foldStarts = yl->foldStarts();
 			d->highlight->doHighlight(last_yl, yl, &foldingList, &ctxChanged );
+			if ( yl->foldEnds() != foldEnds || yl->foldStarts() != foldStarts )
+				foldMarkersChanged( hlLine );
 			if ( hlLine == 0 )
 				delete last_yl;
 			last_yl = yl;
@@ -993,6 +1599,11 @@ int YBuffer::updateHL( int line )
 				nElines = 0;
 			}
 		}
+		if ( ctxChanged && hlLine == maxLine ) {
+			/* the change goes on after the highlighted lines, they are
+			 * invalid from here */
+			nElines = 0;
+		}
 
 		if ( hlChanged ) { // XXX: remove it when redesign will be done
 			int nToDraw = hlLine - line - nElines - 1;
@@ -1000,6 +1611,8 @@ int YBuffer::updateHL( int line )
 			foreach( YView *view, d->views )
 				view->updateBufferInterval(YInterval(YCursor(0,line), YBound(YCursor(0,line+nToDraw),true)));
 		}
+	} else {
+		hlLine = line + 1;
 	}
 	return hlLine - nElines;
 }
@@ -1009,21 +1622,158 @@ void YBuffer::initHL( int line )
     if ( d->isHLUpdating ) return ;
     // dbg() << "initHL " << line << endl;
     d->isHLUpdating = true;
-    if ( d->highlight != 0L ) {
-        int hlLine = line;
-        bool ctxChanged = true;
-        QVector<uint> foldingList;
-        YLine *l = new YLine();
-        d->highlight->doHighlight(( hlLine >= 1 ? yzline( hlLine - 1 ) : l), yzline( hlLine ), &foldingList, &ctxChanged );
-        delete l;
+    if ( line >= d->hlValidLine ) {
+        highlightUpTo( line );
+    } else if ( d->highlight != 0L ) {
+        restoreHL( line );
     }
     d->isHLUpdating = false;
 }
 
-void YBuffer::detectHighLight()
+void YBuffer::highlightUpTo( int line )
+{
+    if ( d->highlight == 0L )
+        return ;
+    line = qMin( line, lineCount() - 1 );
+    if ( d->hlValidLine > line )
+        return ;
+    if ( d->hlValidLine > 0 && yzline( d->hlValidLine - 1 )->hlContextDropped() )
+        restoreHL( d->hlValidLine - 1 );
+
+    bool drop = lineCount() >= HL_DROP_MIN_LINES;
+    int start = d->hlValidLine;
+    /* the first line is highlighted from the empty context */
+    YLine *l = new YLine();
+    bool ctxChanged = true;
+    for ( ; d->hlValidLine <= line; ++d->hlValidLine ) {
+        QVector<uint> foldingList;
+        int hlLine = d->hlValidLine;
+        YLine* yl = yzline( hlLine );
+        int foldEnds = yl->foldEnds(), foldStarts = yl->foldStarts();
+        d->highlight->doHighlight(( hlLine >= 1 ? yzline( hlLine - 1 ) : l), yl, &foldingList, &ctxChanged );
+        if ( yl->foldEnds() != foldEnds || yl->foldStarts() != foldStarts )
+            foldMarkersChanged( hlLine );
+        /* the previous line is not needed anymore */
+        if ( drop && hlLine > start && hlLine - 1 < line - HL_DROP_MARGIN ) {
+            yzline( hlLine - 1 )->dropHighlighting( hlLine % HL_CHECKPOINT_LINES == 0 );
+        }
+    }
+    delete l;
+}
+
+void YBuffer::restoreHL( int line )
+{
+    /* goes back to the last line which kept its context, there is one
+     * every HL_CHECKPOINT_LINES lines */
+    int start = line;
+    while ( start > 0 && yzline( start - 1 )->hlContextDropped() )
+        --start;
+    YLine *l = new YLine();
+    for ( int hlLine = start; hlLine <= line; ++hlLine ) {
+        QVector<uint> foldingList;
+        d->highlight->doHighlight(( hlLine >= 1 ? yzline( hlLine - 1 ) : l), yzline( hlLine ), &foldingList, NULL );
+    }
+    delete l;
+}
+
+bool YBuffer::highlightSlice()
+{
+    if ( d->highlight == 0L || d->text == NULL || d->isLoading || d->isHLUpdating )
+        return false;
+    if ( d->hlJob ) {
+        if ( !d->hlJob->isFinished() )
+            return true;
+        applyHLJob();
+    }
+    if ( d->hlValidLine >= lineCount() )
+        return false;
+
+    if ( d->hlValidLine > 0 && yzline( d->hlValidLine - 1 )->hlContextDropped() )
+        restoreHL( d->hlValidLine - 1 );
+    int first = d->hlValidLine;
+    int last = qMin( first + HL_JOB_LINES, lineCount() );
+    QVector<QString> lines;
+    lines.reserve( last - first );
+    for ( int i = first; i < last; ++i )
+        lines.append( yzline( i )->data() );
+    d->hlJob = new YBufferHlJob( d->highlight, first, first > 0 ? yzline( first - 1 ) : NULL, lines, d->hlVersion );
+    d->hlJob->start( QThread::LowPriority );
+    return true;
+}
+
+void YBuffer::applyHLJob()
+{
+    YBufferHlJob* job = d->hlJob;
+    d->hlJob = NULL;
+    /* the lines may have been highlighted on demand meanwhile, the
+     * results are still right for the next ones */
+    int skip = d->hlValidLine - job->first();
+    const QVector<YLine*>& results = job->results();
+    if ( job->version() == d->hlVersion && skip >= 0 && skip < results.count() ) {
+        bool drop = lineCount() >= HL_DROP_MIN_LINES;
+        for ( int i = skip; i < results.count(); ++i, ++d->hlValidLine ) {
+            YLine* yl = yzline( d->hlValidLine );
+            if ( yl->foldEnds() != results[ i ]->foldEnds() || yl->foldStarts() != results[ i ]->foldStarts() )
+                foldMarkersChanged( d->hlValidLine );
+            yl->setHighlighting( *results[ i ] );
+            /* nobody displays these lines, only the last one is kept */
+            if ( drop && i < results.count() - 1 )
+                yl->dropHighlighting( (d->hlValidLine + 1) % HL_CHECKPOINT_LINES == 0 );
+        }
+    } else {
+        dbg() << "applyHLJob(): the buffer changed, results dropped" << endl;
+    }
+    delete job;
+}
+
+void YBuffer::invalidateHLJob()
+{
+    ++d->hlVersion;
+    if ( d->hlJob )
+        d->hlJob->cancel();
+}
+
+void YBuffer::cancelHLJob()
+{
+    if ( d->hlJob ) {
+        d->hlJob->cancel();
+        d->hlJob->wait();
+        delete d->hlJob;
+        d->hlJob = NULL;
+    }
+}
+
+void YBuffer::foldMarkersChanged( int line )
+{
+    foreach( YView *view, d->views )
+        view->folds()->syntaxChanged( line );
+}
+
+void YBuffer::shiftHL( int line, int delta )
+{
+    invalidateHLJob();
+    /* the folds below move */
+    foreach( YView *view, d->views )
+        view->folds()->shift( line, delta );
+    if ( line >= d->hlValidLine || delta == 0 )
+        return ;
+    if ( delta > 0 ) {
+        /* the new lines are highlighted by the caller, through updateHL */
+        d->hlValidLine += delta;
+    } else if ( line - delta <= d->hlValidLine ) {
+        d->hlValidLine += delta;
+    } else {
+        d->hlValidLine = line;
+    }
+    if ( d->hlValidLine < lineCount() )
+        d->hlTimer->start();
+}
+
+void YBuffer::detectHighLight( const QByteArray& sample )
 {
     dbg() << "detectHighLight()" << endl;
-    int hlMode = YzisHlManager::self()->detectHighlighting (this);
+    d->hlDetectedPath = d->path;
+    int hlMode = YzisHlManager::self()->detectHighlighting (this, sample);
     if ( hlMode >= 0 ) {
         setHighLight( hlMode );
     }
@@ -1061,7 +1811,7 @@ YLine * YBuffer::yzline(int line, bool noHL /*= true*/)
     // explicit, so we don't end up with infinite recursion
     const YBuffer *const_this = this;
     YLine *yl = const_cast<YLine*>( const_this->yzline( line ) );
-    if ( !noHL && yl && !yl->initialized() ) {
+    if ( !noHL && yl && (line >= d->hlValidLine || yl->hlDropped()) ) {
         initHL( line );
     }
 
@@ -1164,6 +1914,10 @@ void YBuffer::setState( BufferState state )
         delete d->action;
         d->action = NULL;
 
+        d->hlTimer->stop();
+        cancelHLJob();
+        d->hlValidLine = 0;
+
         if ( d->highlight ) {
             d->highlight->release();
         }
@@ -109,6 +109,34 @@ public:
 	 */
 	YCursor replaceRegion(const YInterval& bi, const YRawData& data);
 
+	/*
+	 * Replaces the lines @param fromLine to @param toLine by @param lines,
+	 * as a single operation: one undo operation, one swap record, one
+	 * highlighting pass starting at the first changed line and one paint.
+	 * @param lines : the new lines, without endline, may be shorter or
+	 * longer than the replaced range
+	 * toLine may be fromLine - 1 to insert lines before fromLine.
+	 * Removing all the lines replaces them by one empty line.
+	 */
+	void replaceLines(int fromLine, int toLine, const YRawData& lines);
+
+	/*
+	 * Reorders the lines @param fromLine to @param toLine, as a single
+	 * operation like replaceLines. The line objects are moved, their
+	 * text is neither copied nor reallocated.
+	 * @param order : the line which goes at fromLine + i is fromLine + order[i].
+	 * The lines missing from order are deleted.
+	 */
+	void reorderLines(int fromLine, int toLine, const QVector<int>& order);
+
+	/*
+	 * Deletes the marked lines (see YLine::setMarked) between @param fromLine
+	 * and @param toLine. The other lines are moved, not copied. It is one
+	 * undo operation and one swap record, from the first marked line to the
+	 * last one.
+	 */
+	void deleteMarkedLines(int fromLine, int toLine);
+
 	YRawData dataRegion( const YInterval& bi ) const;
 
 
@@ -164,7 +192,8 @@ public:
     /**
      * Finds the @ref YLine pointer for a line in the buffer
      * @param line the line to return
-     * @param noHL if set to false, the highlighting of the line is initialised XXX (need proof-reading)
+     * @param noHL if set to false, the line is highlighted if it was not yet,
+     * together with the lines before it which were not highlighted either
      * @return a YLine pointer or 0 if none
      *
      * Note: the valid line numbers are between 0 and lineCount()-1
@@ -173,11 +202,17 @@ public:
     const YLine * yzline(int line) const;
 
     /**
-     * Replaces the given regexp @arg what with the given string @arg with on the specified @arg line
-     * Repeat the change on the line if @arg wholeline is true
-     * @return true if a change was done
+     * Replaces the given regexp @arg what with the given string @arg with on the lines
+     * @arg fromLine to @arg toLine.
+     * Repeat the change on each line if @arg wholeline is true
+     * On large ranges the matching is split between several threads, and
+     * can be interrupted with <C-c> (the buffer is then left untouched).
+     * All the changes are applied at once by replaceLines.
+     * If @arg markedOnly is true, only the lines marked by :global are
+     * substituted (see YLine::isMarked).
+     * @return the last changed line, or -1 if nothing matched
      */
-    bool substitute( const QString& what, const QString& with, bool wholeline, int line );
+    int substitute( const QString& what, const QString& with, bool wholeline, int fromLine, int toLine, bool markedOnly = false );
 
     /**
      * Get the length of a line
@@ -409,16 +444,31 @@ public:
 
     void initHL( int line );
 
+    /**
+     * Applies the results of the background highlighting job once it is
+     * finished, and starts a job for the next lines which are not
+     * highlighted yet. The background highlighting calls it regularly.
+     * @returns true if some lines are still not highlighted
+     */
+    bool highlightSlice();
+
     /**
      * Notify GUIs that HL changed
      */
     virtual void highlightingChanged();
 
     /**
-     * Detects the correct syntax highlighting for the current file
+     * Detects the correct syntax highlighting for the current file, from
+     * its name or else from @arg sample, the beginning of the file (the
+     * first lines of the buffer by default)
      */
-    void detectHighLight();
+    void detectHighLight( const QByteArray& sample = QByteArray() );
 
+    /**
+     * Computes again the colors and fonts of the highlighting attributes,
+     * after a change of the schema or of a style (:highlight).
+     * The lines keep their highlighting, only the views are repainted.
+     */
     void makeAttribs();
 
     //-------------------------------------------------------
@@ -505,6 +555,63 @@ public:
     static YCursor getStartPosition( const QString& filename, bool parseFilename = true );
 
 protected:
+    /**
+     * Updates the search and syntax highlighting and the views after the
+     * @param changedLines (sorted) were modified by replaceLines, reorderLines or deleteMarkedLines.
+     * @param shifted is true if the lines after them were moved
+     */
+    void updateLines( const QList<int>& changedLines, bool shifted );
+
+    /**
+     * Highlights the lines which are not highlighted yet, up to @param line.
+     * On big buffers, only the last ones keep their highlighting, see
+     * YLine::dropHighlighting
+     */
+    void highlightUpTo( int line );
+
+    /**
+     * Highlights again the line @param line whose highlighting was dropped,
+     * from the nearest line above which kept its context
+     */
+    void restoreHL( int line );
+
+    /**
+     * Forgets the highlighting of all the lines, after a change of the
+     * highlighting mode: they are tokenized again as they are displayed
+     * and in the background
+     */
+    void resetHL();
+
+    /**
+     * Copies the lines highlighted by the finished background job to the
+     * buffer, unless the buffer changed since it was started
+     */
+    void applyHLJob();
+
+    /**
+     * The text or the highlighted lines changed: the results of the
+     * running background job, if any, will be dropped
+     */
+    void invalidateHLJob();
+
+    /**
+     * Stops the background job and waits for it, before the highlighting
+     * it uses goes away
+     */
+    void cancelHLJob();
+
+    /**
+     * Keeps track of the highlighted lines when @param delta lines are
+     * inserted (or -delta removed) at @param line
+     */
+    void shiftHL( int line, int delta );
+
+    /**
+     * The folding regions of the line @param line changed, the syntax
+     * folds of the views are made again from there
+     */
+    void foldMarkersChanged( int line );
+
     /**
      * Sets the line @param line to @param l
      * @param line is between 0 and lineCount()-1
@@ -78,6 +78,14 @@ int YDrawCell::step( const QString& data )
 	mSteps.append(data.length());
 	return data.length();
 }
+int YDrawCell::stepChars( const QString& data )
+{
+	mContent += data;
+	for ( int i = data.length(); i > 0; --i ) {
+		mSteps.append(1);
+	}
+	return data.length();
+}
 void YDrawCell::clear()
 {
 	mContent.clear();
@@ -47,6 +47,8 @@ public:
 	void clear();
 	
 	int step( const QString& data );
+	/* one step for each character of data */
+	int stepChars( const QString& data );
 
 	/* properties accessors */
 	inline bool hasSelection( yzis::SelectionType selType ) const { return mSelections & selType; }
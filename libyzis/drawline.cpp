@@ -71,6 +71,17 @@ void YDrawLine::setBackgroundColor( const YColor& c )
 	}
 }
 
+void YDrawLine::addSelection( yzis::SelectionType sel )
+{
+	mCur.addSelection(sel);
+	changed = true;
+}
+void YDrawLine::delSelection( yzis::SelectionType sel )
+{
+	mCur.delSelection(sel);
+	changed = true;
+}
+
 int YDrawLine::step( const QString& c )
 {
 	if ( changed ) {
@@ -80,6 +91,15 @@ int YDrawLine::step( const QString& c )
 	}
 	return mCell->step(c);
 }
+int YDrawLine::stepChars( const QString& run )
+{
+	if ( changed ) {
+		append(YDrawCell(mCur));
+		mCell =& (*this)[size()-1];
+		changed = false;
+	}
+	return mCell->stepChars(run);
+}
 void YDrawLine::flush()
 {
 	mWidth = 0;
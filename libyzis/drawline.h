@@ -39,11 +39,15 @@ public :
     void setFont( const YFont& f );
     void setColor( const YColor& c );
     void setBackgroundColor( const YColor& c );
+    void addSelection( yzis::SelectionType sel );
+    void delSelection( yzis::SelectionType sel );
 	// TODO: setOutline
 
 	void clear();
 
     int step( const QString& c );
+    /* steps each character of a run drawn with the same attributes */
+    int stepChars( const QString& run );
 	void flush();
 
 	YDrawSection arrange( int columns ) const;
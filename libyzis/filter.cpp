@@ -0,0 +1,122 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+/* Yzis */
+#include "filter.h"
+#include "session.h"
+#include "debug.h"
+
+/* Qt */
+#include <QProcess>
+#include <QTextCodec>
+
+#define dbg()    yzDebug("YFilter")
+#define err()    yzError("YFilter")
+
+/* size of the pieces of input handed to the command */
+#define FILTER_CHUNK_SIZE 65536
+
+YFilter::YFilter( const QString& command, QTextCodec* codec )
+        : mCommand(command), mCodec(codec), mExitCode(0)
+{}
+
+int YFilter::exitCode() const
+{
+    return mExitCode;
+}
+
+QString YFilter::errors() const
+{
+    return mErrors;
+}
+
+YFilter::Status YFilter::run( const QStringList& input, QStringList* output )
+{
+    QString shell = YSession::getStringOption( "shell" );
+    QStringList shellArgs;
+#ifdef YZIS_WIN32
+    shellArgs << "/c" << mCommand;
+#else
+    shellArgs << "-c" << mCommand;
+#endif
+    dbg() << "run(): " << shell << " " << shellArgs << ", " << input.count() << " lines" << endl;
+
+    QProcess process;
+    process.start( shell, shellArgs );
+    if ( !process.waitForStarted() ) {
+        err() << "run(): cannot start " << shell << ": " << process.errorString() << endl;
+        return FailedToStart;
+    }
+
+    QByteArray data;
+    if ( !input.isEmpty() )
+        data = mCodec->fromUnicode( input.join( "\n" ) + '\n' );
+    int written = 0;
+    if ( data.isEmpty() )
+        process.closeWriteChannel();
+
+    QByteArray result;
+    QByteArray errors;
+    while ( process.state() != QProcess::NotRunning ) {
+        /* only one chunk waits in the write buffer at a time. QProcess
+         * reads the output while it waits for the chunk to be written,
+         * so a command which writes before it has read all its input
+         * can't fill its stdout pipe and block us */
+        if ( written < data.size() && process.bytesToWrite() == 0 ) {
+            int n = qMin( FILTER_CHUNK_SIZE, data.size() - written );
+            process.write( data.constData() + written, n );
+            written += n;
+            if ( written == data.size() )
+                process.closeWriteChannel();
+        }
+        if ( process.bytesToWrite() > 0 )
+            process.waitForBytesWritten( 100 );
+        else
+            process.waitForReadyRead( 100 );
+        result += process.readAllStandardOutput();
+        errors += process.readAllStandardError();
+
+        if ( YSession::self()->processPendingEvents() ) {
+            dbg() << "run(): interrupted, killing the command" << endl;
+            process.kill();
+            process.waitForFinished();
+            YSession::self()->resetInterrupt();
+            return Interrupted;
+        }
+    }
+    result += process.readAllStandardOutput();
+    errors += process.readAllStandardError();
+    mExitCode = process.exitCode();
+    dbg() << "run(): exit code " << mExitCode << ", " << result.size() << " bytes of output, "
+          << errors.size() << " bytes of errors" << endl;
+
+    mErrors = mCodec->toUnicode( errors );
+    if ( mErrors.endsWith( '\n' ) )
+        mErrors.chop( 1 );
+
+    output->clear();
+    if ( !result.isEmpty() ) {
+        QString text = mCodec->toUnicode( result );
+        if ( text.endsWith( '\n' ) )
+            text.chop( 1 );
+        *output = text.split( '\n' );
+    }
+    return Finished;
+}
+
@@ -0,0 +1,81 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+#ifndef YZ_FILTER_H
+#define YZ_FILTER_H
+
+/* Qt */
+#include <QString>
+#include <QStringList>
+
+/* Yzis */
+#include "yzismacros.h"
+
+class QTextCodec;
+
+/**
+ * Runs lines through an external command, as done by :{range}!cmd
+ * (see :help :range!).
+ *
+ * The command is run by the shell of the "shell" option. The lines are
+ * written to its stdin by chunks while its stdout and stderr are read, so
+ * that no side can block on a full pipe. The session keeps processing its
+ * events while the command runs, <C-c> kills the command.
+ */
+class YZIS_EXPORT YFilter
+{
+public:
+    enum Status {
+        Finished, //!< the command ran, whatever its exit code
+        FailedToStart,
+        Interrupted, //!< the command was killed by <C-c>
+    };
+
+    /**
+     * @arg codec converts the lines to and from the bytes seen by the command
+     */
+    YFilter( const QString& command, QTextCodec* codec );
+
+    /**
+     * Runs the command with @arg input as stdin, its output is split
+     * in lines in @arg output. What it writes on stderr is kept apart,
+     * see errors().
+     * Without input, stdin is closed right away.
+     */
+    Status run( const QStringList& input, QStringList* output );
+
+    /**
+     * Exit code of the command once it has Finished
+     */
+    int exitCode() const;
+
+    /**
+     * What the command wrote on stderr
+     */
+    QString errors() const;
+
+private:
+    QString mCommand;
+    QTextCodec* mCodec;
+    int mExitCode;
+    QString mErrors;
+};
+
+#endif
+
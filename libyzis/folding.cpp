@@ -19,74 +19,298 @@
 
 #include "folding.h"
 #include "view.h"
+#include "buffer.h"
+#include "line.h"
 #include "debug.h"
 
+#include <QMap>
+
 #define dbg()    yzDebug("YZFoldPool")
 #define err()    yzError("YZFoldPool")
 
+YZFold::YZFold( int from, int to, bool opened, bool syntax )
+        : from(from), to(to), opened(opened), syntax(syntax), endsAbove(false)
+{}
+YZFold::~YZFold()
+{
+    qDeleteAll( children );
+}
+
+/*
+ * Index of the first fold ending on or after line. The folds of a level
+ * are disjoint, so they are sorted by their ends too
+ */
+static int firstEndingAfter( const QList<YZFold*>& folds, int line )
+{
+    int lo = 0;
+    int hi = folds.count();
+    while ( lo < hi ) {
+        int mid = ( lo + hi ) / 2;
+        if ( folds[ mid ]->to < line )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* the fold of this level which contains line, head included */
+static YZFold* foldAt( const QList<YZFold*>& folds, int line )
+{
+    int i = firstEndingAfter( folds, line );
+    if ( i < folds.count() && folds[ i ]->from <= line )
+        return folds[ i ];
+    return NULL;
+}
+
+static YZFold* innermostFold( const QList<YZFold*>& folds, int line )
+{
+    YZFold* inner = NULL;
+    YZFold* fold = foldAt( folds, line );
+    while ( fold != NULL && fold->from < line ) {
+        inner = fold;
+        fold = foldAt( fold->children, line );
+    }
+    return inner;
+}
+
+static YZFold* outermostClosedFold( const QList<YZFold*>& folds, int line )
+{
+    YZFold* fold = foldAt( folds, line );
+    while ( fold != NULL && fold->from < line ) {
+        if ( !fold->opened )
+            return fold;
+        fold = foldAt( fold->children, line );
+    }
+    return NULL;
+}
+
+static YZFold* outermostSyntaxFold( const QList<YZFold*>& folds, int line )
+{
+    YZFold* fold = foldAt( folds, line );
+    while ( fold != NULL && !fold->syntax )
+        fold = foldAt( fold->children, line );
+    return fold;
+}
+
+/* true if a syntax fold goes on after line */
+static bool syntaxFoldCrosses( const QList<YZFold*>& folds, int line )
+{
+    for ( YZFold* fold = foldAt( folds, line ); fold != NULL; fold = foldAt( fold->children, line ) ) {
+        if ( fold->syntax && fold->to > line )
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Puts fold in the tree, inside the folds containing it. The folds of
+ * its level which it overlaps become its children. Returns false if the
+ * same fold exists already
+ */
+static bool insertFold( QList<YZFold*>* folds, YZFold* fold )
+{
+    int i = firstEndingAfter( *folds, fold->from );
+    while ( i < folds->count() && folds->at( i )->from <= fold->from && folds->at( i )->to >= fold->to ) {
+        YZFold* parent = folds->at( i );
+        if ( parent->from == fold->from && parent->to == fold->to )
+            return false;
+        folds = &parent->children;
+        i = firstEndingAfter( *folds, fold->from );
+    }
+    int j = i;
+    while ( j < folds->count() && folds->at( j )->from <= fold->to )
+        ++j;
+    if ( j > i ) {
+        fold->from = qMin( fold->from, folds->at( i )->from );
+        fold->to = qMax( fold->to, folds->at( j - 1 )->to );
+        for ( int k = i; k < j; ++k )
+            fold->children.append( folds->takeAt( i ) );
+    }
+    folds->insert( i, fold );
+    return true;
+}
+
+/*
+ * Removes the syntax folds whose head is in [from, to], the manual folds
+ * inside them take their place. The states of the removed folds are
+ * kept in states
+ */
+static void removeSyntaxFolds( QList<YZFold*>* folds, int from, int to, QMap<int, bool>* states )
+{
+    int i = firstEndingAfter( *folds, from );
+    while ( i < folds->count() && folds->at( i )->from <= to ) {
+        YZFold* fold = folds->at( i );
+        removeSyntaxFolds( &fold->children, from, to, states );
+        if ( fold->syntax && fold->from >= from ) {
+            states->insert( fold->from, fold->opened );
+            folds->removeAt( i );
+            int n = fold->children.count();
+            for ( int k = 0; k < n; ++k )
+                folds->insert( i + k, fold->children[ k ] );
+            fold->children.clear();
+            delete fold;
+            i += n;
+        } else {
+            ++i;
+        }
+    }
+}
+
+static void setFoldsOpened( QList<YZFold*>* folds, int from, int to, bool opened, bool* changed )
+{
+    for ( int i = firstEndingAfter( *folds, from ); i < folds->count() && folds->at( i )->from <= to; ++i ) {
+        YZFold* fold = folds->at( i );
+        if ( fold->from >= from && fold->opened != opened ) {
+            fold->opened = opened;
+            *changed = true;
+        }
+        setFoldsOpened( &fold->children, from, to, opened, changed );
+    }
+}
+
+/*
+ * Where the first and the last line of a fold go when delta lines are
+ * inserted or deleted before line. The deleted lines go to their
+ * neighbours
+ */
+static int shiftedFrom( int x, int line, int delta )
+{
+    if ( x < line )
+        return x;
+    if ( delta < 0 && x < line - delta )
+        return line;
+    return x + delta;
+}
+static int shiftedTo( int x, int line, int delta )
+{
+    if ( x < line )
+        return x;
+    if ( delta < 0 && x < line - delta )
+        return line - 1;
+    return x + delta;
+}
+
+static void clampFolds( QList<YZFold*>* folds, int to )
+{
+    while ( !folds->isEmpty() && folds->last()->to > to ) {
+        YZFold* fold = folds->last();
+        fold->to = to;
+        if ( fold->to < fold->from ) {
+            folds->removeAt( folds->count() - 1 );
+            delete fold;
+        } else {
+            clampFolds( &fold->children, to );
+            break;
+        }
+    }
+}
+
+static void shiftFolds( QList<YZFold*>* folds, int line, int delta )
+{
+    /* a fold ending above line may be closed on it */
+    int i = firstEndingAfter( *folds, line - 1 );
+    while ( i < folds->count() ) {
+        YZFold* fold = folds->at( i );
+        shiftFolds( &fold->children, line, delta );
+        fold->from = shiftedFrom( fold->from, line, delta );
+        /* it follows the line where its region is closed */
+        int above = fold->endsAbove ? 1 : 0;
+        fold->to = shiftedTo( fold->to + above, line, delta ) - above;
+        if ( fold->to < fold->from ) {
+            /* all its lines are deleted */
+            folds->removeAt( i );
+            delete fold;
+        } else {
+            /* it lost the line where it was closed, the folds inside
+             * it must not go further */
+            clampFolds( &fold->children, fold->to );
+            ++i;
+        }
+    }
+}
+
 YZFoldPool::YZFoldPool( YView* view )
 {
     m_view = view;
+    m_syntax = false;
+    m_syntaxDirtyFrom = -1;
+    m_syntaxDirtyTo = -1;
 }
 YZFoldPool::~YZFoldPool()
-{}
+{
+    qDeleteAll( m_folds );
+}
 
 void YZFoldPool::create( int from, int to )
 {
     dbg() << "FOLDING: create from " << from << " to " << to << endl;
-    int head = from;
-    bool need_update = true;
-    if ( isHead( from ) || contains( from, &head ) ) {
-        if ( m_folds[ head ].to < to ) {
-            m_folds[ head ].to = to;
-        } else {
-            need_update = false;
-        }
-    } else {
-        YZFold fold;
-        fold.to = to;
-        fold.opened = false;
-        m_folds.insert( head, fold );
-    }
-    if ( need_update ) {
-        m_view->sendRefreshEvent();
+    updateSyntaxFolds();
+    YZFold* fold = new YZFold( from, to, false, false );
+    if ( !insertFold( &m_folds, fold ) ) {
+        delete fold;
+        return;
     }
+    m_view->sendRefreshEvent();
     dbg() << "" << *this;
 }
 
 bool YZFoldPool::isHead( int line ) const
 {
-    return m_folds.contains( line );
+    updateSyntaxFolds();
+    for ( YZFold* fold = foldAt( m_folds, line ); fold != NULL; fold = foldAt( fold->children, line ) ) {
+        if ( fold->from == line )
+            return true;
+    }
+    return false;
 }
 bool YZFoldPool::contains( int line, int* head ) const
 {
-    bool contains = false;
-    QList<int> keys = m_folds.keys();
-    if ( keys.size() > 0 ) {
-        int i;
-        for ( i = keys.size() - 1; !contains && i >= 0 && m_folds[ keys[ i ] ].to >= line; --i )
-            contains = ( keys[ i ] < line );
-        if ( contains && head != NULL )
-            *head = keys[ ++i ];
-    }
-    return contains;
+    updateSyntaxFolds();
+    YZFold* fold = innermostFold( m_folds, line );
+    if ( fold != NULL && head != NULL )
+        *head = fold->from;
+    return fold != NULL;
 }
 bool YZFoldPool::isFolded( int line, int* head ) const
 {
-    int fh;
-    bool ret = contains( line, &fh );
-    if ( head != NULL )
-        *head = fh;
-    return ret && !m_folds[ fh ].opened;
+    updateSyntaxFolds();
+    YZFold* fold = outermostClosedFold( m_folds, line );
+    if ( fold != NULL && head != NULL )
+        *head = fold->from;
+    return fold != NULL;
 }
 
-int YZFoldPool::lineAfterFold( int line ) const
+bool YZFoldPool::isInClosedFold( int line, int* from, int* to ) const
 {
-    int head;
-    if ( contains( line, &head ) ) {
-        if ( !m_folds[ head ].opened )
-            return m_folds[ head ].to + 1;
+    updateSyntaxFolds();
+    for ( YZFold* fold = foldAt( m_folds, line ); fold != NULL; fold = foldAt( fold->children, line ) ) {
+        if ( !fold->opened ) {
+            if ( from != NULL )
+                *from = fold->from;
+            if ( to != NULL )
+                *to = fold->to;
+            return true;
+        }
     }
+    return false;
+}
+
+int YZFoldPool::level( int line ) const
+{
+    updateSyntaxFolds();
+    int level = 0;
+    for ( YZFold* fold = foldAt( m_folds, line ); fold != NULL; fold = foldAt( fold->children, line ) )
+        ++level;
+    return level;
+}
+
+int YZFoldPool::lineAfterFold( int line ) const
+{
+    updateSyntaxFolds();
+    YZFold* fold = outermostClosedFold( m_folds, line );
+    if ( fold != NULL )
+        return fold->to + 1;
     return line;
 }
 int YZFoldPool::lineHeadingFold( int line ) const
@@ -98,15 +322,173 @@ int YZFoldPool::lineHeadingFold( int line ) const
     return line;
 }
 
-YDebugStream& operator<<( YDebugStream& out, const YZFoldPool& f )
+void YZFoldPool::setOpened( int from, int to, bool opened )
+{
+    updateSyntaxFolds();
+    bool changed = false;
+    setFoldsOpened( &m_folds, from, to, opened, &changed );
+    if ( changed )
+        m_view->sendRefreshEvent();
+}
+
+void YZFoldPool::setAllOpened( bool opened )
 {
-    QList<int> keys = f.m_folds.keys();
-    for ( int i = 0; i < keys.size(); ++i ) {
-        out << "fold from line " << keys[ i ]
-        << " to line " << f.m_folds[ keys[ i ] ].to
-        << ". Opened ? " << f.m_folds[ keys[ i ] ].opened << endl;
+    setOpened( 0, m_view->buffer()->lineCount(), opened );
+}
+
+void YZFoldPool::shift( int line, int delta )
+{
+    if ( delta == 0 )
+        return;
+    shiftFolds( &m_folds, line, delta );
+    if ( m_syntaxDirtyFrom != -1 ) {
+        m_syntaxDirtyFrom = shiftedFrom( m_syntaxDirtyFrom, line, delta );
+        m_syntaxDirtyTo = qMax( m_syntaxDirtyFrom, shiftedTo( m_syntaxDirtyTo, line, delta ) );
+    }
+    /* the regions of the deleted lines are gone, and the regions left
+     * open at the end reach the appended lines */
+    const YBuffer* buffer = m_view->buffer();
+    if ( delta < 0 || line + delta >= buffer->lineCount() ) {
+        syntaxChanged( qMax( 0, line - 1 ) );
+        syntaxChanged( line );
+    } else if ( line > 0 && buffer->yzline( line + delta )->foldStarts() > 0
+                && buffer->yzline( line + delta )->foldEnds() > 0 ) {
+        /* a region without fold, opened on the line above and closed
+         * below ("{" then "} else {"), may get one */
+        syntaxChanged( line - 1 );
+    }
+}
+
+void YZFoldPool::setSyntaxFolding( bool enabled )
+{
+    if ( enabled == m_syntax )
+        return;
+    m_syntax = enabled;
+    if ( enabled ) {
+        m_syntaxDirtyFrom = 0;
+        m_syntaxDirtyTo = m_view->buffer()->lineCount() - 1;
+    } else {
+        m_syntaxDirtyFrom = -1;
+        m_syntaxDirtyTo = -1;
+        if ( !m_folds.isEmpty() ) {
+            QMap<int, bool> states;
+            removeSyntaxFolds( &m_folds, 0, m_folds.last()->to, &states );
+        }
+    }
+}
+
+void YZFoldPool::syntaxChanged( int line )
+{
+    if ( !m_syntax )
+        return;
+    if ( m_syntaxDirtyFrom == -1 ) {
+        m_syntaxDirtyFrom = line;
+        m_syntaxDirtyTo = line;
+    } else {
+        m_syntaxDirtyFrom = qMin( m_syntaxDirtyFrom, line );
+        m_syntaxDirtyTo = qMax( m_syntaxDirtyTo, line );
     }
-    return out;
 }
 
+/* a region found in the lines, before it becomes a fold */
+struct YZFoldRegion
+{
+    YZFoldRegion( int head, int to, bool endsAbove )
+            : head(head), to(to), endsAbove(endsAbove)
+    {}
+    int head;
+    int to;
+    bool endsAbove;
+};
+
+void YZFoldPool::updateSyntaxFolds() const
+{
+    if ( m_syntaxDirtyFrom == -1 )
+        return;
+    int from = m_syntaxDirtyFrom;
+    int dirtyTo = m_syntaxDirtyTo;
+    m_syntaxDirtyFrom = -1;
+    m_syntaxDirtyTo = -1;
 
+    const YBuffer* buffer = m_view->buffer();
+    int last = buffer->lineCount() - 1;
+    /* a region opened on the line above may be closed on the first
+     * changed line, even without a fold */
+    if ( from > 0 && from <= last + 1 && buffer->yzline( from - 1 )->foldStarts() > 0 )
+        --from;
+    /* no region is open before the outermost syntax fold around it */
+    YZFold* outer = outermostSyntaxFold( m_folds, from );
+    if ( outer != NULL )
+        from = outer->from;
+    /* nor before a fold closed on this line */
+    if ( from > 0 ) {
+        YZFold* above = outermostSyntaxFold( m_folds, from - 1 );
+        for ( YZFold* fold = above; fold != NULL; fold = foldAt( fold->children, from - 1 ) ) {
+            if ( fold->syntax && fold->endsAbove && fold->to == from - 1 ) {
+                from = above->from;
+                break;
+            }
+        }
+    }
+
+    /* scan the regions stored in the lines until all of them are closed
+     * after the last changed line, where the old syntax folds end too:
+     * the folds below are right */
+    int stop = last;
+    QList<int> open;
+    QList<YZFoldRegion> regions;
+    for ( int line = from; line <= last; ++line ) {
+        const YLine* yl = buffer->yzline( line );
+        /* the folds don't share lines: a region closed on the line
+         * where another one begins ("} else {") ends above it */
+        bool endsAbove = yl->foldStarts() > 0;
+        for ( int i = 0; i < yl->foldEnds() && !open.isEmpty(); ++i ) {
+            int head = open.takeLast();
+            /* the regions opened on the same line make one fold */
+            if ( open.isEmpty() || open.last() != head )
+                regions << YZFoldRegion( head, endsAbove ? line - 1 : line, endsAbove );
+        }
+        for ( int i = 0; i < yl->foldStarts(); ++i )
+            open.append( line );
+        if ( line >= dirtyTo && open.isEmpty() && !syntaxFoldCrosses( m_folds, line ) ) {
+            stop = line;
+            break;
+        }
+    }
+    /* the regions which are not closed go to the end */
+    while ( !open.isEmpty() ) {
+        int head = open.takeLast();
+        if ( open.isEmpty() || open.last() != head )
+            regions << YZFoldRegion( head, last, false );
+    }
+
+    /* the folds which are made again keep their state */
+    QMap<int, bool> states;
+    removeSyntaxFolds( &m_folds, from, stop, &states );
+    for ( int i = 0; i < regions.count(); ++i ) {
+        const YZFoldRegion& region = regions[ i ];
+        if ( region.to <= region.head )
+            continue;
+        YZFold* fold = new YZFold( region.head, region.to, states.value( region.head, true ), true );
+        fold->endsAbove = region.endsAbove;
+        if ( !insertFold( &m_folds, fold ) )
+            delete fold;
+    }
+    dbg() << "updateSyntaxFolds(): lines " << from << " to " << stop << ", " << regions.count() << " regions" << endl;
+}
+
+static void printFolds( YDebugStream& out, const QList<YZFold*>& folds, const QString& indent )
+{
+    foreach( YZFold* fold, folds ) {
+        out << indent << "fold from line " << fold->from
+        << " to line " << fold->to
+        << ". Opened ? " << fold->opened << endl;
+        printFolds( out, fold->children, indent + "  " );
+    }
+}
+
+YDebugStream& operator<<( YDebugStream& out, const YZFoldPool& f )
+{
+    printFolds( out, f.m_folds, QString() );
+    return out;
+}
@@ -20,23 +20,38 @@
 #ifndef YZ_FOLDING_H
 #define YZ_FOLDING_H
 
-#include <QMap>
+#include <QList>
 
 class YView;
 
 class YDebugStream;
 
 /**
- * A text fold
+ * A text fold, from the line @ref from (its head) to the line @ref to.
+ * The folds inside it are its children.
  */
 struct YZFold
 {
+    YZFold( int from, int to, bool opened, bool syntax );
+    ~YZFold();
+
+    int from;
     int to;
     bool opened;
+    /// made from the folding regions of the highlighting
+    bool syntax;
+    /// its region is closed on the line after it, where another one begins
+    bool endsAbove;
+    /// sorted and disjoint
+    QList<YZFold*> children;
 };
 
 /**
  * Maintains a pool of @ref YZFold "YZFolds".
+ *
+ * The folds are nested: they make a tree where the children of a fold, and
+ * the folds at the top, are sorted and disjoint. A line is looked up by a
+ * binary search in each level it goes through.
  */
 class YZFoldPool
 {
@@ -48,7 +63,8 @@ public:
     virtual ~YZFoldPool();
 
     /**
-     * create a new fold
+     * create a new fold, inside the folds containing it. The folds it
+     * partly covers are put inside it too.
      */
     void create( int from, int to );
 
@@ -59,16 +75,28 @@ public:
 
     /**
      * returns true if line is inside a fold (head excluded)
-     * if head is not NULL, it will contains the line heading the fold
+     * if head is not NULL, it will contains the line heading the innermost fold
      */
     bool contains( int line, int* head = NULL ) const;
 
     /**
      * same as contains && fold is closed 
      *  => line should be hidden
+     * if head is not NULL, it will contains the line heading the outermost closed fold
      */
     bool isFolded( int line, int* head = NULL ) const;
 
+    /**
+     * same as isFolded, head included
+     * if from and to are not NULL, they will contain the lines of the outermost closed fold
+     */
+    bool isInClosedFold( int line, int* from = NULL, int* to = NULL ) const;
+
+    /**
+     * returns the number of folds containing line, head included
+     */
+    int level( int line ) const;
+
     /**
      * returns the line number under the fold containing line. If line isn't inside a fold, returns line
      */
@@ -79,9 +107,50 @@ public:
      */
     int lineHeadingFold( int line ) const;
 
+    /**
+     * opens or closes the folds whose head is in [from, to]
+     */
+    void setOpened( int from, int to, bool opened );
+
+    /**
+     * opens or closes all the folds, the highlighting is not run again
+     */
+    void setAllOpened( bool opened );
+
+    /**
+     * Moves the folds after lines were inserted (@arg delta > 0) or
+     * deleted (@arg delta < 0) before the line @arg line.
+     * The folds around the lines grow or shrink, the folds whose lines
+     * are all deleted are removed.
+     */
+    void shift( int line, int delta );
+
+    /**
+     * Adds the folds made from the folding regions of the highlighting
+     * (foldmethod=syntax), or removes them
+     */
+    void setSyntaxFolding( bool enabled );
+
+    /**
+     * The folding regions of the line @arg line changed, the syntax folds
+     * around it are made again when they are needed
+     */
+    void syntaxChanged( int line );
+
 private:
+    /**
+     * makes again the syntax folds around the changed lines, from the
+     * folding regions the highlighting stored in the lines
+     */
+    void updateSyntaxFolds() const;
+
     YView* m_view;
-    QMap<int, YZFold> m_folds;
+    mutable QList<YZFold*> m_folds;
+
+    bool m_syntax;
+    // the lines whose folding regions changed, -1 when there are none
+    mutable int m_syntaxDirtyFrom;
+    mutable int m_syntaxDirtyTo;
 
 };
 
@@ -32,6 +32,7 @@
 #include <qfile.h>
 #include <qregexp.h>
 #include <QTextStream>
+#include <stdlib.h>
 
 #define dbg()    yzDebug("YInternalOptionPool")
 #define err()    yzError("YInternalOptionPool")
@@ -159,8 +160,9 @@ void setupView( YBuffer*, YView* v )
 }
 void viewUpdateListChars( YBuffer*, YView* v )
 {
+    /* the views keep the listchars they draw */
     if ( v && v->getLocalBooleanOption("list") )
-        v->sendRefreshEvent();
+        v->recalcScreen();
 }
 void setSyntax( YBuffer* b, YView* v )
 {
@@ -189,6 +191,7 @@ void YInternalOptionPool::init()
     options.append(new YOptionString("cursorreplace", "square", ContextView, ScopeLocal, &changeCursor, QStringList(), cursor_shape) );
     options.append(new YOptionString("encoding", "locale", ContextBuffer, ScopeLocal, &changeEncoding, QStringList("enc"), QStringList())); // XXX find the supported codecs
     options.append(new YOptionString("fileencoding", "", ContextBuffer, ScopeLocal, &doNothing, QStringList("fenc"), QStringList()));
+    options.append(new YOptionString("foldmethod", "manual", ContextView, ScopeLocal, &recalcView, QStringList("fdm"), QStringList("manual") << "syntax"));
     options.append(new YOptionBoolean("hlsearch", false, ContextSession, ScopeGlobal, &updateHLSearch, QStringList("hls")));
     options.append(new YOptionList("indentkeys", QStringList(), ContextBuffer, ScopeLocal, &doNothing, QStringList("indk"), QStringList()));
     options.append(new YOptionBoolean("incsearch", false, ContextSession, ScopeGlobal, &doNothing, QStringList("is")));
@@ -207,6 +210,14 @@ void YInternalOptionPool::init()
     options.append(new YOptionBoolean("rightleft", false, ContextView, ScopeLocal, &recalcView, QStringList("rl")));
     options.append(new YOptionBoolean("expandtab", false, ContextView, ScopeLocal, &recalcView, QStringList("et")));
     options.append(new YOptionInteger("schema", 0, ContextBuffer, ScopeLocal, &recalcView, QStringList(), 0));
+#ifdef YZIS_WIN32
+    QString shell = "cmd.exe";
+#else
+    QString shell = getenv( "SHELL" );
+    if ( shell.isEmpty() )
+        shell = "/bin/sh";
+#endif
+    options.append(new YOptionString("shell", shell, ContextSession, ScopeGlobal, &doNothing, QStringList("sh"), QStringList()));
     options.append(new YOptionString("syntax", "", ContextBuffer, ScopeLocal, &setSyntax, QStringList("syn"), QStringList())); // XXX put all name ofsyntaxes here
     options.append(new YOptionInteger("tabstop", 8, ContextView, ScopeLocal, &recalcView, QStringList("ts"), 1));
     options.append(new YOptionInteger("updatecount", 200, ContextSession, ScopeGlobal, &doNothing, QStringList("uc"), 1));
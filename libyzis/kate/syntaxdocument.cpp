@@ -34,8 +34,10 @@
 
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <QDataStream>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 
 #define deepdbg()    yzDeepDebug("YzisSyntaxDocument")
 #define dbg()        yzDebug("YzisSyntaxDocument")
@@ -44,8 +46,77 @@
 static void lookupPrefix( const QString& prefix, const QString& relpath, const QString& relPart, const QRegExp &regexp, QStringList& list, QStringList& relList, bool recursive, bool unique );
 static void lookupDirectory( const QString& path, const QString &relPart, const QRegExp &regexp, QStringList& list, QStringList& relList, bool recursive, bool unique );
 
+/* compiled syntax definitions, see YzisSyntaxDocument::setIdentifier */
+#define SYNTAX_CACHE_MAGIC 0x595a5359 // "YZSY"
+#define SYNTAX_CACHE_VERSION 1
+
+YzisSyntaxNode::~YzisSyntaxNode()
+{
+  for (int i=0; i < children.size(); i++)
+    delete children[i];
+}
+
+QString YzisSyntaxNode::attribute(const QString &name) const
+{
+  for (int i=0; i < attributes.size(); i++)
+    if (attributes[i].first == name)
+      return attributes[i].second;
+  return QString();
+}
+
+static YzisSyntaxNode *nodeFromDom(const QDomElement &element)
+{
+  YzisSyntaxNode *node = new YzisSyntaxNode;
+  node->tag = element.tagName();
+
+  QDomNamedNodeMap attributes = element.attributes();
+  for (int i=0; i < attributes.count(); i++)
+  {
+    QDomAttr attr = attributes.item(i).toAttr();
+    node->attributes.append(qMakePair(attr.name(), attr.value()));
+  }
+
+  // comments and text between the elements are dropped
+  for (QDomNode child = element.firstChild(); !child.isNull(); child = child.nextSibling())
+    if (child.isElement())
+      node->children.append(nodeFromDom(child.toElement()));
+
+  // only the leaves have a text, the keywords of the lists
+  if (node->children.isEmpty())
+    node->text = element.text().simplified();
+
+  return node;
+}
+
+static void writeNode(QDataStream &out, const YzisSyntaxNode *node)
+{
+  out << node->tag << (quint32)node->attributes.size();
+  for (int i=0; i < node->attributes.size(); i++)
+    out << node->attributes[i].first << node->attributes[i].second;
+  out << node->text << (quint32)node->children.size();
+  for (int i=0; i < node->children.size(); i++)
+    writeNode(out, node->children[i]);
+}
+
+static YzisSyntaxNode *readNode(QDataStream &in)
+{
+  YzisSyntaxNode *node = new YzisSyntaxNode;
+  quint32 count;
+  in >> node->tag >> count;
+  for (quint32 i=0; i < count && in.status() == QDataStream::Ok; i++)
+  {
+    QPair<QString,QString> attr;
+    in >> attr.first >> attr.second;
+    node->attributes.append(attr);
+  }
+  in >> node->text >> count;
+  for (quint32 i=0; i < count && in.status() == QDataStream::Ok; i++)
+    node->children.append(readNode(in));
+  return node;
+}
+
 YzisSyntaxDocument::YzisSyntaxDocument(bool force)
-  : QDomDocument()
+  : QDomDocument(), m_root(0)
 {
   setupModeList(force);
 }
@@ -54,6 +125,7 @@ YzisSyntaxDocument::~YzisSyntaxDocument()
 {
   for (int i=0; i < myModeList.size(); i++)
     delete myModeList[i];
+  qDeleteAll(m_trees);
 }
 
 /** If the open hl file is different from the one needed, it opens
@@ -65,39 +137,106 @@ bool YzisSyntaxDocument::setIdentifier(const QString& identifier)
   // if the current file is the same as the new one don't do anything.
   if(currentFile != identifier)
   {
-    // let's open the new file
-    QFile f( identifier );
+    // the trees are kept, the embedded highlightings switch between files
+    YzisSyntaxNode *root = m_trees.value(identifier);
+    if (!root)
+      root = loadCache(identifier);
 
-    if ( f.open(QIODevice::ReadOnly) )
+    if (!root)
     {
+      // let's open the new file
+      QFile f( identifier );
+      if ( !f.open(QIODevice::ReadOnly) )
+      {
+        // Oh o, we couldn't open the file.
+        //KMessageBox::error( 0L, i18n("Unable to open %1").arg(identifier) );
+        return false;
+      }
+
       // Let's parse the contets of the xml file
-      /* The result of this function should be check for robustness,
-         a false returned means a parse error */
+      QDomDocument doc;
       QString errorMsg;
       int line, col;
-      bool success=setContent(&f,&errorMsg,&line,&col);
-
-      // Ok, now the current file is the pretended one (identifier)
-      currentFile = identifier;
+      bool success=doc.setContent(&f,&errorMsg,&line,&col);
 
       // Close the file, is not longer needed
       f.close();
 
       if (!success)
       {
-        //KMessageBox::error(0L,i18n("<qt>The error <b>%4</b><br> has been detected in the file %1 at %2/%3</qt>").arg(identifier)
-          //  .arg(line).arg(col).arg(i18n("QXml",errorMsg.utf8())));
+        err() << "setIdentifier(): " << identifier << ":" << line << ":" << col << ": " << errorMsg << endl;
         return false;
       }
+
+      root = nodeFromDom(doc.documentElement());
+      saveCache(identifier, root);
     }
-    else
+
+    m_trees.insert(identifier, root);
+    m_root = root;
+    // Ok, now the current file is the pretended one (identifier)
+    currentFile = identifier;
+  }
+
+  return true;
+}
+
+QString YzisSyntaxDocument::cachePath(const QString& identifier) const
+{
+  return resourceMgr()->findResource(WritableConfigResource, "syntaxcache/")
+         + QFileInfo(identifier).completeBaseName() + '-' + QString::number(qHash(identifier), 16) + ".bin";
+}
+
+YzisSyntaxNode *YzisSyntaxDocument::loadCache(const QString& identifier)
+{
+  QFileInfo source(identifier);
+  QFile f(cachePath(identifier));
+  if (!source.exists() || !f.open(QIODevice::ReadOnly))
+    return 0;
+
+  // the tree is built node by node anyway, it is read straight from the file
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_4_0);
+  quint32 magic, version;
+  QString path;
+  qint64 modified, size;
+  in >> magic >> version >> path >> modified >> size;
+
+  YzisSyntaxNode *root = 0;
+  if (in.status() == QDataStream::Ok && magic == SYNTAX_CACHE_MAGIC && version == SYNTAX_CACHE_VERSION
+      && path == identifier && modified == (qint64)source.lastModified().toTime_t() && size == source.size())
+  {
+    root = readNode(in);
+    if (in.status() != QDataStream::Ok)
     {
-      // Oh o, we couldn't open the file.
-      //KMessageBox::error( 0L, i18n("Unable to open %1").arg(identifier) );
-      return false;
+      err() << "loadCache(): " << f.fileName() << " is corrupted" << endl;
+      delete root;
+      root = 0;
     }
   }
-  return true;
+  else
+    dbg() << "loadCache(): " << f.fileName() << " is out of date" << endl;
+
+  f.close();
+  return root;
+}
+
+void YzisSyntaxDocument::saveCache(const QString& identifier, const YzisSyntaxNode *root)
+{
+  QDir().mkpath(resourceMgr()->findResource(WritableConfigResource, "syntaxcache"));
+  QFileInfo source(identifier);
+  QFile f(cachePath(identifier));
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    dbg() << "saveCache(): cannot write " << f.fileName() << endl;
+    return;
+  }
+
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_4_0);
+  out << (quint32)SYNTAX_CACHE_MAGIC << (quint32)SYNTAX_CACHE_VERSION << identifier
+      << (qint64)source.lastModified().toTime_t() << (qint64)source.size();
+  writeNode(out, root);
 }
 
 /**
@@ -105,30 +244,21 @@ bool YzisSyntaxDocument::setIdentifier(const QString& identifier)
  */
 bool YzisSyntaxDocument::nextGroup( YzisSyntaxContextData* data )
 {
-  if(!data)
+  if(!data || !data->parent)
     return false;
 
   // No group yet so go to first child
-  if (data->currentGroup.isNull())
-  {
-    // Skip over non-elements. So far non-elements are just comments
-    QDomNode node = data->parent.firstChild();
-    while (node.isComment())
-      node = node.nextSibling();
-
-    data->currentGroup = node.toElement();
-  }
+  if (!data->currentGroup)
+    data->groupIndex = 0;
   else
-  {
-    // common case, iterate over siblings, skipping comments as we go
-    QDomNode node = data->currentGroup.nextSibling();
-    while (node.isComment())
-      node = node.nextSibling();
+    data->groupIndex++;
 
-    data->currentGroup = node.toElement();
-  }
+  if (data->groupIndex < data->parent->children.size())
+    data->currentGroup = data->parent->children[data->groupIndex];
+  else
+    data->currentGroup = 0;
 
-  return !data->currentGroup.isNull();
+  return data->currentGroup != 0;
 }
 
 /**
@@ -136,65 +266,43 @@ bool YzisSyntaxDocument::nextGroup( YzisSyntaxContextData* data )
  */
 bool YzisSyntaxDocument::nextItem( YzisSyntaxContextData* data)
 {
-  if(!data)
+  if(!data || !data->currentGroup)
     return false;
 
-  if (data->item.isNull())
-  {
-    QDomNode node = data->currentGroup.firstChild();
-    while (node.isComment())
-      node = node.nextSibling();
-
-    data->item = node.toElement();
-  }
+  if (!data->item)
+    data->itemIndex = 0;
   else
-  {
-    QDomNode node = data->item.nextSibling();
-    while (node.isComment())
-      node = node.nextSibling();
+    data->itemIndex++;
 
-    data->item = node.toElement();
-  }
+  if (data->itemIndex < data->currentGroup->children.size())
+    data->item = data->currentGroup->children[data->itemIndex];
+  else
+    data->item = 0;
 
-  return !data->item.isNull();
+  return data->item != 0;
 }
 
 /**
  * This function is used to fetch the attributes of the tags of the item in a YzisSyntaxContextData.
  */
 QString YzisSyntaxDocument::groupItemData( const YzisSyntaxContextData* data, const QString& name){
-  if(!data)
+  if(!data || !data->item)
     return QString();
 
   // If there's no name just return the tag name of data->item
-  if ( (!data->item.isNull()) && (name.isEmpty()))
-  {
-    return data->item.tagName();
-  }
+  if (name.isEmpty())
+    return data->item->tag;
 
   // if name is not empty return the value of the attribute name
-  if (!data->item.isNull())
-  {
-    return data->item.attribute(name);
-  }
-
-  return QString();
-
+  return data->item->attribute(name);
 }
 
 QString YzisSyntaxDocument::groupData( const YzisSyntaxContextData* data,const QString& name)
 {
-  if(!data)
+  if(!data || !data->currentGroup)
     return QString();
 
-  if (!data->currentGroup.isNull())
-  {
-    return data->currentGroup.attribute(name);
-  }
-  else
-  {
-    return QString();
-  }
+  return data->currentGroup->attribute(name);
 }
 
 void YzisSyntaxDocument::freeGroupInfo( YzisSyntaxContextData* data)
@@ -216,46 +324,43 @@ YzisSyntaxContextData* YzisSyntaxDocument::getSubItems(YzisSyntaxContextData* da
   return retval;
 }
 
-bool YzisSyntaxDocument::getElement (QDomElement &element, const QString &mainGroupName, const QString &config)
+const YzisSyntaxNode *YzisSyntaxDocument::getElement (const QString &mainGroupName, const QString &config)
 {
-  deepdbg() << "getElement( element, \"" << mainGroupName << "\", \"" << config << "\" )" << endl;
+  deepdbg() << "getElement( \"" << mainGroupName << "\", \"" << config << "\" )" << endl;
 
-  QDomNodeList nodes = documentElement().childNodes();
+  if (!m_root)
+    return 0;
 
   // Loop over all these child nodes looking for mainGroupName
-  for (int i=0; i<nodes.count(); i++)
+  for (int i=0; i < m_root->children.size(); i++)
   {
-    QDomElement elem = nodes.item(i).toElement();
-    if (elem.tagName() == mainGroupName)
+    const YzisSyntaxNode *elem = m_root->children[i];
+    if (elem->tag == mainGroupName)
     {
       // Found mainGroupName ...
-      QDomNodeList subNodes = elem.childNodes();
-
       // ... so now loop looking for config
-      for (int j=0; j<subNodes.count(); j++)
+      for (int j=0; j < elem->children.size(); j++)
       {
-        QDomElement subElem = subNodes.item(j).toElement();
-        if (subElem.tagName() == config)
+        if (elem->children[j]->tag == config)
         {
           // Found it!
-          element = subElem;
-          return true;
+          return elem->children[j];
         }
       }
 
       deepdbg() << "getElement(): WARNING: \""<< config <<"\" wasn't found!" << endl;
-      return false;
+      return 0;
     }
   }
 
   deepdbg() << "getElement(): WARNING: \""<< mainGroupName <<"\" wasn't found!" << endl;
-  return false;
+  return 0;
 }
 
 YzisSyntaxContextData* YzisSyntaxDocument::getConfig(const QString& mainGroupName, const QString &config)
 {
-  QDomElement element;
-  if (getElement(element, mainGroupName, config))
+  const YzisSyntaxNode *element = getElement(mainGroupName, config);
+  if (element)
   {
     YzisSyntaxContextData *data = new YzisSyntaxContextData;
     data->item = element;
@@ -266,8 +371,8 @@ YzisSyntaxContextData* YzisSyntaxDocument::getConfig(const QString& mainGroupNam
 
 YzisSyntaxContextData* YzisSyntaxDocument::getGroupInfo(const QString& mainGroupName, const QString &group)
 {
-  QDomElement element;
-  if (getElement(element, mainGroupName, group+'s'))
+  const YzisSyntaxNode *element = getElement(mainGroupName, group+'s');
+  if (element)
   {
     YzisSyntaxContextData *data = new YzisSyntaxContextData;
     data->parent = element;
@@ -276,48 +381,60 @@ YzisSyntaxContextData* YzisSyntaxDocument::getGroupInfo(const QString& mainGroup
   return 0;
 }
 
+// the first list named type below node
+static const YzisSyntaxNode *findList(const YzisSyntaxNode *node, const QString& type)
+{
+  for (int i=0; i < node->children.size(); i++)
+  {
+    const YzisSyntaxNode *child = node->children[i];
+    if (child->tag == "list" && child->attribute("name") == type)
+      return child;
+    if ((child = findList(child, type)))
+      return child;
+  }
+  return 0;
+}
+
 QStringList& YzisSyntaxDocument::finddata(const QString& mainGroup, const QString& type, bool clearList)
 {
   deepdbg()<< "finddata( mainGroup=\"" << mainGroup<<"\", type=\"" << type << "\", clearList="<< clearList <<" ) " <<endl;
   if (clearList)
     m_data.clear();
 
-  for(QDomNode node = documentElement().firstChild(); !node.isNull(); node = node.nextSibling())
+  for (int n=0; m_root && n < m_root->children.size(); n++)
   {
-    QDomElement elem = node.toElement();
-    if (elem.tagName() == mainGroup)
+    const YzisSyntaxNode *elem = m_root->children[n];
+    if (elem->tag == mainGroup)
     {
       deepdbg()<<"\""<<mainGroup<<"\" found."<<endl;
-      QDomNodeList nodelist1 = elem.elementsByTagName("list");
 
-      for (int l=0; l<nodelist1.count(); l++)
+      const YzisSyntaxNode *list = findList(elem, type);
+      if (list)
       {
-        if (nodelist1.item(l).toElement().attribute("name") == type)
+        deepdbg()<<"List with attribute name=\""<<type<<"\" found."<<endl;
+
+        for (int i=0; i < list->children.size(); i++)
         {
-          deepdbg()<<"List with attribute name=\""<<type<<"\" found."<<endl;
-          QDomNodeList childlist = nodelist1.item(l).toElement().childNodes();
+          const QString &element = list->children[i]->text;
+
+          if (element.isEmpty())
+            continue;
 
-          for (int i=0; i<childlist.count(); i++)
-          {
-            QString element = childlist.item(i).toElement().text().simplified();
-            if (element.isEmpty())
-              continue;
 #ifndef NDEBUG
-            if (i<6)
-            {
-              deepdbg()<<"\""<<element<<"\" added to the list \""<<type<<"\""<<endl;
-            }
-            else if(i==6)
-            {
-              deepdbg()<<"... The list continues ..."<<endl;
-            }
-#endif
-            m_data += element;
+          if (i<6)
+          {
+            deepdbg()<<"\""<<element<<"\" added to the list \""<<type<<"\""<<endl;
+          }
+          else if(i==6)
+          {
+            deepdbg()<<"... The list continues ..."<<endl;
           }
+#endif
 
-          break;
+          m_data += element;
         }
       }
+
       break;
     }
   }
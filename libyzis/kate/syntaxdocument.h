@@ -30,8 +30,11 @@
 #define __YZ_SYNTAXDOCUMENT_H__
 
 #include <QtXml/QDomElement>
+#include <QHash>
 #include <QList>
+#include <QPair>
 #include <QStringList>
+#include <QVector>
 
 /**
  * Information about each syntax hl Mode
@@ -58,14 +61,35 @@ class YzisSyntaxModeListItem
 typedef QList<YzisSyntaxModeListItem*> YzisSyntaxModeList;
 
 /**
- * Class holding the data around the current QDomElement
+ * Element of a syntax definition: what the highlighting uses of the xml
+ * tree, without the comments and the text between the elements
+ */
+class YzisSyntaxNode
+{
+  public:
+    ~YzisSyntaxNode();
+
+    QString attribute(const QString &name) const;
+
+    QString tag;
+    QVector<QPair<QString,QString> > attributes;
+    QString text; ///< text of the leaf elements, simplified
+    QVector<YzisSyntaxNode*> children;
+};
+
+/**
+ * Class holding the data around the current YzisSyntaxNode
  */
 class YzisSyntaxContextData
 {
   public:
-    QDomElement parent;
-    QDomElement currentGroup;
-    QDomElement item;
+    YzisSyntaxContextData() : parent(0), currentGroup(0), item(0), groupIndex(0), itemIndex(0) {}
+
+    const YzisSyntaxNode *parent;
+    const YzisSyntaxNode *currentGroup;
+    const YzisSyntaxNode *item;
+    int groupIndex; ///< index of currentGroup in parent
+    int itemIndex; ///< index of item in currentGroup
 };
 
 /**
@@ -89,6 +113,10 @@ class YzisSyntaxDocument : public QDomDocument
     /**
 	 * If the open hl file is different from the one needed, it opens
      * the new one and assign some other things.
+     *
+     * The xml file is only parsed once: its tree is compiled in the
+     * syntaxcache directory of the user, and read from there as long as
+     * the xml file keeps its date and size.
      * @param identifier file name and path of the new xml needed
      */
     bool setIdentifier(const QString& identifier);
@@ -152,7 +180,14 @@ class YzisSyntaxDocument : public QDomDocument
      * Used by getConfig and getGroupInfo to traverse the xml nodes and
      * evenually return the found element
     */
-    bool getElement (QDomElement &element, const QString &mainGroupName, const QString &config);
+    const YzisSyntaxNode *getElement (const QString &mainGroupName, const QString &config);
+
+    /**
+     * The compiled tree of @param identifier, if it is up to date
+     */
+    YzisSyntaxNode *loadCache(const QString& identifier);
+    void saveCache(const QString& identifier, const YzisSyntaxNode *root);
+    QString cachePath(const QString& identifier) const;
 
     /**
      * List of mode items
@@ -165,6 +200,13 @@ class YzisSyntaxDocument : public QDomDocument
      */
     QString currentFile;
 
+    /**
+     * trees of the syntax files used so far, by identifier, and the one
+     * of currentFile
+     */
+    QHash<QString, YzisSyntaxNode*> m_trees;
+    const YzisSyntaxNode *m_root;
+
     /**
      * last found data out of the xml
      */
@@ -38,6 +38,7 @@
 #include "schema.h"
 #include "session.h"
 #include "resourcemgr.h"
+#include "regexp.h"
 
 
 #include "luaengine.h"
@@ -47,8 +48,15 @@
 //END
 
 //BEGIN defines
-// same as in kmimemagic, no need to feed more data
-#define YZIS_HL_HOWMANY 1024
+// size of the beginning of a file the content detection looks at
+#define YZIS_HL_HOWMANY 16384
+
+// number of lines whose highlighting is remembered by each definition
+#define YZIS_HL_MEMO_SIZE 4096
+
+// number of lines at the beginning of a file where modelines are searched,
+// as the 'modelines' default of vim
+#define YZIS_HL_MODELINES 5
 
 // min. x seconds between two dynamic contexts reset
 static const int YZIS_DYNAMIC_CONTEXTS_RESET_DELAY = 30 * 1000;
@@ -68,6 +76,26 @@ inline bool yzisInsideString (const QString &str, QChar ch)
   return false;
 }
 
+// marks the ASCII chars of str in ascii
+inline void yzisMarkAscii (bool *ascii, const QString &str)
+{
+  for (int i=0; i < str.length(); i++)
+    if (str[i].unicode() < 128)
+      ascii[str[i].unicode()] = true;
+}
+
+YzisHlCharSet::YzisHlCharSet (const QString &chars)
+{
+  setChars (chars);
+}
+
+void YzisHlCharSet::setChars (const QString &chars)
+{
+  memset (m_bits, 0, sizeof (m_bits));
+  for (int i=0; i < chars.length(); i++)
+    m_bits[chars[i].unicode() >> 3] |= 1 << (chars[i].unicode() & 7);
+}
+
 class YzisHlItem
 {
   public:
@@ -82,6 +110,10 @@ class YzisHlItem
 
     virtual bool lineContinue() const {return false;}
 
+    // marks in ascii (128 flags) the ASCII chars a match can start with,
+    // returns false if it may start with any char
+    virtual bool startChars(bool * /*ascii*/) const {return false;}
+
     virtual QStringList *capturedTexts() {return 0;}
     virtual YzisHlItem *clone(const QStringList *) {return this;}
 
@@ -115,7 +147,20 @@ class YzisHlContext
     virtual ~YzisHlContext();
     YzisHlContext *clone(const QStringList *args);
 
+    /**
+     * Builds asciiItems from items, once they are all known.
+     */
+    void makeDispatchTable();
+
     QVector<YzisHlItem*> items;
+    /**
+     * The items to try at each ASCII char, in the order of items: the ones
+     * which can start with that char and the ones which can start with
+     * any char. The other chars try all the items.
+     */
+    QVector<YzisHlItem*> asciiItems[128];
+    /// deliminators of the highlighting definition of the context
+    const YzisHlCharSet *deliminators;
     QString hlId; ///< A unique highlight identifier. Used to look up correct properties.
     int attr;
     int ctx;
@@ -160,6 +205,7 @@ class YzisHlCharDetect : public YzisHlItem
     YzisHlCharDetect(int attribute, int context,signed char regionId,signed char regionId2, QChar);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
     virtual YzisHlItem* clone( const QStringList *args );
 
   private:
@@ -173,6 +219,7 @@ class YzisHl2CharDetect : public YzisHlItem
     YzisHl2CharDetect(int attribute, int context,signed char regionId,signed char regionId2,  const QChar *ch);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
     virtual YzisHlItem* clone( const QStringList *args );
 
   private:
@@ -186,6 +233,7 @@ class YzisHlStringDetect : public YzisHlItem
     YzisHlStringDetect(int attribute, int context, signed char regionId,signed char regionId2, const QString &, bool inSensitive=false);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
     virtual YzisHlItem *clone( const QStringList *argS );
 
   private:
@@ -200,6 +248,7 @@ class YzisHlRangeDetect : public YzisHlItem
     YzisHlRangeDetect(int attribute, int context, signed char regionId,signed char regionId2, QChar ch1, QChar ch2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 
   private:
     QChar sChar1;
@@ -209,16 +258,31 @@ class YzisHlRangeDetect : public YzisHlItem
 class YzisHlKeyword : public YzisHlItem
 {
   public:
-    YzisHlKeyword(int attribute, int context,signed char regionId,signed char regionId2, bool casesensitive, const QString& delims);
-    virtual ~YzisHlKeyword ();
+    YzisHlKeyword(int attribute, int context,signed char regionId,signed char regionId2, bool casesensitive, const YzisHlCharSet& delims);
 
     void addList(const QStringList &);
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 
   private:
-    QVector< QSet<QString>* > dict;
+    // the char as stored in words
+    inline ushort fold (QChar c) const { return _caseSensitive ? c.unicode() : c.toLower().unicode(); }
+    void insert (uint hash, int pos, int len);
+
+    // open addressing hash table of the words, looked up with the chars
+    // of the line: no string is built to match a keyword
+    struct Entry
+    {
+      uint hash;
+      int pos; ///< position of the word in words
+      int len; ///< 0 for a free entry
+    };
+    QVector<Entry> table;
+    int count;
+    // all the words one after the other, folded
+    QString words;
     bool _caseSensitive;
-    const QString& deliminators;
+    const YzisHlCharSet& deliminators;
     int minLen;
     int maxLen;
 };
@@ -229,6 +293,7 @@ class YzisHlInt : public YzisHlItem
     YzisHlInt(int attribute, int context, signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 };
 
 class YzisHlFloat : public YzisHlItem
@@ -238,6 +303,7 @@ class YzisHlFloat : public YzisHlItem
     virtual ~YzisHlFloat () {}
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 };
 
 class YzisHlCFloat : public YzisHlFloat
@@ -255,6 +321,7 @@ class YzisHlCOct : public YzisHlItem
     YzisHlCOct(int attribute, int context, signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 };
 
 class YzisHlCHex : public YzisHlItem
@@ -263,6 +330,7 @@ class YzisHlCHex : public YzisHlItem
     YzisHlCHex(int attribute, int context, signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 };
 
 class YzisHlLineContinue : public YzisHlItem
@@ -272,6 +340,7 @@ class YzisHlLineContinue : public YzisHlItem
 
     virtual bool endEnable(QChar c) {return c == '\0';}
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
     virtual bool lineContinue() const {return true;}
 };
 
@@ -281,6 +350,7 @@ class YzisHlCStringChar : public YzisHlItem
     YzisHlCStringChar(int attribute, int context, signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 };
 
 class YzisHlCChar : public YzisHlItem
@@ -289,6 +359,7 @@ class YzisHlCChar : public YzisHlItem
     YzisHlCChar(int attribute, int context,signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 };
 
 class YzisHlAnyChar : public YzisHlItem
@@ -297,6 +368,7 @@ class YzisHlAnyChar : public YzisHlItem
     YzisHlAnyChar(int attribute, int context, signed char regionId,signed char regionId2, const QString& charList);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
 
   private:
     const QString _charList;
@@ -306,18 +378,28 @@ class YzisHlRegExpr : public YzisHlItem
 {
   public:
     YzisHlRegExpr(int attribute, int context,signed char regionId,signed char regionId2 ,QString expr, bool insensitive, bool minimal);
-    ~YzisHlRegExpr() { delete Expr; }
+    ~YzisHlRegExpr() { delete Expr; delete searchExpr; }
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool startChars(bool *ascii) const;
     virtual QStringList *capturedTexts();
     virtual YzisHlItem *clone( const QStringList *args );
 
   private:
-    QRegExp *Expr;
+    YRegExp *Expr;
     bool handlesLinestart;
     QString _regexp;
     bool _insensitive;
     bool _minimal;
+
+    // Unanchored expression: one search tells at which offset of the line
+    // the next match is, the offsets before it are not tried. Null when
+    // the pattern has a ^, which would match at the search offset only.
+    YRegExp *searchExpr;
+    // the line searched last, it is kept so that its data is not reused
+    QString searchText;
+    int searchFrom;
+    int searchNext; ///< -1 if there is no match after searchFrom
 };
 
 class YzisHlDetectSpaces : public YzisHlItem
@@ -332,6 +414,14 @@ class YzisHlDetectSpaces : public YzisHlItem
       while ((offset < len2) && text[offset].isSpace()) offset++;
       return offset;
     }
+
+    virtual bool startChars(bool *ascii) const
+    {
+      for (int c = '\t'; c <= '\r'; ++c)
+        ascii[c] = true;
+      ascii[' '] = true;
+      return true;
+    }
 };
 
 class YzisHlDetectIdentifier : public YzisHlItem
@@ -363,6 +453,14 @@ class YzisHlDetectIdentifier : public YzisHlItem
 
       return 0;
     }
+
+    virtual bool startChars(bool *ascii) const
+    {
+      for (int c = 'a'; c <= 'z'; ++c)
+        ascii[c] = ascii[c - 'a' + 'A'] = true;
+      ascii['_'] = true;
+      return true;
+    }
 };
 
 //END
@@ -372,6 +470,7 @@ YzisHlManager *YzisHlManager::s_self = 0;
 
 static const bool trueBool = true;
 static const QString stdDeliminator = QString (" \t.():!+,-<=>%&*/;?[]^{|}~\\");
+static const YzisHlCharSet stdDeliminatorSet (stdDeliminator);
 //END
 
 //BEGIN NON MEMBER FUNCTIONS
@@ -462,6 +561,12 @@ int YzisHlCharDetect::checkHgl(const QString& text, int offset, int /*len*/)
   return 0;
 }
 
+bool YzisHlCharDetect::startChars(bool *ascii) const
+{
+  yzisMarkAscii(ascii, sChar);
+  return true;
+}
+
 YzisHlItem *YzisHlCharDetect::clone(const QStringList *args)
 {
   char c = sChar.toLatin1();
@@ -491,6 +596,12 @@ int YzisHl2CharDetect::checkHgl(const QString& text, int offset, int len)
   return 0;
 }
 
+bool YzisHl2CharDetect::startChars(bool *ascii) const
+{
+  yzisMarkAscii(ascii, sChar1);
+  return true;
+}
+
 YzisHlItem *YzisHl2CharDetect::clone(const QStringList *args)
 {
   char c1 = sChar1.toLatin1();
@@ -542,6 +653,17 @@ int YzisHlStringDetect::checkHgl(const QString& text, int offset, int len)
   return 0;
 }
 
+bool YzisHlStringDetect::startChars(bool *ascii) const
+{
+  if (strLen == 0)
+    return false;
+  yzisMarkAscii(ascii, str[0]);
+  // str is upper case then
+  if (_inSensitive)
+    yzisMarkAscii(ascii, str[0].toLower());
+  return true;
+}
+
 YzisHlItem *YzisHlStringDetect::clone(const QStringList *args)
 {
   QString newstr = str;
@@ -581,11 +703,18 @@ int YzisHlRangeDetect::checkHgl(const QString& text, int offset, int len)
   }
   return 0;
 }
+
+bool YzisHlRangeDetect::startChars(bool *ascii) const
+{
+  yzisMarkAscii(ascii, sChar1);
+  return true;
+}
 //END
 
 //BEGIN YzisHlKeyword
-YzisHlKeyword::YzisHlKeyword (int attribute, int context, signed char regionId,signed char regionId2, bool casesensitive, const QString& delims)
+YzisHlKeyword::YzisHlKeyword (int attribute, int context, signed char regionId,signed char regionId2, bool casesensitive, const YzisHlCharSet& delims)
   : YzisHlItem(attribute,context,regionId,regionId2)
+  , count (0)
   , _caseSensitive(casesensitive)
   , deliminators(delims)
   , minLen (0xFFFFFF)
@@ -595,17 +724,41 @@ YzisHlKeyword::YzisHlKeyword (int attribute, int context, signed char regionId,s
   customStartEnable = true;
 }
 
-YzisHlKeyword::~YzisHlKeyword ()
+void YzisHlKeyword::insert (uint hash, int pos, int len)
 {
-  for (int i=0; i < dict.size(); ++i)
-    delete dict[i];
+  const int mask = table.size() - 1;
+  int i = hash & mask;
+  while (table[i].len)
+    i = (i + 1) & mask;
+  table[i].hash = hash;
+  table[i].pos = pos;
+  table[i].len = len;
+  ++count;
 }
 
 void YzisHlKeyword::addList(const QStringList& list)
 {
+  // keeps the table at most half full
+  if (2 * (count + list.count()) > table.size())
+  {
+    QVector<Entry> old = table;
+    int size = 16;
+    while (size < 2 * (count + list.count()))
+      size *= 2;
+    Entry free = { 0, 0, 0 };
+    table.fill (free, size);
+    count = 0;
+    for (int i=0; i < old.size(); ++i)
+      if (old[i].len)
+        insert (old[i].hash, old[i].pos, old[i].len);
+  }
+
   for(int i=0; i < list.count(); ++i)
   {
-    int len = list[i].length();
+    const QString& word = list[i];
+    int len = word.length();
+    if (len == 0)
+      continue;
 
     if (minLen > len)
       minLen = len;
@@ -613,53 +766,65 @@ void YzisHlKeyword::addList(const QStringList& list)
     if (maxLen < len)
       maxLen = len;
 
-    if (len >= dict.size())
+    int pos = words.length();
+    uint hash = 0;
+    for (int n=0; n < len; ++n)
     {
-      uint oldSize = dict.size();
-      dict.resize (len+1);
-
-      for (int m=oldSize; m < dict.size(); ++m)
-        dict[m] = 0;
+      ushort c = fold (word[n]);
+      words += QChar (c);
+      hash = hash * 31 + c;
     }
-
-    if (!dict[len])
-      dict[len] = new QSet<QString> ();
-
-	if ( _caseSensitive )
-		dict[ len ]->insert( list[ i ] );
-	else
-		dict[ len ]->insert( list[ i ].toLower() );
+    insert (hash, pos, len);
   }
 }
 
 int YzisHlKeyword::checkHgl(const QString& text, int offset, int len)
 {
-  int offset2 = offset;
+  const QChar *chars = text.unicode() + offset;
   int wordLen = 0;
+  uint hash = 0;
 
-  while ((len > wordLen) && !yzisInsideString (deliminators, text[offset2]))
+  while ((len > wordLen) && !deliminators.contains (chars[wordLen]))
   {
-    offset2++;
+    hash = hash * 31 + fold (chars[wordLen]);
     wordLen++;
 
     if (wordLen > maxLen) return 0;
   }
 
-  if ( wordLen < minLen || !dict[ wordLen ] ) return 0;
+  if (wordLen < minLen) return 0;
 
-  if ( _caseSensitive )
+  const int mask = table.size() - 1;
+  for (int i = hash & mask; table[i].len; i = (i + 1) & mask)
   {
-	  if ( dict[ wordLen ]->contains( QString( text.unicode() + offset, wordLen ) ) )
-		  return offset2;
-  }
-  else
-  {
-	  if ( dict[ wordLen ]->contains( QString( text.unicode() + offset, wordLen ).toLower() ) )
-		  return offset2;
+    const Entry& e = table[i];
+    if (e.hash != hash || e.len != wordLen)
+      continue;
+    const QChar *word = words.unicode() + e.pos;
+    int n = 0;
+    while (n < wordLen && word[n].unicode() == fold (chars[n]))
+      ++n;
+    if (n == wordLen)
+      return offset + wordLen;
   }
 
   return 0;
 }
+
+bool YzisHlKeyword::startChars(bool *ascii) const
+{
+  for (int i=0; i < table.size(); ++i)
+  {
+    if (!table[i].len)
+      continue;
+    QChar c = words[table[i].pos];
+    yzisMarkAscii(ascii, c);
+    // the words are lower case then
+    if (!_caseSensitive)
+      yzisMarkAscii(ascii, c.toUpper());
+  }
+  return true;
+}
 //END
 
 //BEGIN YzisHlInt
@@ -695,6 +860,12 @@ int YzisHlInt::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool YzisHlInt::startChars(bool *ascii) const
+{
+  yzisMarkAscii(ascii, "0123456789");
+  return true;
+}
 //END
 
 //BEGIN YzisHlFloat
@@ -791,6 +962,12 @@ int YzisHlFloat::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool YzisHlFloat::startChars(bool *ascii) const
+{
+  yzisMarkAscii(ascii, "0123456789.");
+  return true;
+}
 //END
 
 //BEGIN YzisHlCOct
@@ -826,6 +1003,12 @@ int YzisHlCOct::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool YzisHlCOct::startChars(bool *ascii) const
+{
+  ascii['0'] = true;
+  return true;
+}
 //END
 
 //BEGIN YzisHlCHex
@@ -860,6 +1043,12 @@ int YzisHlCHex::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool YzisHlCHex::startChars(bool *ascii) const
+{
+  ascii['0'] = true;
+  return true;
+}
 //END
 
 //BEGIN YzisHlCFloat
@@ -921,6 +1110,12 @@ int YzisHlAnyChar::checkHgl(const QString& text, int offset, int)
 
   return 0;
 }
+
+bool YzisHlAnyChar::startChars(bool *ascii) const
+{
+  yzisMarkAscii(ascii, _charList);
+  return true;
+}
 //END
 
 //BEGIN YzisHlRegExpr
@@ -930,12 +1125,21 @@ YzisHlRegExpr::YzisHlRegExpr( int attribute, int context, signed char regionId,s
   , _regexp(regexp)
   , _insensitive(insensitive)
   , _minimal(minimal)
+  , searchExpr (0)
+  , searchFrom (0)
+  , searchNext (-1)
 {
   if (!handlesLinestart)
     regexp.prepend("^");
 
-  Expr = new QRegExp(regexp, _insensitive ? Qt::CaseInsensitive : Qt::CaseSensitive );
+  Expr = new YRegExp(regexp, _insensitive ? Qt::CaseInsensitive : Qt::CaseSensitive );
   Expr->setMinimal(_minimal);
+
+  if (!_regexp.contains('^'))
+  {
+    searchExpr = new YRegExp(_regexp, _insensitive ? Qt::CaseInsensitive : Qt::CaseSensitive );
+    searchExpr->setMinimal(_minimal);
+  }
 }
 
 int YzisHlRegExpr::checkHgl(const QString& text, int offset, int /*len*/)
@@ -943,13 +1147,167 @@ int YzisHlRegExpr::checkHgl(const QString& text, int offset, int /*len*/)
   if (offset && handlesLinestart)
     return 0;
 
-  int offset2 = Expr->indexIn( text, offset, QRegExp::CaretAtOffset );
+  if (searchExpr)
+  {
+    if (text.constData() != searchText.constData() || text.length() != searchText.length()
+        || offset < searchFrom || (searchNext != -1 && offset > searchNext))
+    {
+      searchText = text;
+      searchFrom = offset;
+      searchNext = searchExpr->indexIn( text, offset );
+      if (searchNext != -1 && searchExpr->matchedLength() == 0)
+      {
+        // it matches anywhere, searching doesn't help
+        delete searchExpr;
+        searchExpr = 0;
+        searchText = QString();
+      }
+    }
+    if (searchExpr && (searchNext == -1 || offset < searchNext))
+      return 0;
+  }
+
+  // at the match found by the search, done again for the captured texts
+  int offset2 = Expr->indexIn( text, offset, YRegExp::CaretAtOffset );
 
   if (offset2 == -1) return 0;
 
   return (offset + Expr->matchedLength());
 }
 
+// the end of the [] class starting at start, -1 if there is none
+static int regExpClassEnd (const QString &rx, int start)
+{
+  int i = start + 1;
+  if (i < rx.length() && rx[i] == '^')
+    ++i;
+  // a ] at first is part of the class
+  if (i < rx.length() && rx[i] == ']')
+    ++i;
+  for (; i < rx.length(); ++i)
+  {
+    if (rx[i] == '\\')
+      ++i;
+    else if (rx[i] == ']')
+      return i;
+  }
+  return -1;
+}
+
+// marks the chars of the escape sequence \e, false if it is not a
+// simple char or char class
+static bool regExpEscapeChars (QChar e, bool *ascii)
+{
+  switch (e.toLatin1())
+  {
+    case 'd':
+      yzisMarkAscii (ascii, "0123456789");
+      return true;
+    case 'w':
+      for (int c = 'a'; c <= 'z'; ++c)
+        ascii[c] = ascii[c - 'a' + 'A'] = true;
+      yzisMarkAscii (ascii, "0123456789_");
+      return true;
+    case 's':
+      yzisMarkAscii (ascii, " \t\n\v\f\r");
+      return true;
+    case 'n': ascii['\n'] = true; return true;
+    case 't': ascii['\t'] = true; return true;
+    case 'r': ascii['\r'] = true; return true;
+    case 'f': ascii['\f'] = true; return true;
+    case 'v': ascii['\v'] = true; return true;
+  }
+  // \b, \D, backreferences, ...
+  if (e.isLetterOrNumber())
+    return false;
+  yzisMarkAscii (ascii, e);
+  return true;
+}
+
+bool YzisHlRegExpr::startChars(bool *ascii) const
+{
+  const QString &rx = _regexp;
+  const int len = rx.length();
+
+  // with an alternative at the top, anything may start a match
+  int depth = 0;
+  for (int i=0; i < len; ++i)
+  {
+    if (rx[i] == '\\')
+      ++i;
+    else if (rx[i] == '[')
+    {
+      i = regExpClassEnd (rx, i);
+      if (i == -1)
+        return false;
+    }
+    else if (rx[i] == '(')
+      ++depth;
+    else if (rx[i] == ')')
+      --depth;
+    else if (rx[i] == '|' && depth == 0)
+      return false;
+  }
+
+  // only the first atom is looked at, not a group nor a wildcard
+  bool chars[128];
+  memset (chars, 0, sizeof (chars));
+  int i = handlesLinestart ? 1 : 0;
+  int end;
+  if (i >= len)
+    return false;
+  if (rx[i] == '\\')
+  {
+    if (i + 1 >= len || !regExpEscapeChars (rx[i + 1], chars))
+      return false;
+    end = i + 2;
+  }
+  else if (rx[i] == '[')
+  {
+    end = regExpClassEnd (rx, i);
+    if (end == -1 || rx[i + 1] == '^')
+      return false;
+    for (int n = i + 1; n < end; ++n)
+    {
+      if (rx[n] == '\\')
+      {
+        if (!regExpEscapeChars (rx[++n], chars))
+          return false;
+      }
+      else if (n + 2 < end && rx[n + 1] == '-' && rx[n + 2] != '\\')
+      {
+        for (uint c = rx[n].unicode(); c <= rx[n + 2].unicode() && c < 128; ++c)
+          chars[c] = true;
+        n += 2;
+      }
+      else
+        yzisMarkAscii (chars, rx[n]);
+    }
+    ++end;
+  }
+  else if (QString("().|*+?{}$^").contains(rx[i]))
+    return false;
+  else
+  {
+    yzisMarkAscii (chars, rx[i]);
+    end = i + 1;
+  }
+
+  // the atom may be skipped
+  if (end < len && (rx[end] == '*' || rx[end] == '?' || rx[end] == '{'))
+    return false;
+
+  for (int c=0; c < 128; ++c)
+  {
+    if (!chars[c])
+      continue;
+    ascii[c] = true;
+    if (_insensitive && (c | 0x20) >= 'a' && (c | 0x20) <= 'z')
+      ascii[c ^ 0x20] = true;
+  }
+  return true;
+}
+
 QStringList *YzisHlRegExpr::capturedTexts()
 {
   return new QStringList(Expr->capturedTexts());
@@ -991,6 +1349,12 @@ int YzisHlLineContinue::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool YzisHlLineContinue::startChars(bool *ascii) const
+{
+  ascii['\\'] = true;
+  return true;
+}
 //END
 
 //BEGIN YzisHlCStringChar
@@ -1067,6 +1431,12 @@ int YzisHlCStringChar::checkHgl(const QString& text, int offset, int len)
 {
   return checkEscapedChar(text, offset, len);
 }
+
+bool YzisHlCStringChar::startChars(bool *ascii) const
+{
+  ascii['\\'] = true;
+  return true;
+}
 //END
 
 //BEGIN YzisHlCChar
@@ -1104,6 +1474,12 @@ int YzisHlCChar::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool YzisHlCChar::startChars(bool *ascii) const
+{
+  ascii['\''] = true;
+  return true;
+}
 //END
 
 //BEGIN YzisHl2CharDetect
@@ -1141,6 +1517,7 @@ YzisHlContext::YzisHlContext (const QString &_hlId, int attribute, int lineEndCo
   dynamic = _dynamic;
   dynamicChild = false;
   noIndentationBasedFolding=_noIndentationBasedFolding;
+  deliminators = 0;
   if ( _noIndentationBasedFolding ) dbg()<<QString( "**********************_noIndentationBasedFolding is TRUE*****************" )<<endl;
 }
 
@@ -1156,10 +1533,44 @@ YzisHlContext *YzisHlContext::clone(const QStringList *args)
   }
 
   ret->dynamicChild = true;
+  ret->deliminators = deliminators;
+  ret->makeDispatchTable();
 
   return ret;
 }
 
+void YzisHlContext::makeDispatchTable()
+{
+  QVector<YzisHlItem*> anywhere;
+  bool ascii[128];
+
+  for (int c=0; c < 128; ++c)
+    asciiItems[c].clear();
+
+  for (int n=0; n < items.size(); ++n)
+  {
+    YzisHlItem *item = items[n];
+    memset (ascii, 0, sizeof (ascii));
+    if (item->startChars (ascii))
+    {
+      for (int c=0; c < 128; ++c)
+        if (ascii[c])
+          asciiItems[c].append (item);
+    }
+    else
+    {
+      anywhere.append (item);
+      for (int c=0; c < 128; ++c)
+        asciiItems[c].append (item);
+    }
+  }
+
+  // most chars only get the items which can start anywhere, share them
+  for (int c=0; c < 128; ++c)
+    if (asciiItems[c] == anywhere)
+      asciiItems[c] = anywhere;
+}
+
 YzisHlContext::~YzisHlContext()
 {
   if (dynamicChild)
@@ -1200,6 +1611,7 @@ YzisHighlighting::YzisHighlighting(const YzisSyntaxModeListItem *def) : refCount
     iHidden = false;
     m_additionalData.insert( "none", new HighlightPropertyBag );
     m_additionalData["none"]->deliminator = stdDeliminator;
+    m_additionalData["none"]->deliminatorSet.setChars (stdDeliminator);
     m_additionalData["none"]->wordWrapDeliminator = stdDeliminator;
     m_hlIndex[0] = "none";
   }
@@ -1236,6 +1648,8 @@ void YzisHighlighting::cleanup()
 
   internalIDList.clear();
 
+  m_contextStacks.clear();
+  clearLineMemo();
 }
 
 void YzisHighlighting::generateContextStack(int *ctxNum, int ctx, QVector<short>* ctxs, int *prevLine)
@@ -1332,6 +1746,8 @@ int YzisHighlighting::makeDynamicContext(YzisHlContext *model, const QStringList
  */
 void YzisHighlighting::dropDynamicContexts()
 {
+  QMutexLocker locker (&m_highlightMutex);
+
   for (int i=base_startctx; i < m_contexts.size(); ++i)
     delete m_contexts[i];
 
@@ -1339,6 +1755,40 @@ void YzisHighlighting::dropDynamicContexts()
 
   dynamicCtxs.clear();
   startctx = base_startctx;
+
+  // the dynamic context numbers of the lines are not valid anymore
+  clearLineMemo();
+}
+
+/*
+ * Highlighting of a line from a given start context
+ */
+class YzisHlLineMemo
+{
+  public:
+    QString text;
+    // the stacks are interned, comparing them is cheap
+    QVector<short> startCtx;
+    bool startContinue;
+    YLine result;
+    QVector<uint> folding;
+};
+
+void YzisHighlighting::clearLineMemo()
+{
+  qDeleteAll (m_lineMemo);
+  m_lineMemo.clear ();
+}
+
+const QVector<short> &YzisHighlighting::internContextStack (const QVector<short> &ctx)
+{
+  // no copy of the data to look it up
+  QByteArray key = QByteArray::fromRawData ((const char *)ctx.constData(), ctx.size() * sizeof(short));
+  QHash<QByteArray, QVector<short> >::const_iterator it = m_contextStacks.constFind (key);
+  if (it != m_contextStacks.constEnd())
+    return it.value();
+
+  return m_contextStacks.insert (QByteArray (key.constData(), key.size()), ctx).value();
 }
 
 /**
@@ -1348,6 +1798,9 @@ void YzisHighlighting::dropDynamicContexts()
  * @param textLine The text line to parse
  * @param foldingList will be filled
  * @param ctxChanged will be set to reflect if the context changed
+ *
+ * It may be called from any thread, as long as the lines are not
+ * shared with another one.
  */
 void YzisHighlighting::doHighlight ( YLine *prevLine,
                                      YLine *textLine,
@@ -1357,6 +1810,8 @@ void YzisHighlighting::doHighlight ( YLine *prevLine,
   if (!textLine)
     return;
 
+  QMutexLocker locker (&m_highlightMutex);
+
   // in all cases, remove old hl, or we will grow to infinite ;)
   textLine->clearAttributes ();
 
@@ -1364,12 +1819,33 @@ void YzisHighlighting::doHighlight ( YLine *prevLine,
   {
     if (textLine->length() > 0)
       memset (textLine->attributes(), 0, textLine->length());
+    textLine->setFoldMarkers (0, 0);
 
     return;
   }
 
+  // the same line from the same context is highlighted the same way
+  const QString& text = textLine->data();
+  const QVector<short> startCtx = prevLine->ctxArray();
+  const bool startContinue = prevLine->hlLineContinue();
+  const uint memoKey = qHash (text) ^ qHash (quint64 (quintptr (startCtx.constData()))) ^ uint (startContinue);
+  QHash<uint, YzisHlLineMemo*>::const_iterator memoIt = m_lineMemo.constFind (memoKey);
+  if (memoIt != m_lineMemo.constEnd())
+  {
+    const YzisHlLineMemo *memo = memoIt.value();
+    if (memo->startCtx == startCtx && memo->startContinue == startContinue && memo->text == text)
+    {
+      if (ctxChanged)
+        (*ctxChanged) = textLine->hlContextDropped() || memo->result.ctxArray() != textLine->ctxArray();
+      textLine->setHighlighting (memo->result);
+      (*foldingList) += memo->folding;
+      return;
+    }
+  }
+  const int foldingStart = foldingList->size();
+
   // duplicate the ctx stack, only once !
-  QVector<short> ctx (prevLine->ctxArray());
+  QVector<short> ctx (startCtx);
 
   int ctxNum = 0;
   int previousLine = -1;
@@ -1416,7 +1892,6 @@ void YzisHighlighting::doHighlight ( YLine *prevLine,
 
   // text, for programming convenience :)
   QChar lastChar = ' ';
-  const QString& text = textLine->data();
   const int len = textLine->length();
 
   // calc at which char the first char occurs, set it to length of line if never
@@ -1434,8 +1909,12 @@ void YzisHighlighting::doHighlight ( YLine *prevLine,
     bool standardStartEnableDetermined = false;
     bool customStartEnableDetermined = false;
 
+    // only the items which can start with this char
+    const ushort c = text[offset].unicode();
+    const QVector<YzisHlItem*> &items = (c < 128) ? context->asciiItems[c] : context->items;
+
     int index = 0;
-    for (item = context->items.empty() ? 0 : context->items[0]; item; item = (++index < context->items.size()) ? context->items[index] : 0 )
+    for (item = items.empty() ? 0 : items[0]; item; item = (++index < items.size()) ? items[index] : 0 )
     {
       // does we only match if we are firstNonSpace?
       if (item->firstNonSpace && (offset > startNonSpace))
@@ -1449,14 +1928,14 @@ void YzisHighlighting::doHighlight ( YLine *prevLine,
       {
         if (item->customStartEnable)
         {
-          if (customStartEnableDetermined || yzisInsideString (m_additionalData[context->hlId]->deliminator, lastChar))
+          if (customStartEnableDetermined || context->deliminators->contains (lastChar))
             customStartEnableDetermined = true;
           else
             continue;
         }
         else
         {
-          if (standardStartEnableDetermined || yzisInsideString (stdDeliminator, lastChar))
+          if (standardStartEnableDetermined || stdDeliminatorSet.contains (lastChar))
             standardStartEnableDetermined = true;
           else
             continue;
@@ -1588,8 +2067,8 @@ void YzisHighlighting::doHighlight ( YLine *prevLine,
     }
   }
 
-  // has the context stack changed ?
-  if (ctx == textLine->ctxArray())
+  // has the context stack changed ? (unknown if it was dropped)
+  if (!textLine->hlContextDropped() && ctx == textLine->ctxArray())
   {
     if (ctxChanged)
       (*ctxChanged) = false;
@@ -1600,12 +2079,38 @@ void YzisHighlighting::doHighlight ( YLine *prevLine,
       (*ctxChanged) = true;
 
     // assign ctx stack !
-    textLine->setContext(ctx);
+    textLine->setContext(internContextStack(ctx));
   }
 
   // write hl continue flag
   textLine->setHlLineContinue (item && item->lineContinue());
 
+  // the regions opened and closed on the line itself don't fold anything
+  int foldEnds = 0;
+  int foldStarts = 0;
+  for (int i = foldingStart; i + 1 < foldingList->size(); i += 2)
+  {
+    if ((int)(*foldingList)[i] > 0)
+      foldStarts++;
+    else if (foldStarts > 0)
+      foldStarts--;
+    else
+      foldEnds++;
+  }
+  textLine->setFoldMarkers (foldEnds, foldStarts);
+
+  if (m_lineMemo.size() >= YZIS_HL_MEMO_SIZE)
+    clearLineMemo();
+  YzisHlLineMemo *memo = new YzisHlLineMemo;
+  memo->text = text;
+  memo->startCtx = startCtx;
+  memo->startContinue = startContinue;
+  memo->result.setHighlighting (*textLine);
+  for (int i = foldingStart; i < foldingList->size(); ++i)
+    memo->folding.append ((*foldingList)[i]);
+  delete m_lineMemo.value (memoKey);
+  m_lineMemo.insert (memoKey, memo);
+
   if ( m_foldingIndentationSensitive ) {
       bool noindent=false;
       for ( int i=ctx.size()-1; i>=0; --i ) {
@@ -2040,7 +2545,7 @@ YzisHlItem *YzisHighlighting::createYzisHlItem(YzisSyntaxContextData *data,
   if (dataname=="keyword")
   {
     YzisHlKeyword *keyword=new YzisHlKeyword(attr,context,regionId,regionId2,casesensitive,
-                                             m_additionalData[ buildIdentifier ]->deliminator);
+                                             m_additionalData[ buildIdentifier ]->deliminatorSet);
 
     //Get the entries for the keyword lookup list
     keyword->addList(YzisHlManager::self()->syntax->finddata("highlighting",stringdata));
@@ -2239,6 +2744,7 @@ void YzisHighlighting::readGlobalKeywordConfig()
   deepdbg()<<"delimiterCharacters are: "<<deliminator<<endl;
 
   m_additionalData[buildIdentifier]->deliminator = deliminator;
+  m_additionalData[buildIdentifier]->deliminatorSet.setChars (deliminator);
 }
 
 /**
@@ -2486,6 +2992,13 @@ void YzisHighlighting::makeContextList()
   // belongs to
   handleYzisHlIncludeRules();
 
+  // the items of the contexts are all known now
+  for (int i=0; i < m_contexts.size(); ++i)
+  {
+    m_contexts[i]->deliminators = &m_additionalData[m_contexts[i]->hlId]->deliminatorSet;
+    m_contexts[i]->makeDispatchTable();
+  }
+
   embeddedHls.clear(); //save some memory.
   unresolvedContextReferences.clear(); //save some memory
   RegionList.clear();  // I think you get the idea ;)
@@ -2994,6 +3507,9 @@ YzisHlManager::YzisHlManager()
   QString resource=resourceMgr()->findResource( ConfigScriptResource, "hl.lua" );
   if (! resource.isEmpty()) YLuaEngine::self()->source( resource );
 
+  // after hl.lua, which may change the wildcards
+  buildWildcardIndex();
+
   magicSet = magic_open( MAGIC_MIME | MAGIC_COMPRESS | MAGIC_SYMLINK );
   if ( magicSet == NULL ) {
     magic_close(magicSet);
@@ -3047,39 +3563,28 @@ int YzisHlManager::nameFind(const QString &name)
   return z;
 }
 
-int YzisHlManager::detectHighlighting (YBuffer *doc)
+int YzisHlManager::detectHighlighting (YBuffer *doc, const QByteArray &sample)
 {
   dbg() << "detectHighlighting( " << doc << " )" << endl;
   int hl = wildcardFind( doc->fileNameShort() );
 
   if (hl == -1)
   {
-    hl = mimeFind( doc->fileNameShort() );
-/*	QString buf = "";
-    for ( unsigned int i = 0; i < doc->lineCount(); i++ ) {
-    	buf += doc->textline( i ) + "\n";
+    QByteArray buf = sample;
+    if ( buf.isNull() ) {
+      // from the beginning of the text of the buffer
+      for (int i = 0; i < doc->lineCount() && buf.size() < YZIS_HL_HOWMANY; i++)
+        buf += doc->textline( i ).toUtf8() + '\n';
     }
-    hl = mimeFind( buf ); */
-  /*
-    QByteArray buf (YZIS_HL_HOWMANY);
-    uint bufpos = 0;
-    for (uint i=0; i < doc->lineCount(); i++)
-    {
-      QString line = doc->textline( i );
-      uint len = line.length() + 1;
-
-      if (bufpos + len > YZIS_HL_HOWMANY)
-        len = YZIS_HL_HOWMANY - bufpos;
-
-      memcpy(&buf[bufpos], (line + "\n").latin1(), len);
-
-      bufpos += len;
+    buf.truncate( YZIS_HL_HOWMANY );
 
-      if (bufpos >= YZIS_HL_HOWMANY)
-        break;
+    if ( !buf.isEmpty() ) {
+      hl = contentFind( buf );
+      if (hl == -1)
+        hl = mimeFind( findByContent( buf ) );
+    } else {
+      hl = mimeFind( findByContent( doc->fileNameShort() ) );
     }
-    buf.resize( bufpos );
-    hl = mimeFind (buf); */
   }
 
   return hl;
@@ -3109,48 +3614,222 @@ int YzisHlManager::wildcardFind(const QString &fileName)
   return -1;
 }
 
-int YzisHlManager::realWildcardFind(const QString &fileName)
-{
-  deepdbg() << "realWidcardFind( " << fileName << ")" << endl;
-  static QRegExp sep("\\s*;\\s*");
+/*
+ * Regexp matching at least the names matched by a wildcard, a character
+ * set is loosened to any character
+ */
+static QString wildcardToRegExp(const QString &wildcard)
+{
+  QString rx;
+  for (int i = 0; i < wildcard.length(); ++i) {
+    QChar c = wildcard[i];
+    if (c == '*')
+      rx += ".*";
+    else if (c == '?')
+      rx += '.';
+    else if (c == '[' && wildcard.indexOf(']', i + 2) != -1) {
+      rx += '.';
+      i = wildcard.indexOf(']', i + 2);
+    } else
+      rx += QRegExp::escape(QString(c));
+  }
+  return rx;
+}
 
-  QList<YzisHighlighting*> highlights;
+/*
+ * Highlightings of the interpreters of "#!" lines and of the language names
+ * of modelines, when they are neither the name of the highlighting nor one
+ * of its extensions
+ */
+static const struct {
+  const char *language;
+  const char *hl;
+} languageAliases[] = {
+  { "sh", "Bash" },
+  { "ksh", "Bash" },
+  { "zsh", "Bash" },
+  { "dash", "Bash" },
+  { "gawk", "AWK" },
+  { "nawk", "AWK" },
+  { "mawk", "AWK" },
+  { "tclsh", "Tcl/Tk" },
+  { "wish", "Tcl/Tk" },
+  { "tcl", "Tcl/Tk" },
+  { "make", "Makefile" },
+  { "gmake", "Makefile" },
+  { "php", "PHP (HTML)" },
+  { "guile", "Scheme" },
+  { "rscript", "R Script" },
+  { "cpp", "C++" },
+  { "tex", "LaTeX" },
+  { "html", "HTML" },
+  { "xml", "XML" },
+  { "mail", "Email" },
+  { "changelog", "ChangeLog" },
+  { 0, 0 }
+};
 
-  for (int ab = 0 ; ab < hlList.size(); ++ab ) {
-    YzisHighlighting *highlight = hlList.at(ab);
+void YzisHlManager::buildWildcardIndex()
+{
+  extensionIndex.clear();
+  wildcardRegExps.clear();
+  wildcardHls.clear();
+  hlPriorities.clear();
+
+  QStringList patterns;
+  for (int i = 0; i < hlList.count(); ++i) {
+    YzisHighlighting *highlight = hlList.at(i);
     highlight->loadWildcards();
+    hlPriorities.append(highlight->priority());
+
+    // the plain extensions have no inner dot, a name ends with one of them
+    // iff its text after the last dot is that extension
+    foreach (const QString &ext, highlight->getPlainExtensions()) {
+      QList<int> &hls = extensionIndex[ext.mid(1)];
+      if (hls.isEmpty() || hls.last() != i)
+        hls.append(i);
+    }
 
-    QStringList::Iterator it = highlight->getPlainExtensions().begin(), end = highlight->getPlainExtensions().end();
-    for (; it != end; ++it)
-      if (fileName.endsWith((*it)))
-        highlights.append(highlight);
+    foreach (const QRegExp &re, highlight->getRegexpExtensions()) {
+      // an empty wildcard (from "*.c;" for instance) only matches an empty name
+      if (re.pattern().isEmpty())
+        continue;
+      wildcardRegExps.append(re);
+      wildcardHls.append(i);
+      patterns << "(?:" + wildcardToRegExp(re.pattern()) + ")";
+    }
+  }
+  combinedWildcards = QRegExp(patterns.join("|"));
+
+  languageIndex.clear();
+  for (int i = 0; i < hlList.count(); ++i)
+    languageIndex.insert(hlList.at(i)->name().toLower(), i);
+  for (int i = 0; languageAliases[i].language; ++i) {
+    YzisHighlighting *highlight = hlDict.value(languageAliases[i].hl);
+    if (highlight && !languageIndex.contains(languageAliases[i].language))
+      languageIndex.insert(languageAliases[i].language, hlList.indexOf(highlight));
+  }
+  dbg() << "buildWildcardIndex(): " << extensionIndex.count() << " extensions, "
+        << wildcardRegExps.count() << " wildcards" << endl;
+}
+
+int YzisHlManager::languageFind(const QString &language)
+{
+  QString name = language.toLower();
+  if (name.isEmpty())
+    return -1;
+  if (languageIndex.contains(name))
+    return languageIndex.value(name);
+
+  // "python2.5", "ruby1.8"
+  QString unversioned = name;
+  while (!unversioned.isEmpty() && (unversioned[unversioned.length() - 1].isDigit() || unversioned[unversioned.length() - 1] == '.'))
+    unversioned.chop(1);
+  if (languageIndex.contains(unversioned))
+    return languageIndex.value(unversioned);
 
-    for (int i = 0; i < (int)highlight->getRegexpExtensions().count(); i++) {
-      QRegExp re = highlight->getRegexpExtensions()[i];
-      if (re.exactMatch(fileName))
-        highlights.append(highlight);
+  return realWildcardFind("." + name);
+}
+
+int YzisHlManager::contentFind(const QByteArray &sample)
+{
+  /* all the rules in a single expression, the capture which matched tells
+   * the rule:
+   *  1, 2 - "#!interpreter" or "#!/usr/bin/env interpreter"
+   *  3    - XML or PHP declaration
+   *  4    - HTML document
+   *  5    - vim modeline: "vim: set ft=python:"
+   *  6, 7 - emacs modeline: "-*- mode: python -*-" or "-*- python -*-"
+   *  8    - kate modeline: "kate: hl Python;"
+   */
+  static QRegExp rules(
+    "^#!\\s*(\\S+)[ \\t]*(\\S*)"
+    "|^<\\?(xml|php)\\b"
+    "|^<(?:!doctype\\s+)?(html)\\b"
+    "|\\b(?:vi|vim|ex):.*\\b(?:ft|filetype|syn|syntax)=([\\w+-]+)"
+    "|-\\*-.*\\bmode:\\s*([\\w+-]+)"
+    "|-\\*-\\s*([\\w+-]+)\\s*-\\*-"
+    "|\\bkate:.*\\bhl\\s+([^;]+);",
+    Qt::CaseInsensitive );
+
+  // a multibyte character cut at the end does no harm, the rules are ascii
+  QString text = QString::fromLatin1( sample.constData(), sample.size() );
+  int start = 0;
+  for (int line = 0; line < YZIS_HL_MODELINES && start < text.length(); ++line) {
+    int end = text.indexOf('\n', start);
+    if (end == -1)
+      end = text.length();
+    QString l = text.mid(start, end - start);
+    start = end + 1;
+
+    if (rules.indexIn(l) == -1)
+      continue;
+    QString language;
+    if (!rules.cap(1).isEmpty()) {
+      if (line > 0)
+        continue;
+      language = rules.cap(1).mid(rules.cap(1).lastIndexOf('/') + 1);
+      if (language == "env")
+        language = rules.cap(2);
+    } else {
+      for (int i = 3; i <= 8 && language.isEmpty(); ++i)
+        language = rules.cap(i).trimmed();
     }
+
+    int hl = languageFind(language);
+    dbg() << "contentFind(): line " << line << " names " << language << ": " << hl << endl;
+    if (hl != -1)
+      return hl;
   }
+  return -1;
+}
 
-  if ( !highlights.isEmpty() )
-  {
-    int pri = -1;
-    int hl = -1;
+int YzisHlManager::realWildcardFind(const QString &fileName)
+{
+  deepdbg() << "realWidcardFind( " << fileName << ")" << endl;
 
-    for (int ab = 0 ; ab < highlights.size(); ++ab ) 
-    {
-      YzisHighlighting *highlight = highlights.at(ab);
-      if (highlight!=0L && highlight->priority() > pri)
-      {
-        pri = highlight->priority();
-        hl = hlList.indexOf (highlight);
+  // the highest priority wins, the first highlighting on a tie
+  int pri = -1;
+  int hl = -1;
+
+  int dot = fileName.lastIndexOf('.');
+  if (dot != -1) {
+    QHash<QString, QList<int> >::const_iterator it = extensionIndex.constFind(fileName.mid(dot + 1));
+    if (it != extensionIndex.constEnd()) {
+      foreach (int i, *it) {
+        if (hlPriorities[i] > pri) {
+          pri = hlPriorities[i];
+          hl = i;
+        }
       }
     }
+  }
 
-    return hl;
+  if (!wildcardRegExps.isEmpty() && combinedWildcards.exactMatch(fileName)) {
+    for (int j = 0; j < wildcardRegExps.count(); ++j) {
+      int i = wildcardHls[j];
+      bool better = hlPriorities[i] > pri || (hlPriorities[i] == pri && i < hl);
+      if (better && wildcardRegExps[j].exactMatch(fileName)) {
+        pri = hlPriorities[i];
+        hl = i;
+      }
+    }
   }
 
-  return -1;
+  return hl;
+}
+
+QString YzisHlManager::findByContent( const QByteArray& contents ) {
+    if ( magicSet == NULL )
+    	return QString();
+    const char* magic_result = magic_buffer( magicSet, contents.constData(), contents.size() );
+    if ( magic_result ) {
+    	QString mime = QString( magic_result );
+    	mime = mime.mid( 0, mime.indexOf( ';' ) );
+        dbg() << "findByContent() return " << mime << endl;
+    	return mime;
+    }
+    return QString();
 }
 
 QString YzisHlManager::findByContent( const QString& contents ) {
@@ -3168,12 +3847,13 @@ QString YzisHlManager::findByContent( const QString& contents ) {
     return QString();
 }
 
-int YzisHlManager::mimeFind(const QString &contents)
+int YzisHlManager::mimeFind(const QString &mt)
 {
-  dbg() << "mimeFind( " << contents << ")" << endl;
+  dbg() << "mimeFind( " << mt << ")" << endl;
   static QRegExp sep("\\s*;\\s*");
 
-  QString mt = findByContent( contents );
+  if ( mt.isEmpty() )
+    return -1;
 
   QList<YzisHighlighting*> highlights;
 
@@ -34,6 +34,7 @@
 #include <QHash>
 #include <QTime>
 #include <QLinkedList>
+#include <QMutex>
 #include <QVector>
 
 #include <magic.h>
@@ -50,6 +51,7 @@ class YzisSyntaxDocument;
 class YLine;
 class YzisSyntaxModeListItem;
 class YzisSyntaxContextData;
+class YzisHlLineMemo;
 
 class QPopupMenu;
 
@@ -112,6 +114,26 @@ class YzisHlData
     int priority;
 };
 
+/**
+ * Set of chars, with one bit for each UTF-16 code unit: the deliminators
+ * are looked up at every char of the highlighted lines.
+ */
+class YzisHlCharSet
+{
+  public:
+    YzisHlCharSet (const QString &chars = QString());
+
+    void setChars (const QString &chars);
+
+    inline bool contains (QChar c) const
+    {
+      return m_bits[c.unicode() >> 3] & (1 << (c.unicode() & 7));
+    }
+
+  private:
+    uchar m_bits[65536 / 8];
+};
+
 class YzisHighlighting
 {
   public:
@@ -223,8 +245,20 @@ class YzisHighlighting
     // be carefull: all documents hl should be invalidated after calling this method!
     void dropDynamicContexts();
 
+    /**
+     * @return the shared copy of the context stack @p ctx, all the lines
+     * ending with the same stack share its data.
+     */
+    const QVector<short> &internContextStack (const QVector<short> &ctx);
+
     QString indentation () { return m_indentation; }
 
+    /**
+     * Forgets the lines highlighted so far, the next ones go through
+     * the items again. Not to be called while a line is highlighted.
+     */
+    void clearLineMemo();
+
   private:
     // make this private, nobody should play with the internal data pointers
     void getYzisHlItemDataList(uint schema, YzisHlItemDataList &);
@@ -303,6 +337,19 @@ class YzisHighlighting
 
     QHash<int, QVector<YzisAttribute>* > m_attributeArrays;
 
+    // interned context stacks, keyed by their raw content
+    QHash<QByteArray, QVector<short> > m_contextStacks;
+
+    // results of doHighlight, by hash of the text and start context of
+    // the line: a line highlighted again from the same context (undo,
+    // paste, schema change...) skips the items
+    QHash<uint, YzisHlLineMemo*> m_lineMemo;
+
+    // doHighlight is called by the highlighting jobs of the buffers too,
+    // the contexts, the regexps of the items and the interned stacks
+    // are only used by one line at a time
+    QMutex m_highlightMutex;
+
     /**
      * This class holds the additional properties for one highlight
      * definition, such as comment strings, deliminators etc.
@@ -323,6 +370,7 @@ class YzisHighlighting
         QString multiLineRegion;
 		CSLPos  singleLineCommentPosition;
         QString deliminator;
+        YzisHlCharSet deliminatorSet;
         QString wordWrapDeliminator;
     };
 
@@ -364,7 +412,12 @@ class YZIS_EXPORT YzisHlManager
     YzisHighlighting *getHl(int n);
     int nameFind(const QString &name);
 
-    int detectHighlighting (class YBuffer *doc);
+    /**
+     * Highlighting of @arg doc from its file name, or else from the
+     * beginning of its text: @arg sample if given, the first lines of
+     * @arg doc otherwise.
+     */
+    int detectHighlighting (class YBuffer *doc, const QByteArray &sample = QByteArray());
 
     int findHl(YzisHighlighting *h) {return hlList.indexOf(h);}
     QString identifierForName(const QString&);
@@ -394,11 +447,13 @@ class YZIS_EXPORT YzisHlManager
 
   private:
     int wildcardFind(const QString &fileName);
-    int mimeFind(const QString &contents);
-//    int mimeFind(const QByteArray &contents);
+    int mimeFind(const QString &mimeType);
     int realWildcardFind(const QString &fileName);
+    void buildWildcardIndex();
+    int contentFind(const QByteArray &sample);
+    int languageFind(const QString &language);
 	QString findByContent( const QString& contents );
-//	QString findByContent( const QByteArray& contents );
+	QString findByContent( const QByteArray& contents );
 
   private:
     friend class YzisHighlighting;
@@ -411,6 +466,18 @@ class YZIS_EXPORT YzisHlManager
     //KConfig m_config;
     QStringList commonSuffixes;
 
+    // index of the wildcards of all highlightings, built once with the
+    // mode list: the plain "*.ext" wildcards by extension (ascending
+    // highlighting numbers), the other ones are tried only when their
+    // combined expression matches
+    QHash<QString, QList<int> > extensionIndex;
+    QList<QRegExp> wildcardRegExps;
+    QList<int> wildcardHls;
+    QRegExp combinedWildcards;
+    QVector<int> hlPriorities;
+    // lowercase names and aliases of the highlightings
+    QHash<QString, int> languageIndex;
+
     YzisSyntaxDocument *syntax;
     uint dynamicCtxsCount;
     QTime lastCtxsReset;
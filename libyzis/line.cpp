@@ -29,13 +29,17 @@
 #define err()    yzError("YLine")
 
 YLine::YLine(const QString &l) :
-        m_flags( YLine::FlagVisible )
+        m_flags( YLine::FlagVisible ),
+        m_foldEnds( 0 ),
+        m_foldStarts( 0 )
 {
     setData(l);
     m_initialized = false;
 }
 
-YLine::YLine()
+YLine::YLine() :
+        m_foldEnds( 0 ),
+        m_foldStarts( 0 )
 {
     setData( "" );
     m_initialized = false;
@@ -47,6 +51,8 @@ YLine::~YLine()
 void YLine::setData(const QString &data)
 {
     mData = data;
+    m_flags &= ~YLine::FlagHlDropped;
+    clearSearchMatches();
     uint len = data.length();
     if ( len == 0 ) len++; //make sure to return a non empty array ... (that sucks)
     mAttributes.resize( len );
@@ -85,6 +91,37 @@ int YLine::previousNonSpaceChar(uint pos) const
     return -1;
 }
 
+void YLine::dropHighlighting( bool keepContext )
+{
+    mAttributes = QVector<uchar>();
+    mAttributesList = QVector<int>();
+    m_flags |= YLine::FlagHlDropped;
+    if ( !keepContext ) {
+        m_ctx = QVector<short>();
+        m_flags |= YLine::FlagHlNoContext;
+    }
+}
+
+void YLine::setHighlighting( const YLine& other )
+{
+    mAttributes = other.mAttributes;
+    mAttributesList = other.mAttributesList;
+    m_ctx = other.m_ctx;
+    m_flags &= ~YLine::FlagHlDropped;
+    m_flags &= ~YLine::FlagHlNoContext;
+    setHlLineContinue( other.hlLineContinue() );
+    m_foldEnds = other.m_foldEnds;
+    m_foldStarts = other.m_foldStarts;
+}
+
+void YLine::restoreAttributes()
+{
+    uint len = mData.length();
+    if ( len == 0 ) len++; // same as setData
+    mAttributes.fill( 0, len );
+    m_flags &= ~YLine::FlagHlDropped;
+}
+
 void YLine::addAttribute ( int start, int length, int attribute )
 {
     if ((mAttributesList.size() > 2) && (mAttributesList[mAttributesList.size() - 1] == attribute)
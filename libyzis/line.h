@@ -48,9 +48,10 @@ public:
     {
         return m_ctx;
     };
-    inline void setContext (QVector<short> &val)
+    inline void setContext (const QVector<short> &val)
     {
         m_ctx = val;
+        m_flags &= ~YLine::FlagHlNoContext;
     }
     inline bool hlLineContinue () const
     {
@@ -66,12 +67,103 @@ public:
     void clearAttributes()
     {
         mAttributesList.clear();
+        if ( m_flags & YLine::FlagHlDropped )
+            restoreAttributes();
     }
     void addAttribute ( int start, int length, int attribute );
 
 
     inline uchar *attributes() { return mAttributes.data(); }
     inline const uchar *attributes() const { return mAttributes.data(); }
+    /**
+     * The attributes, shared with the copies of the vector until the line
+     * is highlighted again
+     */
+    inline const QVector<uchar> &attributeVector() const
+    {
+        return mAttributes;
+    }
+
+    /**
+     * hlsearch matches of this line, stored as (column, length) pairs
+     */
+    inline const QVector<int> &searchMatches() const
+    {
+        return mSearchMatches;
+    }
+    /**
+     * Version of the search pattern the matches were computed with,
+     * 0 if the line was not scanned since its text changed
+     */
+    inline int searchVersion() const
+    {
+        return mSearchVersion;
+    }
+    inline void setSearchMatches( const QVector<int> &matches, int version )
+    {
+        mSearchMatches = matches;
+        mSearchVersion = version;
+    }
+    inline void clearSearchMatches()
+    {
+        mSearchMatches.clear();
+        mSearchVersion = 0;
+    }
+
+    /**
+     * Mark used by :global, it stays on the line whatever happens to
+     * the lines around, and is lost when the line is deleted.
+     */
+    inline bool isMarked() const
+    {
+        return m_flags & YLine::FlagMarked;
+    }
+    inline void setMarked( bool marked )
+    {
+        if (marked) m_flags = m_flags | YLine::FlagMarked;
+        else m_flags = m_flags & ~ YLine::FlagMarked;
+    }
+
+    /**
+     * Frees the highlighting of the line to save memory, it has to be
+     * computed again before the line is displayed.
+     * @arg keepContext keeps the context stack at the end of the line, so
+     * that the next lines can be highlighted again from there
+     */
+    void dropHighlighting( bool keepContext );
+    /**
+     * Takes the highlighting computed on @arg other, a copy of this line
+     */
+    void setHighlighting( const YLine& other );
+    inline bool hlDropped() const
+    {
+        return m_flags & YLine::FlagHlDropped;
+    }
+    inline bool hlContextDropped() const
+    {
+        return m_flags & YLine::FlagHlNoContext;
+    }
+
+    /**
+     * Folding regions (beginRegion/endRegion of the highlighting) closed
+     * by this line, which were opened on the lines above
+     */
+    inline int foldEnds() const
+    {
+        return m_foldEnds;
+    }
+    /**
+     * Folding regions opened by this line and still open at its end
+     */
+    inline int foldStarts() const
+    {
+        return m_foldStarts;
+    }
+    inline void setFoldMarkers( int ends, int starts )
+    {
+        m_foldEnds = qMin( ends, 255 );
+        m_foldStarts = qMin( starts, 255 );
+    }
 
     bool initialized() const
     {
@@ -88,11 +180,16 @@ public:
         //   FlagNoOtherData = 0x1, // ONLY INTERNAL USE, NEVER EVER SET THAT !!!!
         FlagHlContinue = 0x2,
         FlagVisible = 0x4,
-        FlagAutoWrapped = 0x8
+        FlagAutoWrapped = 0x8,
+        FlagMarked = 0x10,
+        FlagHlDropped = 0x20,
+        FlagHlNoContext = 0x40
     };
     Q_DECLARE_FLAGS( Flags, Flag );
 
 private:
+    void restoreAttributes();
+
     Flags m_flags;
 
     QString mData;
@@ -100,8 +197,14 @@ private:
     /// Rendering settings for each char
     QVector<uchar> mAttributes;
     QVector<int> mAttributesList;
+    /// hlsearch matches
+    QVector<int> mSearchMatches;
+    int mSearchVersion;
     /// Contexts for HL
     QVector<short> m_ctx;
+    /// Folding regions, they are kept when the highlighting is dropped
+    uchar m_foldEnds;
+    uchar m_foldStarts;
     /**
       Some bools packed
       */
@@ -0,0 +1,317 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+/* Yzis */
+#include "linesort.h"
+#include "regexp.h"
+#include "debug.h"
+
+/* Qt */
+#include <QList>
+#include <QThread>
+#include <QtAlgorithms>
+
+#include <limits.h>
+
+#define dbg()    yzDebug("YLineSort")
+#define err()    yzError("YLineSort")
+
+/* under this number of lines, sorting is not worth a thread */
+#define SORT_MIN_LINES_PER_JOB 50000
+
+/*
+ * Sort key of a line, it points inside the line string
+ */
+struct YSortKey
+{
+    int line;
+    const QChar* text;
+    int length;
+    bool hasNumber;
+    qlonglong number;
+};
+
+typedef QVector<YSortKey> YSortKeys;
+
+/*
+ * Ordering of the keys for the given flags
+ */
+class YSortKeyCompare
+{
+public:
+    YSortKeyCompare( YLineSort::Flags flags ) : mFlags(flags)
+    {}
+
+    /* <0, 0 or >0, like strcmp */
+    int compare( const YSortKey& a, const YSortKey& b ) const
+    {
+        if ( mFlags & YLineSort::Numeric ) {
+            // lines without number come first
+            if ( a.hasNumber != b.hasNumber )
+                return a.hasNumber ? 1 : -1;
+            if ( !a.hasNumber || a.number == b.number )
+                return 0;
+            return a.number < b.number ? -1 : 1;
+        }
+        int n = qMin( a.length, b.length );
+        bool icase = mFlags & YLineSort::IgnoreCase;
+        for ( int i = 0; i < n; ++i ) {
+            ushort ca = a.text[ i ].unicode();
+            ushort cb = b.text[ i ].unicode();
+            if ( ca != cb && icase ) {
+                ca = a.text[ i ].toLower().unicode();
+                cb = b.text[ i ].toLower().unicode();
+            }
+            if ( ca != cb )
+                return ca < cb ? -1 : 1;
+        }
+        return a.length - b.length;
+    }
+
+    bool operator()( const YSortKey& a, const YSortKey& b ) const
+    {
+        return compare( a, b ) < 0;
+    }
+
+private:
+    YLineSort::Flags mFlags;
+};
+
+/*
+ * Computes the keys of lines [first, last[, the lines without key are put
+ * in @arg unmatched
+ */
+static void makeKeys( const QVector<QString>& lines, int first, int last, YLineSort::Flags flags, const YRegExp* rx, YSortKeys* keys, QVector<int>* unmatched )
+{
+    for ( int i = first; i < last; ++i ) {
+        const QString& l = lines[ i ];
+        YSortKey key;
+        key.line = i;
+        key.text = l.unicode();
+        key.length = l.length();
+        if ( rx ) {
+            int pos = rx->indexIn( l );
+            if ( pos == -1 ) {
+                unmatched->append( i );
+                continue;
+            }
+            if ( flags & YLineSort::MatchedText ) {
+                key.text += pos;
+                key.length = rx->matchedLength();
+            } else {
+                key.text += pos + rx->matchedLength();
+                key.length -= pos + rx->matchedLength();
+            }
+        }
+        key.hasNumber = false;
+        key.number = 0;
+        if ( flags & YLineSort::Numeric ) {
+            int j = 0;
+            while ( j < key.length && !key.text[ j ].isDigit() )
+                ++j;
+            if ( j < key.length ) {
+                bool negative = j > 0 && key.text[ j - 1 ] == '-';
+                key.hasNumber = true;
+                for ( ; j < key.length && key.text[ j ].isDigit(); ++j ) {
+                    int digit = key.text[ j ].digitValue();
+                    // too many digits, the number stays the biggest one
+                    if ( key.number > (LLONG_MAX - digit) / 10 )
+                        key.number = LLONG_MAX;
+                    else
+                        key.number = key.number * 10 + digit;
+                }
+                if ( negative )
+                    key.number = -key.number;
+            }
+        }
+        keys->append( key );
+    }
+}
+
+/*
+ * True if the lines are equal, ignoring the case if @arg icase
+ */
+static bool sameLine( const QString& a, const QString& b, bool icase )
+{
+    if ( !icase || a.length() != b.length() )
+        return a == b;
+    for ( int i = 0; i < a.length(); ++i ) {
+        if ( a[ i ] != b[ i ] && a[ i ].toLower() != b[ i ].toLower() )
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Merges the sorted @arg a and @arg b, a first when equal so that the
+ * sort stays stable
+ */
+static YSortKeys mergeKeys( const YSortKeys& a, const YSortKeys& b, const YSortKeyCompare& lessThan )
+{
+    YSortKeys result;
+    result.reserve( a.count() + b.count() );
+    int i = 0, j = 0;
+    while ( i < a.count() && j < b.count() ) {
+        if ( lessThan( b[ j ], a[ i ] ) )
+            result.append( b[ j++ ] );
+        else
+            result.append( a[ i++ ] );
+    }
+    while ( i < a.count() )
+        result.append( a[ i++ ] );
+    while ( j < b.count() )
+        result.append( b[ j++ ] );
+    return result;
+}
+
+/**
+ * Computes and sorts the keys of a chunk of lines in its own thread.
+ * It has its own copy of the compiled regexp and only reads the lines.
+ */
+class YSortJob : public QThread
+{
+public:
+    YSortJob( const QVector<QString>& lines, int first, int last, YLineSort::Flags flags, const YRegExp* rx )
+            : mLines(lines), mFirst(first), mLast(last), mFlags(flags), mRx(rx ? new YRegExp(*rx) : NULL)
+    {}
+    virtual ~YSortJob()
+    {
+        delete mRx;
+    }
+
+    virtual void run()
+    {
+        makeKeys( mLines, mFirst, mLast, mFlags, mRx, &mKeys, &mUnmatched );
+        qStableSort( mKeys.begin(), mKeys.end(), YSortKeyCompare( mFlags ) );
+    }
+
+    YSortKeys& keys()
+    {
+        return mKeys;
+    }
+    const QVector<int>& unmatched() const
+    {
+        return mUnmatched;
+    }
+
+private:
+    const QVector<QString>& mLines;
+    int mFirst;
+    int mLast;
+    YLineSort::Flags mFlags;
+    YRegExp* mRx;
+    YSortKeys mKeys;
+    QVector<int> mUnmatched;
+};
+
+YLineSort::YLineSort( Flags flags, const QString& pattern )
+        : mFlags(flags), mPattern(pattern), mValid(true)
+{
+    if ( !mPattern.isEmpty() ) {
+        YRegExp rx( mPattern, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
+        mValid = rx.isValid();
+        mError = rx.errorString();
+    }
+}
+
+bool YLineSort::isValid() const
+{
+    return mValid;
+}
+
+QString YLineSort::errorString() const
+{
+    return mError;
+}
+
+QVector<int> YLineSort::sort( const QVector<QString>& lines ) const
+{
+    YSortKeyCompare lessThan( mFlags );
+    YRegExp* rx = NULL;
+    if ( !mPattern.isEmpty() ) {
+        rx = new YRegExp( mPattern, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
+        // compiles it here, the jobs only get copies of the compiled program
+        rx->isValid();
+    }
+
+    int nJobs = 1;
+#if QT_VERSION >= 0x040300
+    nJobs = qMin( QThread::idealThreadCount(), lines.count() / SORT_MIN_LINES_PER_JOB );
+#endif
+
+    YSortKeys keys;
+    QVector<int> unmatched;
+    if ( nJobs <= 1 ) {
+        makeKeys( lines, 0, lines.count(), mFlags, rx, &keys, &unmatched );
+        qStableSort( keys.begin(), keys.end(), lessThan );
+    } else {
+        QList<YSortJob*> jobs;
+        int chunk = (lines.count() + nJobs - 1) / nJobs;
+        for ( int first = 0; first < lines.count(); first += chunk ) {
+            YSortJob* job = new YSortJob( lines, first, qMin(first + chunk, lines.count()), mFlags, rx );
+            jobs << job;
+            job->start();
+        }
+        QList<YSortKeys> sorted;
+        foreach( YSortJob* job, jobs ) {
+            job->wait();
+            sorted << job->keys();
+            unmatched += job->unmatched();
+            delete job;
+        }
+        /* merge the chunks two by two, keeping their order for stability */
+        while ( sorted.count() > 1 ) {
+            QList<YSortKeys> merged;
+            for ( int i = 0; i < sorted.count(); i += 2 ) {
+                if ( i + 1 < sorted.count() )
+                    merged << mergeKeys( sorted[ i ], sorted[ i + 1 ], lessThan );
+                else
+                    merged << sorted[ i ];
+            }
+            sorted = merged;
+        }
+        keys = sorted.first();
+    }
+    delete rx;
+
+    /* the reverse order is the sorted one backwards, as in Vim */
+    QVector<int> order( unmatched.count() + keys.count() );
+    int n = 0;
+    foreach( int line, unmatched )
+        order[ n++ ] = line;
+    for ( int i = 0; i < keys.count(); ++i )
+        order[ n++ ] = keys[ i ].line;
+    if ( mFlags & Reverse ) {
+        for ( int i = 0; i < n / 2; ++i )
+            qSwap( order[ i ], order[ n - 1 - i ] );
+    }
+
+    /* the duplicates are whole lines, whatever the keys */
+    if ( mFlags & Unique && n > 0 ) {
+        bool icase = mFlags & IgnoreCase;
+        int kept = 1;
+        for ( int i = 1; i < n; ++i ) {
+            if ( !sameLine( lines[ order[ kept - 1 ] ], lines[ order[ i ] ], icase ) )
+                order[ kept++ ] = order[ i ];
+        }
+        order.resize( kept );
+    }
+    return order;
+}
+
@@ -0,0 +1,86 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+#ifndef YZ_LINESORT_H
+#define YZ_LINESORT_H
+
+/* Qt */
+#include <QString>
+#include <QVector>
+
+/* Yzis */
+#include "yzismacros.h"
+
+/**
+ * Line sorting, as done by :sort (see :help :sort).
+ *
+ * Only line indexes are sorted: the sort keys point inside the line
+ * strings, which are never copied. Large inputs are split in chunks
+ * sorted by several threads, then merged. The sort is stable.
+ */
+class YZIS_EXPORT YLineSort
+{
+public:
+    enum Flag {
+        Reverse = 1, //!< :sort!, the whole sorted order backwards
+        Numeric = 2, //!< n, sort on the first decimal number of the key
+        IgnoreCase = 4, //!< i
+        Unique = 8, //!< u, only keep the first of identical consecutive lines (whole lines, not keys)
+        MatchedText = 16, //!< r, the key is the text matched by the pattern, not what follows it
+    };
+    Q_DECLARE_FLAGS( Flags, Flag )
+
+    /**
+     * @arg pattern, in the Vim syntax, selects the key of each line:
+     * what follows the match, or the match itself with MatchedText.
+     * Without pattern, the key is the whole line.
+     */
+    YLineSort( Flags flags, const QString& pattern = QString() );
+
+    /**
+     * Returns true if the pattern is valid
+     */
+    bool isValid() const;
+
+    /**
+     * Why the pattern is not valid, see YRegExp::errorString
+     */
+    QString errorString() const;
+
+    /**
+     * Returns the order of @arg lines once sorted: the index in @arg lines
+     * of the first line, then of the second one...
+     * Lines which don't match the pattern keep their order, before the
+     * sorted lines (after them in reverse order for Reverse).
+     * With Unique, a line identical to the one before it in the sorted
+     * order (ignoring the case with IgnoreCase) is left out.
+     */
+    QVector<int> sort( const QVector<QString>& lines ) const;
+
+private:
+    Flags mFlags;
+    QString mPattern;
+    bool mValid;
+    QString mError;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS( YLineSort::Flags )
+
+#endif
+
@@ -29,6 +29,7 @@
 #include "internal_options.h"
 #include "events.h"
 #include "resourcemgr.h"
+#include "folding.h"
 
 #include "mode_ex.h"
 
@@ -91,6 +92,9 @@ void YLuaFuncs::registerLuaFuncs(lua_State *L)
     lua_register(L, "filename", filename);
     lua_register(L, "color", color);
     lua_register(L, "linecount", linecount);
+    lua_register(L, "foldlevel", foldlevel);
+    lua_register(L, "foldclosed", foldclosed);
+    lua_register(L, "foldclosedend", foldclosedend);
     lua_register(L, "sendkeys", sendkeys);
     lua_register(L, "highlight", highlight);
     lua_register(L, "connect", connect);
@@ -461,6 +465,49 @@ int YLuaFuncs::linecount(lua_State *L)
     return 1 ; // one result
 }
 
+int YLuaFuncs::foldlevel(lua_State *L)
+{
+    if (!YLuaEngine::checkFunctionArguments(L, 1, 1, "foldlevel", "line")) return 0;
+    int line = ( int )lua_tonumber( L, 1 );
+    lua_pop(L, 1);
+
+    YView* cView = YSession::self()->currentView();
+
+    lua_pushnumber( L, cView->folds()->level( line - 1 ) ); // first result
+    YASSERT_EQUALS( lua_gettop(L), 1 );
+    return 1 ; // one result
+}
+
+int YLuaFuncs::foldclosed(lua_State *L)
+{
+    if (!YLuaEngine::checkFunctionArguments(L, 1, 1, "foldclosed", "line")) return 0;
+    int line = ( int )lua_tonumber( L, 1 );
+    lua_pop(L, 1);
+
+    YView* cView = YSession::self()->currentView();
+    int from;
+    bool closed = cView->folds()->isInClosedFold( line - 1, &from );
+
+    lua_pushnumber( L, closed ? from + 1 : -1 ); // first result
+    YASSERT_EQUALS( lua_gettop(L), 1 );
+    return 1 ; // one result
+}
+
+int YLuaFuncs::foldclosedend(lua_State *L)
+{
+    if (!YLuaEngine::checkFunctionArguments(L, 1, 1, "foldclosedend", "line")) return 0;
+    int line = ( int )lua_tonumber( L, 1 );
+    lua_pop(L, 1);
+
+    YView* cView = YSession::self()->currentView();
+    int to;
+    bool closed = cView->folds()->isInClosedFold( line - 1, NULL, &to );
+
+    lua_pushnumber( L, closed ? to + 1 : -1 ); // first result
+    YASSERT_EQUALS( lua_gettop(L), 1 );
+    return 1 ; // one result
+}
+
 int YLuaFuncs::version( lua_State *L )
 {
     if (!YLuaEngine::checkFunctionArguments(L, 0, 0, "version", "")) return 0;
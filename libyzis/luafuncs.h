@@ -257,6 +257,41 @@ public:
      */
     static int linecount(lua_State *L);
 
+    /** \brief
+     * Returns the number of folds containing the given line of the
+     * current view.
+        *
+     * \b Arguments:
+     * - int, line number
+     *
+        * \b Returns: int, fold level of the line, 0 outside of the folds
+     */
+    static int foldlevel(lua_State *L);
+
+    /** \brief
+     * Returns the first line of the closed fold containing the given line
+     * of the current view.
+        *
+     * \b Arguments:
+     * - int, line number
+     *
+        * \b Returns: int, first line of the outermost closed fold, -1 if
+        * the line is not in a closed fold
+     */
+    static int foldclosed(lua_State *L);
+
+    /** \brief
+     * Returns the last line of the closed fold containing the given line
+     * of the current view.
+        *
+     * \b Arguments:
+     * - int, line number
+     *
+        * \b Returns: int, last line of the outermost closed fold, -1 if
+        * the line is not in a closed fold
+     */
+    static int foldclosedend(lua_State *L);
+
     /** \brief
      * Returns the yzis version string
         *
@@ -22,10 +22,7 @@
 #include "luaregexp.h"
 #include "luaengine.h"
 #include "debug.h"
-
-/* Qt */
-#include <QRegExp>
-
+#include "regexp.h"
 
 #define dbg()    yzDebug("YLuaRegexp")
 #define err()    yzError("YLuaRegexp")
@@ -51,6 +48,7 @@ void YLuaRegexp::registerLuaRegexp(lua_State * L)
     YLuaEngine::self()->print_lua_stack( L, "registerLuaRegexp - step 1" );
 
     lua_register(L, "Regexp_create", Regexp_create);
+    lua_register(L, "VimRegexp", VimRegexp_create);
     lua_register(L, "Regexp_matchIndex", Regexp_matchIndex);
     lua_register(L, "Regexp_match", Regexp_match);
     lua_register(L, "Regexp_setCaseSensitive", Regexp_setCaseSensitive);
@@ -109,6 +107,35 @@ int YLuaRegexp::Regexp_create(lua_State *L)
     lua_pop(L, 2);
     // stack: /
 
+    pushRegexp(L, new YRegExp(re));
+    YASSERT_EQUALS( lua_gettop(L), 1 );
+    return 1;
+}
+
+int YLuaRegexp::VimRegexp_create(lua_State *L)
+{
+    if (! YLuaEngine::checkFunctionArguments(L, 1, 1, "VimRegexp", "pattern")) return 0;
+    // stack: string
+    QString re = QString::fromUtf8( ( char * )lua_tostring ( L, -1 ) );
+    lua_pop(L, 1);
+    // stack: /
+
+    YRegExp* regexp = new YRegExp(re, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+    if ( ! regexp->isValid() ) {
+        QByteArray e = QString("VimRegexp(): invalid or unsupported pattern '%1': %2").arg(re).arg(regexp->errorString()).toUtf8();
+        delete regexp;
+        lua_pushstring(L, e.data());
+        lua_error(L);
+        return 0;
+    }
+
+    pushRegexp(L, regexp);
+    YASSERT_EQUALS( lua_gettop(L), 1 );
+    return 1;
+}
+
+void YLuaRegexp::pushRegexp(lua_State *L, YRegExp* regexp)
+{
     // create table
     lua_newtable( L );
     // stack: table
@@ -116,9 +143,9 @@ int YLuaRegexp::Regexp_create(lua_State *L)
     // store ud
     lua_pushstring( L, "qregexp*" );
     // stack: table, string="qregexp*"
-    QRegExp **pRegExp = (QRegExp **) lua_newuserdata(L, sizeof( QRegExp * ) ); // store the pointer as userdata
+    YRegExp **pRegExp = (YRegExp **) lua_newuserdata(L, sizeof( YRegExp * ) ); // store the pointer as userdata
     // stack: table, "qregexp*", userdata
-    *pRegExp = new QRegExp(re);
+    *pRegExp = regexp;
 
     // create userdata metatable and fill it
     lua_newtable( L );
@@ -143,9 +170,6 @@ int YLuaRegexp::Regexp_create(lua_State *L)
     // stack: table, table Regexp_mt
     lua_setmetatable(L, -2);
     // stack: table
-
-    YASSERT_EQUALS( lua_gettop(L), 1 );
-    return 1;
 }
 
 #define deepdbgf() yzDeepDebug("YLuaRegexp.Regexp_userdata_finalize")
@@ -156,8 +180,8 @@ int YLuaRegexp::Regexp_userdata_finalize(lua_State *L)
     if (! YLuaEngine::checkFunctionArguments(L, 1, 1, "Regexp.finalize", "Regexp object")) return 0;
 
     // stack: userdata
-    QRegExp ** pRegexp = (QRegExp **) lua_touserdata(L, -1);
-    QRegExp * regexp = *pRegexp;
+    YRegExp ** pRegexp = (YRegExp **) lua_touserdata(L, -1);
+    YRegExp * regexp = *pRegexp;
     lua_pop(L, 1);
     // stack: /
 
@@ -185,7 +209,7 @@ int YLuaRegexp::Regexp_match(lua_State *L)
     // stack: table, "qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
 
     lua_pop(L, 2);
     // stack: /
@@ -211,7 +235,7 @@ int YLuaRegexp::Regexp_matchIndex(lua_State *L)
     // stack: table, string="qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
     lua_pop(L, 2 );
     // stack: /
 
@@ -236,7 +260,7 @@ int YLuaRegexp::Regexp_setMinimal(lua_State *L)
     // stack: table, "qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
     lua_pop(L, 2);
     // stack: /
 
@@ -260,7 +284,7 @@ int YLuaRegexp::Regexp_setCaseSensitive(lua_State *L)
     // stack: table, "qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
     lua_pop(L, 2);
     // stack: /
 
@@ -284,7 +308,7 @@ int YLuaRegexp::Regexp_pos(lua_State *L)
     // stack: table, "qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
     lua_pop(L, 2);
     // stack: /
 
@@ -304,7 +328,7 @@ int YLuaRegexp::Regexp_numCaptures(lua_State *L)
     // stack: table, "qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
     lua_pop(L, 2);
     // stack: /
 
@@ -328,7 +352,7 @@ int YLuaRegexp::Regexp_captured(lua_State *L)
     // stack: table, "qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
     lua_pop(L, 2);
     // stack: /
 
@@ -354,7 +378,7 @@ int YLuaRegexp::Regexp_replace(lua_State *L)
     // stack: table, "qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
     lua_pop(L, 2);
     // stack: /
 
@@ -362,7 +386,7 @@ int YLuaRegexp::Regexp_replace(lua_State *L)
     dbg() << "regexp='" << regexp->pattern() << "'" << endl;
     dbg() << "replacement='" << replacement << "'" << endl;
 
-    s.replace( *regexp, replacement );
+    s = regexp->replace( s, replacement );
 
     dbg() << "After: s='" << s << "'" << endl;
 
@@ -383,7 +407,7 @@ int YLuaRegexp::Regexp_pattern(lua_State *L)
     // stack: table, "qregexp*"
     lua_gettable( L, -2);
     // stack: table, userdata
-    QRegExp * regexp = *((QRegExp **) lua_touserdata(L, -1));
+    YRegExp * regexp = *((YRegExp **) lua_touserdata(L, -1));
     lua_pop(L, 2);
     // stack: /
 
@@ -25,23 +25,27 @@ extern "C"
 #include <lua.h>
 }
 
+class YRegExp;
+
 /** \brief Regexp class for lua.
  *
  * Lua does not feature a builtin regexp support, so this class provides one.
- * The support is entirely based on Qt <a
- * href="http://doc.trolltech.com/4.2/qregexp.html">QRegexp</a>. We use lua
+ * The support is based on YRegExp, which uses the QRegExp syntax (matching
+ * is done by a linear-time engine whenever possible). We use lua
  * syntaxic sugar to build an object like interface on top of a table.
  *
  * See <a href="http://doc.trolltech.com/4.2/qregexp.html">QRegexp</a> for the
- * regexp syntax.
+ * regexp syntax. VimRegexp() creates the same object from a pattern written
+ * in the Vim syntax, compiled by the same code as the search and :substitute
+ * patterns (see YVimRegExp).
  *
  * Internally, we have a table with a metadata for creating the regexp
- * (overloading call), a userdata that stores a pointer to a QRegexp. When the
+ * (overloading call), a userdata that stores a pointer to a YRegExp. When the
  * Regexp is garbage-collected, Regexp_userdata_finalize() is called and the
  * pointer is deleted.
  *
  * All the methods of this class extract the arguments from the stack, extract
- * the QRegexp pointer, calls the appropriate method on QRegexp and return the
+ * the YRegExp pointer, calls the appropriate method on YRegExp and return the
  * result.
  *
  * The function registerLuaRegexp() registers all the other function to the
@@ -60,7 +64,7 @@ public:
      */
     static void registerLuaRegexp(lua_State *L);
 
-    /** \brief Create a regexp (based on QRegexp)
+    /** \brief Create a regexp (based on YRegExp)
            *
      * \b Arguments: 
            * - string: the regexp expression
@@ -76,6 +80,24 @@ public:
      */
     static int Regexp_create(lua_State *L);
 
+    /** \brief Create a regexp from a pattern in the Vim syntax
+           *
+     * \b Arguments: 
+           * - string: the Vim pattern
+           *
+     * \b Returns: a regexp object, with the same methods as the ones
+           * returned by Regexp(). An error is raised if the pattern is invalid
+           * or uses an unsupported item.
+           *
+           * <b>Lua code example</b>
+           * \code
+           * re = VimRegexp( '\\<my_re\\>' )
+           * assertEquals( (re:match('XX my_re')), true )
+           * assertEquals( (re:match('XXmy_re')), false )
+           * \endcode
+     */
+    static int VimRegexp_create(lua_State *L);
+
     /** \brief Match a regexp with a string.
            *
      * \b Argument: 
@@ -254,6 +276,11 @@ public:
      */
     static int Regexp_userdata_finalize(lua_State *L);
 
+private:
+    /** \brief Pushes a new regexp object wrapping @arg regexp on the stack
+     * and takes ownership of it.
+     */
+    static void pushRegexp(lua_State *L, YRegExp* regexp);
 };
 
 #endif // YZ_LUA_REGEXP
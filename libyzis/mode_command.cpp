@@ -31,6 +31,7 @@
 #include "action.h"
 #include "buffer.h"
 #include "cursor.h"
+#include "folding.h"
 #include "linesearch.h"
 #include "mark.h"
 #include "search.h"
@@ -169,6 +170,10 @@ void YModeCommand::initCommandPool()
     commands.append( new YCommand(YKeySequence("z+"), &YModeCommand::gotoLineAtTop) );
     commands.append( new YCommand(YKeySequence("z."), &YModeCommand::gotoLineAtCenter) );
     commands.append( new YCommand(YKeySequence("z-"), &YModeCommand::gotoLineAtBottom) );
+    commands.append( new YCommand(YKeySequence("zo"), &YModeCommand::foldOpen) );
+    commands.append( new YCommand(YKeySequence("zc"), &YModeCommand::foldClose) );
+    commands.append( new YCommand(YKeySequence("zR"), &YModeCommand::foldOpenAll) );
+    commands.append( new YCommand(YKeySequence("zM"), &YModeCommand::foldCloseAll) );
     commands.append( new YCommand(YKeySequence("dd"), &YModeCommand::deleteLine) );
     commands.append( new YCommand(YKeySequence("dG"), &YModeCommand::deleteToEndOfLastLine) );
     commands.append( new YCommand(YKeySequence("d"), &YModeCommand::del, ArgMotion) );
@@ -1588,6 +1593,35 @@ CmdState YModeCommand::gotoLineAtBottom(const YCommandArgs &args)
     return CmdOk;
 }
 
+CmdState YModeCommand::foldOpen(const YCommandArgs &args)
+{
+    YZFoldPool* folds = args.view->folds();
+    int line = args.view->currentLine();
+    line = folds->isHead(line) ? line : folds->lineHeadingFold(line);
+    folds->setOpened(line, line, true);
+    return CmdOk;
+}
+
+CmdState YModeCommand::foldClose(const YCommandArgs &args)
+{
+    YZFoldPool* folds = args.view->folds();
+    int line = args.view->currentLine();
+    line = folds->isHead(line) ? line : folds->lineHeadingFold(line);
+    folds->setOpened(line, line, false);
+    return CmdOk;
+}
+
+CmdState YModeCommand::foldOpenAll(const YCommandArgs &args)
+{
+    args.view->folds()->setAllOpened(true);
+    return CmdOk;
+}
+
+CmdState YModeCommand::foldCloseAll(const YCommandArgs &args)
+{
+    args.view->folds()->setAllOpened(false);
+    return CmdOk;
+}
 
 CmdState YModeCommand::gotoExMode(const YCommandArgs &args)
 {
@@ -271,6 +271,10 @@ public:
     CmdState gotoLineAtTop(const YCommandArgs &args);
     CmdState gotoLineAtCenter(const YCommandArgs &args);
     CmdState gotoLineAtBottom(const YCommandArgs &args);
+    CmdState foldOpen(const YCommandArgs &args);
+    CmdState foldClose(const YCommandArgs &args);
+    CmdState foldOpenAll(const YCommandArgs &args);
+    CmdState foldCloseAll(const YCommandArgs &args);
     CmdState insertAtSOL(const YCommandArgs &args);
     CmdState insertAtCol1(const YCommandArgs &args);
     CmdState gotoInsertMode(const YCommandArgs &args);
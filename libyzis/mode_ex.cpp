@@ -43,10 +43,16 @@
 #include "view.h"
 #include "viewcursor.h"
 #include "history.h"
+#include "line.h"
+#include "undo.h"
+#include "regexp.h"
+#include "linesort.h"
+#include "filter.h"
 
 /* Qt */
 #include <QFileInfo>
 #include <QDir>
+#include <QTextCodec>
 
 using namespace yzis;
 
@@ -63,6 +69,7 @@ YExCommandArgs::YExCommandArgs( YView* _view, const QString& _input, const QStri
     fromLine = _fromLine;
     toLine = _toLine;
     force = _force;
+    hasRange = false;
 }
 
 QString YExCommandArgs::toString() const
@@ -78,23 +85,18 @@ QString YExCommandArgs::toString() const
     return s;
 }
 
-YExRange::YExRange( const QString& regexp, ExRangeMethod pm )
+YExCommand::YExCommand( const QString& name, ExPoolMethod pm, const QStringList& longName )
 {
-    mKeySeq = regexp;
-    mPoolMethod = pm;
-    mRegexp = QRegExp( "^(" + mKeySeq + ")([+\\-]\\d*)?(.*)$" );
-}
-
-YExCommand::YExCommand( const QString& input, ExPoolMethod pm, const QStringList& longName, bool word )
-{
-    mKeySeq = input;
-    mPoolMethod = pm;
-    mLongName = longName;
-    if ( word ) {
-        mRegexp = QRegExp( "^(" + mKeySeq + ")(\\b.*)?$" );
+    int bracket = name.indexOf( '[' );
+    if ( bracket == -1 ) {
+        mKeySeq = name;
+        mAbbreviation = name;
     } else {
-        mRegexp = QRegExp( "^(" + mKeySeq + ")([\\w\\s].*)?$" );
+        mAbbreviation = name.left( bracket );
+        mKeySeq = mAbbreviation + name.mid( bracket + 1, name.length() - bracket - 2 );
     }
+    mPoolMethod = pm;
+    mLongName = longName;
 }
 
 YModeEx::YModeEx() : YMode()
@@ -103,21 +105,19 @@ YModeEx::YModeEx() : YMode()
     mString = _("[ Ex ]");
     mMapMode = MapCmdline;
     commands.clear();
-    ranges.clear();
     mHistory = new YZHistory;
     mCompletePossibilities.clear();
     mCurrentCompletionProposal = 0;
     mIsEditMode = false;
     mIsCmdLineMode = true;
     mIsSelMode = false;
+    mInsideGlobal = false;
 }
 
 YModeEx::~YModeEx()
 {
     foreach( const YExCommand *c, commands )
     delete c;
-    foreach( const YExRange *r, ranges )
-    delete r;
 
     delete mHistory;
 }
@@ -331,111 +331,203 @@ const QStringList YModeEx::extractCommandNames()
 
 void YModeEx::initPool()
 {
-    // ranges
-    ranges.push_back( new YExRange( "\\d+", &YModeEx::rangeLine ) );
-    ranges.push_back( new YExRange( "\\.", &YModeEx::rangeCurrentLine ) );
-    ranges.push_back( new YExRange( "\\$", &YModeEx::rangeLastLine ) );
-    ranges.push_back( new YExRange( "'\\w", &YModeEx::rangeMark ) );
-    ranges.push_back( new YExRange( "'[<>]", &YModeEx::rangeVisual ) );
-    ranges.push_back( new YExRange( "/([^/]*/)?", &YModeEx::rangeSearch ) );
-    ranges.push_back( new YExRange( "\\?([^\\?]*\\?)?", &YModeEx::rangeSearch ) );
-
     // commands
-    commands.push_back( new YExCommand( "(x|wq?)(a(ll)?)?", &YModeEx::write ) );
-    commands.push_back( new YExCommand( "w(rite)?", &YModeEx::write , QStringList("write") ));
-    commands.push_back( new YExCommand( "q(uit|a(ll)?)?", &YModeEx::quit, QString("quit:qall").split(":") ) );
-    commands.push_back( new YExCommand( "bf(irst)?", &YModeEx::bufferfirst, QStringList("bfirst") ) );
-    commands.push_back( new YExCommand( "bl(ast)?", &YModeEx::bufferlast, QStringList("blast") ) );
-    commands.push_back( new YExCommand( "bn(ext)?", &YModeEx::buffernext, QStringList("bnext") ) );
-    commands.push_back( new YExCommand( "bp(revious)?", &YModeEx::bufferprevious, QStringList("bprevious") ) );
-    commands.push_back( new YExCommand( "bd(elete)?", &YModeEx::bufferdelete, QStringList("bdelete") ) );
-    commands.push_back( new YExCommand( "e(dit)?", &YModeEx::edit, QStringList("edit") ) );
+    commands.push_back( new YExCommand( "x[it]", &YModeEx::write ) );
+    commands.push_back( new YExCommand( "xa[ll]", &YModeEx::write ) );
+    commands.push_back( new YExCommand( "wq", &YModeEx::write ) );
+    commands.push_back( new YExCommand( "wqa[ll]", &YModeEx::write ) );
+    commands.push_back( new YExCommand( "wa[ll]", &YModeEx::write ) );
+    commands.push_back( new YExCommand( "w[rite]", &YModeEx::write , QStringList("write") ));
+    commands.push_back( new YExCommand( "q[uit]", &YModeEx::quit, QStringList("quit") ) );
+    commands.push_back( new YExCommand( "qa[ll]", &YModeEx::quit, QStringList("qall") ) );
+    commands.push_back( new YExCommand( "bf[irst]", &YModeEx::bufferfirst, QStringList("bfirst") ) );
+    commands.push_back( new YExCommand( "bl[ast]", &YModeEx::bufferlast, QStringList("blast") ) );
+    commands.push_back( new YExCommand( "bn[ext]", &YModeEx::buffernext, QStringList("bnext") ) );
+    commands.push_back( new YExCommand( "bp[revious]", &YModeEx::bufferprevious, QStringList("bprevious") ) );
+    commands.push_back( new YExCommand( "bd[elete]", &YModeEx::bufferdelete, QStringList("bdelete") ) );
+    commands.push_back( new YExCommand( "e[dit]", &YModeEx::edit, QStringList("edit") ) );
     commands.push_back( new YExCommand( "mkyzisrc", &YModeEx::mkyzisrc, QStringList("mkyzisrc") ) );
-    commands.push_back( new YExCommand( "se(t)?", &YModeEx::set, QStringList("set") ) );
-    commands.push_back( new YExCommand( "setl(ocal)?", &YModeEx::set, QStringList("setlocal") ) );
-    commands.push_back( new YExCommand( "setg(lobal)?", &YModeEx::set, QStringList("setglobal") ) );
-    commands.push_back( new YExCommand( "s(ubstitute)?", &YModeEx::substitute, QStringList("substitute") ) );
-    commands.push_back( new YExCommand( "hardcopy", &YModeEx::hardcopy, QStringList("hardcopy") ) );
-    commands.push_back( new YExCommand( "visual", &YModeEx::gotoCommandMode, QStringList("visual") ) );
-    commands.push_back( new YExCommand( "preserve", &YModeEx::preserve, QStringList("preserve") ) );
+    commands.push_back( new YExCommand( "se[t]", &YModeEx::set, QStringList("set") ) );
+    commands.push_back( new YExCommand( "setl[ocal]", &YModeEx::set, QStringList("setlocal") ) );
+    commands.push_back( new YExCommand( "setg[lobal]", &YModeEx::set, QStringList("setglobal") ) );
+    commands.push_back( new YExCommand( "s[ubstitute]", &YModeEx::substitute, QStringList("substitute") ) );
+    commands.push_back( new YExCommand( "g[lobal]", &YModeEx::global, QStringList("global") ) );
+    commands.push_back( new YExCommand( "v[global]", &YModeEx::global, QStringList("vglobal") ) );
+    commands.push_back( new YExCommand( "d[elete]", &YModeEx::deleteLines, QStringList("delete") ) );
+    commands.push_back( new YExCommand( "sor[t]", &YModeEx::sort, QStringList("sort") ) );
+    commands.push_back( new YExCommand( "!", &YModeEx::filter ) );
+    commands.push_back( new YExCommand( "ha[rdcopy]", &YModeEx::hardcopy, QStringList("hardcopy") ) );
+    commands.push_back( new YExCommand( "vi[sual]", &YModeEx::gotoCommandMode, QStringList("visual") ) );
+    commands.push_back( new YExCommand( "pre[serve]", &YModeEx::preserve, QStringList("preserve") ) );
     commands.push_back( new YExCommand( "lua", &YModeEx::lua, QStringList("lua" )) );
-    commands.push_back( new YExCommand( "source", &YModeEx::source, QStringList("source") ) );
+    commands.push_back( new YExCommand( "so[urce]", &YModeEx::source, QStringList("source") ) );
     commands.push_back( new YExCommand( "map", &YModeEx::map, QStringList("map") ) );
-    commands.push_back( new YExCommand( "unmap", &YModeEx::unmap, QStringList("unmap") ) );
-    commands.push_back( new YExCommand( "imap", &YModeEx::imap, QStringList("imap") ) );
-    commands.push_back( new YExCommand( "iunmap", &YModeEx::iunmap, QStringList("iunmap") ) );
-    commands.push_back( new YExCommand( "vmap", &YModeEx::vmap, QStringList("vmap") ) );
-    commands.push_back( new YExCommand( "vunmap", &YModeEx::vunmap, QStringList("vunmap") ) );
-    commands.push_back( new YExCommand( "omap", &YModeEx::omap, QStringList("omap") ) );
-    commands.push_back( new YExCommand( "ounmap", &YModeEx::ounmap, QStringList("ounmap") ) );
-    commands.push_back( new YExCommand( "nmap", &YModeEx::nmap, QStringList("nmap") ) );
-    commands.push_back( new YExCommand( "nunmap", &YModeEx::nunmap, QStringList("nunmap") ) );
-    commands.push_back( new YExCommand( "cmap", &YModeEx::cmap, QStringList("cmap") ) );
-    commands.push_back( new YExCommand( "cunmap", &YModeEx::cunmap, QStringList("cunmap") ) );
-    commands.push_back( new YExCommand( "noremap", &YModeEx::noremap, QStringList("noremap") ) );
-    commands.push_back( new YExCommand( "nnoremap", &YModeEx::nnoremap, QStringList("nnoremap") ) );
-    commands.push_back( new YExCommand( "vnoremap", &YModeEx::vnoremap, QStringList("vnoremap") ) );
-    commands.push_back( new YExCommand( "inoremap", &YModeEx::inoremap, QStringList("inoremap") ) );
-    commands.push_back( new YExCommand( "cnoremap", &YModeEx::cnoremap, QStringList("cnoremap") ) );
-    commands.push_back( new YExCommand( "onoremap", &YModeEx::onoremap, QStringList("onoremap") ) );
-    commands.push_back( new YExCommand( "[<>]", &YModeEx::indent, QStringList(), false ));
-    commands.push_back( new YExCommand( "ene(w)?", &YModeEx::enew, QStringList("enew") ));
-    commands.push_back( new YExCommand( "syn(tax)?", &YModeEx::syntax, QStringList("syntax")));
-    commands.push_back( new YExCommand( "highlight", &YModeEx::highlight, QStringList("highlight") ));
-    commands.push_back( new YExCommand( "reg(isters)", &YModeEx::registers, QStringList("registers" ) ));
-    commands.push_back( new YExCommand( "split", &YModeEx::split, QStringList("split") ));
+    commands.push_back( new YExCommand( "unm[ap]", &YModeEx::unmap, QStringList("unmap") ) );
+    commands.push_back( new YExCommand( "im[ap]", &YModeEx::imap, QStringList("imap") ) );
+    commands.push_back( new YExCommand( "iu[nmap]", &YModeEx::iunmap, QStringList("iunmap") ) );
+    commands.push_back( new YExCommand( "vm[ap]", &YModeEx::vmap, QStringList("vmap") ) );
+    commands.push_back( new YExCommand( "vu[nmap]", &YModeEx::vunmap, QStringList("vunmap") ) );
+    commands.push_back( new YExCommand( "om[ap]", &YModeEx::omap, QStringList("omap") ) );
+    commands.push_back( new YExCommand( "ou[nmap]", &YModeEx::ounmap, QStringList("ounmap") ) );
+    commands.push_back( new YExCommand( "nm[ap]", &YModeEx::nmap, QStringList("nmap") ) );
+    commands.push_back( new YExCommand( "nun[map]", &YModeEx::nunmap, QStringList("nunmap") ) );
+    commands.push_back( new YExCommand( "cm[ap]", &YModeEx::cmap, QStringList("cmap") ) );
+    commands.push_back( new YExCommand( "cu[nmap]", &YModeEx::cunmap, QStringList("cunmap") ) );
+    commands.push_back( new YExCommand( "no[remap]", &YModeEx::noremap, QStringList("noremap") ) );
+    commands.push_back( new YExCommand( "nn[oremap]", &YModeEx::nnoremap, QStringList("nnoremap") ) );
+    commands.push_back( new YExCommand( "vn[oremap]", &YModeEx::vnoremap, QStringList("vnoremap") ) );
+    commands.push_back( new YExCommand( "ino[remap]", &YModeEx::inoremap, QStringList("inoremap") ) );
+    commands.push_back( new YExCommand( "cno[remap]", &YModeEx::cnoremap, QStringList("cnoremap") ) );
+    commands.push_back( new YExCommand( "ono[remap]", &YModeEx::onoremap, QStringList("onoremap") ) );
+    commands.push_back( new YExCommand( "<", &YModeEx::indent ));
+    commands.push_back( new YExCommand( ">", &YModeEx::indent ));
+    commands.push_back( new YExCommand( "ene[w]", &YModeEx::enew, QStringList("enew") ));
+    commands.push_back( new YExCommand( "sy[ntax]", &YModeEx::syntax, QStringList("syntax")));
+    commands.push_back( new YExCommand( "hi[ghlight]", &YModeEx::highlight, QStringList("highlight") ));
+    commands.push_back( new YExCommand( "reg[isters]", &YModeEx::registers, QStringList("registers" ) ));
+    commands.push_back( new YExCommand( "sp[lit]", &YModeEx::split, QStringList("split") ));
     commands.push_back( new YExCommand( "cd", &YModeEx::cd, QStringList("cd") ));
-    commands.push_back( new YExCommand( "pwd", &YModeEx::pwd, QStringList("pwd") ));
-    commands.push_back( new YExCommand( "tag", &YModeEx::tag, QStringList("tag") ));
-    commands.push_back( new YExCommand( "po(p)?", &YModeEx::pop, QStringList("pop") ));
-    commands.push_back( new YExCommand( "tn(ext)?", &YModeEx::tagnext, QStringList("tnext") ));
-    commands.push_back( new YExCommand( "tp(revious)?", &YModeEx::tagprevious, QStringList("tprevious") ));
-    commands.push_back( new YExCommand( "ret(ab)?", &YModeEx::retab, QStringList("retab") ));
+    commands.push_back( new YExCommand( "pw[d]", &YModeEx::pwd, QStringList("pwd") ));
+    commands.push_back( new YExCommand( "ta[g]", &YModeEx::tag, QStringList("tag") ));
+    commands.push_back( new YExCommand( "po[p]", &YModeEx::pop, QStringList("pop") ));
+    commands.push_back( new YExCommand( "tn[ext]", &YModeEx::tagnext, QStringList("tnext") ));
+    commands.push_back( new YExCommand( "tp[revious]", &YModeEx::tagprevious, QStringList("tprevious") ));
+    commands.push_back( new YExCommand( "ret[ab]", &YModeEx::retab, QStringList("retab") ));
 
     // folding
-    commands.push_back( new YExCommand( "fo(ld)?", &YModeEx::foldCreate, QStringList("fold") ));
+    commands.push_back( new YExCommand( "fo[ld]", &YModeEx::foldCreate, QStringList("fold") ));
+    commands.push_back( new YExCommand( "foldo[pen]", &YModeEx::foldOpen, QStringList("foldopen") ));
+    commands.push_back( new YExCommand( "foldc[lose]", &YModeEx::foldClose, QStringList("foldclose") ));
+
+    /* every abbreviation of a command, from the shortest one to its full
+     * name, is put in the table. A full name always gives its own command,
+     * otherwise the first registered command wins. */
+    mCommandTable.clear();
+    foreach( const YExCommand *c, commands )
+    mCommandTable[ c->keySeq() ] = c;
+    foreach( const YExCommand *c, commands ) {
+        for ( int len = c->abbreviation().length(); len < c->keySeq().length(); ++len ) {
+            QString abbrev = c->keySeq().left( len );
+            if ( !mCommandTable.contains( abbrev ) )
+                mCommandTable[ abbrev ] = c;
+            else
+                dbg() << "initPool: " << abbrev << " already used by " << mCommandTable[ abbrev ]->keySeq() << endl;
+        }
+    }
 }
 
+/*
+ * Parses the line address (see :help cmdline-ranges) at the beginning of
+ * @arg inputs, and returns what follows it.
+ */
 QString YModeEx::parseRange( const QString& inputs, YView* view, int* range, bool* matched )
 {
-    QString _input = inputs;
+    int len = inputs.length();
+    int pos = 0;
+    ExRangeMethod method = NULL;
+    QString arg;
+
     *matched = false;
-    foreach( const YExRange *currentRange, ranges ) {
-        QRegExp reg( currentRange->regexp() );
-        *matched = reg.exactMatch( _input );
-        if ( *matched ) {
-            unsigned int nc = reg.numCaptures();
-            *range = (this->*( currentRange->poolMethod() )) (YExRangeArgs( currentRange, view, reg.cap( 1 ) ));
-            QString s_add = reg.cap( nc - 1 );
-            dbg() << "matched " << currentRange->keySeq() << ": " << *range << " and " << s_add << endl;
-            if ( s_add.length() > 0 ) { // a range can be followed by +/-nb
-                int add = 1;
-                if ( s_add.length() > 1 ) add = s_add.mid( 1 ).toUInt();
-                if ( s_add[ 0 ] == '-' ) add = -add;
-                *range += add;
-            }
-            return reg.cap( nc );
+    if ( len == 0 )
+        return inputs;
+
+    QChar c = inputs[ 0 ];
+    if ( c.isDigit() ) {
+        while ( pos < len && inputs[ pos ].isDigit() )
+            ++pos;
+        method = &YModeEx::rangeLine;
+    } else if ( c == '.' ) {
+        pos = 1;
+        method = &YModeEx::rangeCurrentLine;
+    } else if ( c == '$' ) {
+        pos = 1;
+        method = &YModeEx::rangeLastLine;
+    } else if ( c == '\'' && len > 1 ) {
+        QChar mark = inputs[ 1 ];
+        if ( mark == '<' || mark == '>' ) {
+            pos = 2;
+            method = &YModeEx::rangeVisual;
+        } else if ( mark.isLetterOrNumber() || mark == '_' ) {
+            pos = 2;
+            method = &YModeEx::rangeMark;
+        }
+    } else if ( c == '/' || c == '?' ) {
+        // the pattern ends at the first unescaped separator, or at the end
+        pos = 1;
+        while ( pos < len && inputs[ pos ] != c ) {
+            if ( inputs[ pos ] == '\\' )
+                ++pos;
+            ++pos;
+        }
+        pos = qMin( pos, len );
+        if ( pos == 1 ) {
+            // empty pattern, replays the last search
+            arg = c;
+        } else {
+            arg = inputs.left( pos ) + c;
         }
+        if ( pos < len )
+            ++pos;
+        method = &YModeEx::rangeSearch;
+    } else if ( c == '+' || c == '-' ) {
+        // an offset alone is relative to the current line
+        method = &YModeEx::rangeCurrentLine;
     }
-    return _input;
+    if ( method == NULL )
+        return inputs;
+
+    if ( arg.isNull() )
+        arg = inputs.left( pos );
+    *range = (this->*method)( YExRangeArgs( view, arg ) );
+    *matched = true;
+
+    // a range can be followed by +/-nb
+    while ( pos < len && (inputs[ pos ] == '+' || inputs[ pos ] == '-') ) {
+        bool minus = inputs[ pos ] == '-';
+        int start = ++pos;
+        while ( pos < len && inputs[ pos ].isDigit() )
+            ++pos;
+        int add = pos > start ? inputs.mid( start, pos - start ).toInt() : 1;
+        if ( *range != -1 )
+            *range += minus ? -add : add;
+    }
+    dbg() << "parseRange: " << inputs.left( pos ) << " is line " << *range << endl;
+    return inputs.mid( pos );
 }
 
+/*
+ * Finds the command at the beginning of @arg inputs. Command names are made
+ * of letters, except the one character ones like "<".
+ */
+const YExCommand* YModeEx::findCommand( const QString& inputs, QString* name, QString* arg ) const
+{
+    int len = 1;
+    if ( inputs[ 0 ].isLetter() ) {
+        while ( len < inputs.length() && inputs[ len ].isLetter() )
+            ++len;
+    }
+    *name = inputs.left( len );
+    *arg = inputs.mid( len );
+    return mCommandTable.value( *name, NULL );
+}
 
 CmdState YModeEx::execExCommand( YView* view, const QString& inputs )
 {
     CmdState ret = CmdError;
     bool matched;
-    bool commandIsValid = false;
     int from, to, current;
+    bool hasRange;
     QString _input = inputs.trimmed();
     dbg() << "ExCommand: " << _input << endl;
-    _input = _input.replace( QRegExp( "^%" ), "1,$" );
+    if ( _input.startsWith( '%' ) )
+        _input.replace( 0, 1, "1,$" );
     // range
-    current = from = to = rangeCurrentLine( YExRangeArgs( NULL, view, "." ) );
+    current = from = to = rangeCurrentLine( YExRangeArgs( view, "." ) );
 
     _input = parseRange( _input, view, &from, &matched );
+    hasRange = matched;
     if ( matched ) to = from;
-    if ( matched && _input[ 0 ] == ',' ) {
+    if ( matched && _input.startsWith( ',' ) ) {
         _input = _input.mid( 1 );
         dbg() << "ExCommand : still " << _input << endl;
         _input = parseRange( _input, view, &to, &matched );
@@ -450,26 +542,28 @@ CmdState YModeEx::execExCommand( YView* view, const QString& inputs )
         dbg() << "ExCommand : ERROR! < 0 range" << endl;
         return ret;
     }
-
-    matched = false;
-    foreach( const YExCommand *curCommand, commands ) {
-        QRegExp reg(curCommand->regexp());
-        matched = reg.exactMatch( _input );
-        if ( matched ) {
-            unsigned int nc = reg.numCaptures();
-            dbg() << "matched " << curCommand->keySeq() << " " << reg.cap( 1 ) << "," << reg.cap( nc ) << endl;
-            QString arg = reg.cap( nc );
-            bool force = arg[ 0 ] == '!';
-            if ( force ) arg = arg.mid( 1 );
-            ret = (this->*( curCommand->poolMethod() )) (YExCommandArgs( view, _input, reg.cap( 1 ), arg.trimmed(), from, to, force ) );
-            commandIsValid = true;
-        }
+    if ( to >= view->buffer()->lineCount() ) {
+        YSession::self()->guiPopupMessage( _("Invalid range") );
+        return ret;
     }
+
     if ( _input.length() == 0 ) {
 		view->gotoViewCursor(view->viewCursorFromLinePosition(view->buffer()->firstNonBlankChar(to), to));
-    } else if ( !commandIsValid ) {
+        return ret;
+    }
+
+    QString name, arg;
+    const YExCommand* command = findCommand( _input, &name, &arg );
+    if ( command == NULL ) {
         YSession::self()->guiPopupMessage( _("Not an editor command: ") + _input);
+        return ret;
     }
+    dbg() << "matched " << command->keySeq() << " " << name << "," << arg << endl;
+    bool force = arg.startsWith( '!' );
+    if ( force ) arg = arg.mid( 1 );
+    YExCommandArgs args( view, _input, name, arg.trimmed(), from, to, force );
+    args.hasRange = hasRange;
+    ret = (this->*( command->poolMethod() )) ( args );
 
     return ret;
 }
@@ -782,47 +876,322 @@ CmdState YModeEx::mkyzisrc ( const YExCommandArgs& args )
     return CmdOk;
 }
 
-CmdState YModeEx::substitute( const YExCommandArgs& args )
+/*
+ * Splits a :s command into its pattern, replacement and flags. Without
+ * pattern, the last search pattern is used and false is returned
+ */
+static bool parseSubstitute( const QString& input, QString* search, QString* replace, QString* options )
 {
-    unsigned int idx = args.input.indexOf("substitute");
-    unsigned int len = 10;
-    if (static_cast<unsigned int>( -1) == idx) {
-        idx = args.input.indexOf("s");
-        len = 1;
-    }
-    unsigned int idxb, idxc;
-    unsigned int tidx = idx + len;
+    // skips the command name, whatever its abbreviation
+    unsigned int idx, idxb, idxc;
+    unsigned int tidx = 0;
+    while (tidx < static_cast<unsigned int>( input.length() ) && input.at(tidx).isLetter())
+        tidx++;
     QChar c;
-    while ((c = args.input.at(tidx)).isSpace())
+    while ((c = input.at(tidx)).isSpace())
         tidx++;
-    idx = args.input.indexOf(c, tidx);
-    idxb = args.input.indexOf(c, idx + 1);
-    idxc = args.input.indexOf(c, idxb + 1);
-    QString search = args.input.mid( idx + 1, idxb - idx - 1 );
-    QString replace = args.input.mid( idxb + 1, idxc - idxb - 1 );
-    QString options = args.input.mid( idxc + 1 );
-
-    bool needsUpdate = false;
-    bool found;
-    if ( options.contains( "i" ) && !search.endsWith( "\\c" ) ) {
-        search.append("\\c");
+    idx = input.indexOf(c, tidx);
+    idxb = input.indexOf(c, idx + 1);
+    idxc = input.indexOf(c, idxb + 1);
+    *search = input.mid( idx + 1, idxb - idx - 1 );
+    *replace = input.mid( idxb + 1, idxc - idxb - 1 );
+    *options = input.mid( idxc + 1 );
+
+    bool given = !search->isEmpty();
+    if ( !given ) {
+        *search = YSession::self()->search()->currentSearch();
     }
-    int lastLine = 0;
-    YCursor start( 0, args.fromLine );
-    YSession::self()->search()->forward( args.view->buffer(), search, &found, start );
-    if ( found ) {
-        for ( uint i = args.fromLine; i <= args.toLine; i++ ) {
-            if ( args.view->buffer()->substitute( search, replace, options.contains( "g" ), i ) ) {
-                needsUpdate = true;
-                lastLine = i;
+    if ( !search->isEmpty() && options->contains( "i" ) && !search->endsWith( "\\c" ) ) {
+        search->append("\\c");
+    }
+    return given;
+}
+
+CmdState YModeEx::substitute( const YExCommandArgs& args )
+{
+    QString search, replace, options;
+    bool given = parseSubstitute( args.input, &search, &replace, &options );
+    if ( search.isEmpty() ) {
+        YSession::self()->guiPopupMessage( _("No previous regular expression") );
+        return CmdError;
+    }
+    YRegExp rx( search, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
+    if ( !rx.isValid() ) {
+        YSession::self()->guiPopupMessage( rx.errorString() );
+        return CmdError;
+    }
+
+    /* the pattern becomes the last search pattern, no need to look for a
+     * first match: the substitution itself tells whether something matched */
+    if ( given ) {
+        YSession::self()->search()->setCurrentSearch( search );
+    }
+    int lastLine = args.view->buffer()->substitute( search, replace, options.contains( "g" ), args.fromLine, args.toLine );
+    if ( lastLine != -1 ) {
+        args.view->commitNextUndo();
+        args.view->gotoLinePosition(lastLine, args.view->buffer()->firstNonBlankChar(lastLine));
+    }
+
+    return CmdOk;
+}
+
+CmdState YModeEx::global( const YExCommandArgs& args )
+{
+    YBuffer* buffer = args.view->buffer();
+    if ( mInsideGlobal ) {
+        YSession::self()->guiPopupMessage( _("Cannot do :global recursive") );
+        return CmdError;
+    }
+    // :g! and :v run the command on the lines which don't match
+    bool invert = args.force || args.cmd.startsWith( 'v' );
+
+    /* pattern, it ends at the first unescaped separator */
+    if ( args.arg.isEmpty() ) {
+        YSession::self()->guiPopupMessage( _("Regular expression missing from :global") );
+        return CmdError;
+    }
+    QChar sep = args.arg[ 0 ];
+    int end = 1;
+    while ( end < args.arg.length() && args.arg[ end ] != sep ) {
+        if ( args.arg[ end ] == '\\' )
+            ++end;
+        ++end;
+    }
+    QString pattern = args.arg.mid( 1, end - 1 );
+    QString command = args.arg.mid( end + 1 ).trimmed();
+    if ( pattern.isEmpty() )
+        pattern = YSession::self()->search()->currentSearch();
+
+    YRegExp rx( pattern, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
+    if ( !rx.isValid() ) {
+        YSession::self()->guiPopupMessage( rx.errorString() );
+        return CmdError;
+    }
+    YSession::self()->search()->setCurrentSearch( pattern );
+
+    // the default range of :global is the whole buffer
+    int from = args.hasRange ? args.fromLine : 0;
+    int to = args.hasRange ? args.toLine : buffer->lineCount() - 1;
+    to = qMin( to, buffer->lineCount() - 1 );
+
+    /* mark the lines in one scan. The mark is stored on the line itself,
+     * so it follows the line whatever the command does around it */
+    int nMarked = 0;
+    int lastMarked = -1;
+    for ( int i = from; i <= to; ++i ) {
+        bool marked = ( rx.indexIn( buffer->textline( i ) ) != -1 ) != invert;
+        buffer->yzline( i )->setMarked( marked );
+        if ( marked ) {
+            ++nMarked;
+            lastMarked = i;
+        }
+    }
+    if ( nMarked == 0 ) {
+        args.view->displayInfo( _("Pattern not found: ") + pattern );
+        return CmdOk;
+    }
+
+    CmdState ret = CmdOk;
+    int cursorLine = lastMarked;
+    QString subName, subArg;
+    const YExCommand* subCommand = command.isEmpty() ? NULL : findCommand( command, &subName, &subArg );
+    if ( subCommand && subCommand->poolMethod() == &YModeEx::deleteLines && subArg.isEmpty() ) {
+        /* :g/pat/d, all the marked lines go away in one transaction */
+        QString lastDeleted = buffer->textline( lastMarked );
+        buffer->deleteMarkedLines( from, to );
+        YSession::self()->setRegister( '"', QStringList() << QString() << lastDeleted << QString() );
+        cursorLine = qMin( lastMarked - nMarked + 1, buffer->lineCount() - 1 );
+    } else if ( subCommand && subCommand->poolMethod() == &YModeEx::substitute && !subArg.isEmpty() ) {
+        /* :g/pat/s//rep/, one substitution restricted to the marked lines */
+        QString search, replace, options;
+        if ( parseSubstitute( command, &search, &replace, &options ) )
+            YSession::self()->search()->setCurrentSearch( search );
+        YRegExp subRx( search, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
+        if ( !subRx.isValid() ) {
+            YSession::self()->guiPopupMessage( subRx.errorString() );
+            ret = CmdError;
+        }
+        int lastLine = buffer->substitute( search, replace, options.contains( "g" ), from, to, true );
+        for ( int i = from; i <= to; ++i )
+            buffer->yzline( i )->setMarked( false );
+        if ( lastLine != -1 )
+            cursorLine = lastLine;
+    } else if ( !command.isEmpty() ) {
+        /* any other command is run on each marked line, as one undo item */
+        mInsideGlobal = true;
+        buffer->undoBuffer()->beginGroup();
+        int line = from;
+        int done = 0;
+        while ( line < buffer->lineCount() ) {
+            YLine* yl = buffer->yzline( line );
+            if ( !yl->isMarked() ) {
+                ++line;
+                continue;
             }
+            yl->setMarked( false );
+            args.view->gotoLinePosition( line, 0 );
+            int count = buffer->lineCount();
+            ret = execExCommand( args.view, command );
+            if ( ret == CmdError || ret == CmdQuit || (++done % 256 == 0 && YSession::self()->processPendingEvents()) )
+                break;
+            /* the lines deleted above the current one moved the marked lines up */
+            line = qMax( 0, qMin( line, line + buffer->lineCount() - count ) );
         }
-        if ( needsUpdate ) {
-            args.view->commitNextUndo();
-			args.view->gotoLinePosition(lastLine, args.view->buffer()->firstNonBlankChar(lastLine));
+        if ( YSession::self()->isInterrupted() ) {
+            YSession::self()->resetInterrupt();
+            args.view->displayInfo( _("Interrupted") );
         }
+        // an aborted :global leaves no mark behind
+        for ( ; line < buffer->lineCount(); ++line )
+            buffer->yzline( line )->setMarked( false );
+        buffer->undoBuffer()->endGroup();
+        mInsideGlobal = false;
+        if ( ret == CmdQuit )
+            return ret;
+        cursorLine = args.view->getLinePositionCursor().y();
+    } else {
+        for ( int i = from; i <= to; ++i )
+            buffer->yzline( i )->setMarked( false );
     }
 
+    args.view->commitNextUndo();
+    args.view->gotoLinePosition( cursorLine, buffer->firstNonBlankChar( cursorLine ) );
+    return ret;
+}
+
+CmdState YModeEx::deleteLines( const YExCommandArgs& args )
+{
+    QList<QChar> regs;
+    regs << ( args.arg.isEmpty() ? QChar('"') : args.arg[ 0 ] );
+    args.view->buffer()->action()->deleteLine( args.view, args.fromLine, args.toLine - args.fromLine + 1, regs );
+    args.view->commitNextUndo();
+    return CmdOk;
+}
+
+CmdState YModeEx::sort( const YExCommandArgs& args )
+{
+    YBuffer* buffer = args.view->buffer();
+    YLineSort::Flags flags = 0;
+    if ( args.force )
+        flags |= YLineSort::Reverse;
+
+    /* options and optional /pattern/ */
+    QString pattern;
+    for ( int i = 0; i < args.arg.length(); ++i ) {
+        QChar c = args.arg[ i ];
+        if ( c == 'n' ) {
+            flags |= YLineSort::Numeric;
+        } else if ( c == 'i' ) {
+            flags |= YLineSort::IgnoreCase;
+        } else if ( c == 'u' ) {
+            flags |= YLineSort::Unique;
+        } else if ( c == 'r' ) {
+            flags |= YLineSort::MatchedText;
+        } else if ( c == '"' ) {
+            break; // comment
+        } else if ( !c.isLetterOrNumber() && !c.isSpace() && c != '\\' ) {
+            int end = i + 1;
+            while ( end < args.arg.length() && args.arg[ end ] != c ) {
+                if ( args.arg[ end ] == '\\' )
+                    ++end;
+                ++end;
+            }
+            pattern = args.arg.mid( i + 1, end - i - 1 );
+            // an empty pattern is the last search pattern
+            if ( pattern.isEmpty() )
+                pattern = YSession::self()->search()->currentSearch();
+            i = end;
+        } else if ( !c.isSpace() ) {
+            YSession::self()->guiPopupMessage( _("Invalid argument: ") + args.arg.mid( i ) );
+            return CmdError;
+        }
+    }
+
+    YLineSort sorter( flags, pattern );
+    if ( !sorter.isValid() ) {
+        YSession::self()->guiPopupMessage( sorter.errorString() );
+        return CmdError;
+    }
+
+    // the default range of :sort is the whole buffer
+    int from = args.hasRange ? args.fromLine : 0;
+    int to = args.hasRange ? args.toLine : buffer->lineCount() - 1;
+    to = qMin( to, buffer->lineCount() - 1 );
+    if ( from >= to )
+        return CmdOk;
+
+    QVector<QString> lines( to - from + 1 );
+    for ( int i = 0; i < lines.count(); ++i )
+        lines[ i ] = buffer->textline( from + i );
+    QVector<int> order = sorter.sort( lines );
+
+    buffer->reorderLines( from, to, order );
+    args.view->commitNextUndo();
+    args.view->gotoLinePosition( from, 0 );
+    return CmdOk;
+}
+
+/*
+ * :!cmd shows the output of cmd, :{range}!cmd replaces the lines of the
+ * range by the output of cmd run on them. :!! repeats the last command.
+ */
+CmdState YModeEx::filter( const YExCommandArgs& args )
+{
+    YBuffer* buffer = args.view->buffer();
+    QString command = args.arg;
+    if ( args.force ) {
+        if ( mLastFilterCommand.isEmpty() ) {
+            YSession::self()->guiPopupMessage( _("No previous command") );
+            return CmdError;
+        }
+        command = command.isEmpty() ? mLastFilterCommand : mLastFilterCommand + ' ' + command;
+    }
+    if ( command.isEmpty() ) {
+        YSession::self()->guiPopupMessage( _("Argument required") );
+        return CmdError;
+    }
+    mLastFilterCommand = command;
+
+    QTextCodec* codec = NULL;
+    if ( buffer->encoding() != "locale" )
+        codec = QTextCodec::codecForName( buffer->encoding().toLatin1() );
+    if ( codec == NULL )
+        codec = QTextCodec::codecForLocale();
+
+    QStringList input;
+    if ( args.hasRange ) {
+        for ( unsigned int i = args.fromLine; i <= args.toLine; ++i )
+            input << buffer->textline( i );
+    }
+    YFilter filter( command, codec );
+    QStringList output;
+    switch ( filter.run( input, &output ) ) {
+    case YFilter::FailedToStart:
+        YSession::self()->guiPopupMessage( _("Cannot execute shell ") + YSession::getStringOption( "shell" ) );
+        return CmdError;
+    case YFilter::Interrupted:
+        // the buffer is left as it was
+        args.view->displayInfo( _("Interrupted") );
+        return CmdOk;
+    case YFilter::Finished:
+        break;
+    }
+
+    if ( !args.hasRange ) {
+        YSession::self()->guiPopupMessage( output.join( "\n" ) );
+    } else {
+        /* the whole range is replaced in one transaction */
+        buffer->replaceLines( args.fromLine, args.toLine, output );
+        args.view->commitNextUndo();
+        int line = qMin( (int)args.fromLine, buffer->lineCount() - 1 );
+        args.view->gotoLinePosition( line, buffer->firstNonBlankChar( line ) );
+    }
+    if ( !filter.errors().isEmpty() )
+        YSession::self()->guiPopupMessage( filter.errors() );
+    if ( filter.exitCode() != 0 )
+        args.view->displayInfo( _("shell returned %1").arg( filter.exitCode() ) );
+    else if ( args.hasRange )
+        args.view->displayInfo( _("%1 lines filtered").arg( input.count() ) );
     return CmdOk;
 }
 
@@ -1177,12 +1546,11 @@ CmdState YModeEx::highlight( const YExCommandArgs& args )
     YSession::self()->getOptions()->getOption( type )->setList( option );
     YSession::self()->getOptions()->setGroup("Global");
 
-    if ( args.view && args.view->buffer() ) {
-        YzisHighlighting *yzis = args.view->buffer()->highlight();
-        if (yzis) {
-            args.view->buffer()->makeAttribs();
-            args.view->sendRefreshEvent();
-        }
+    // the default styles are used by all the highlightings, only the
+    // colors change: the buffers are just repainted
+    foreach( YBuffer *buffer, YSession::self()->buffers() ) {
+        if ( buffer->highlight() )
+            buffer->makeAttribs();
     }
 
     return CmdOk;
@@ -1200,6 +1568,22 @@ CmdState YModeEx::foldCreate( const YExCommandArgs& args )
     return CmdOk;
 }
 
+CmdState YModeEx::foldOpen( const YExCommandArgs& args )
+{
+    YZFoldPool* folds = args.view->folds();
+    int from = folds->isHead( args.fromLine ) ? args.fromLine : folds->lineHeadingFold( args.fromLine );
+    folds->setOpened( from, args.toLine, true );
+    return CmdOk;
+}
+
+CmdState YModeEx::foldClose( const YExCommandArgs& args )
+{
+    YZFoldPool* folds = args.view->folds();
+    int from = folds->isHead( args.fromLine ) ? args.fromLine : folds->lineHeadingFold( args.fromLine );
+    folds->setOpened( from, args.toLine, false );
+    return CmdOk;
+}
+
 CmdState YModeEx::cd( const YExCommandArgs& args )
 {
     QString targetDir = tildeExpand(args.arg);
@@ -28,6 +28,7 @@
 /* Qt */
 #include <QRegExp>
 #include <QList>
+#include <QHash>
 
 /* yzis */
 #include "mode.h"
@@ -35,7 +36,6 @@
 
 class YView;
 class YExCommand;
-class YExRange;
 class YModeEx;
 
 /**
@@ -43,13 +43,11 @@ class YModeEx;
  */
 struct YExRangeArgs
 {
-    const YExRange* cmd;
     YView* view;
     QString arg;
 
-    YExRangeArgs( const YExRange* _cmd, YView* _view, const QString& a )
+    YExRangeArgs( YView* _view, const QString& a )
     {
-        cmd = _cmd;
         view = _view;
         arg = a;
     }
@@ -74,6 +72,8 @@ struct YExCommandArgs
     unsigned int toLine;
     // !
     bool force;
+    /// true if a range was given, false if fromLine and toLine default to the current line
+    bool hasRange;
 
     YExCommandArgs( YView* _view, const QString& _input, const QString& _cmd, const QString& _arg, unsigned int _fromLine, unsigned int _toLine, bool _force );
     QString toString() const;
@@ -82,37 +82,6 @@ struct YExCommandArgs
 typedef CmdState (YModeEx::*ExPoolMethod) (const YExCommandArgs&);
 typedef int (YModeEx::*ExRangeMethod) (const YExRangeArgs&);
 
-/**
- * Ex range
- */
-class YZIS_EXPORT YExRange
-{
-
-public :
-    YExRange( const QString& regexp, ExRangeMethod pm );
-    virtual ~YExRange()
-    { }
-
-    QString keySeq() const
-    {
-        return mKeySeq;
-    }
-    const ExRangeMethod& poolMethod() const
-    {
-        return mPoolMethod;
-    }
-    const QRegExp & regexp() const
-    {
-        return mRegexp;
-    }
-
-private :
-    QRegExp mRegexp;
-    QString mKeySeq;
-    ExRangeMethod mPoolMethod;
-
-};
-
 /**
   * Command in exution mode ( as ":w" or ":q")
   */
@@ -121,22 +90,28 @@ class YZIS_EXPORT YExCommand
 public :
     /**
       * Constructor. It creates a commands
-      * @arg input is the string that is to be matched to recognise this command
+      * @arg name is the name of the command, written as in the Vim help: the
+      * part between brackets is optional, "se[t]" is matched by "se" and "set".
       * @arg pm is the ( static ) function that gets executed when this command is entered.
       * @arg longName is a list of names for this command. (to be displayed to the user )
-      * @arg word is.. ?? ( used in some regexp thinguy )
      */
-    YExCommand( const QString& input, ExPoolMethod pm, const QStringList& longName = QStringList(), bool word = true );
+    YExCommand( const QString& name, ExPoolMethod pm, const QStringList& longName = QStringList() );
     virtual ~YExCommand()
     { }
 
+    /**
+     * Full name of the command
+     */
     const QString & keySeq() const
     {
         return mKeySeq;
     }
-    const QRegExp & regexp() const
+    /**
+     * Shortest accepted abbreviation of the command
+     */
+    const QString & abbreviation() const
     {
-        return mRegexp;
+        return mAbbreviation;
     }
     const ExPoolMethod& poolMethod() const
     {
@@ -148,8 +123,8 @@ public :
     }
 
 private :
-    QRegExp mRegexp;
     QString mKeySeq;
+    QString mAbbreviation;
     QStringList mLongName;
     ExPoolMethod mPoolMethod;
 
@@ -181,8 +156,13 @@ public :
 
 private :
     QList<const YExCommand*> commands;
-    QList<const YExRange*> ranges;
+    // every accepted spelling of the commands, built once by initPool
+    QHash<QString, const YExCommand*> mCommandTable;
     YZHistory *mHistory;
+    // a :global is running
+    bool mInsideGlobal;
+    // last command of :!, for :!!
+    QString mLastFilterCommand;
     //completion stuff
     QStringList mCompletePossibilities;
     int mCurrentCompletionProposal;
@@ -214,6 +194,7 @@ private :
     const QString& completionItem(int idx);
 
     QString parseRange( const QString& inputs, YView* view, int* range, bool* matched );
+    const YExCommand* findCommand( const QString& inputs, QString* name, QString* arg ) const;
 
     // ranges
     int rangeLine( const YExRangeArgs& args );
@@ -239,6 +220,10 @@ public:
     CmdState mkyzisrc( const YExCommandArgs& args );
     CmdState set( const YExCommandArgs& args );
     CmdState substitute( const YExCommandArgs& args );
+    CmdState global( const YExCommandArgs& args );
+    CmdState deleteLines( const YExCommandArgs& args );
+    CmdState sort( const YExCommandArgs& args );
+    CmdState filter( const YExCommandArgs& args );
     CmdState hardcopy( const YExCommandArgs& args );
     CmdState gotoOpenMode( const YExCommandArgs& args );
     CmdState gotoCommandMode( const YExCommandArgs& args );
@@ -274,6 +259,8 @@ public:
     CmdState genericUnmap( const YExCommandArgs& args, int );
     CmdState genericNoremap( const YExCommandArgs& args, int );
     CmdState foldCreate( const YExCommandArgs& args );
+    CmdState foldOpen( const YExCommandArgs& args );
+    CmdState foldClose( const YExCommandArgs& args );
     CmdState cd( const YExCommandArgs& args );
     CmdState pwd( const YExCommandArgs& args );
     CmdState tag( const YExCommandArgs& args );
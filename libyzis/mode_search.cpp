@@ -28,6 +28,7 @@
 #include "buffer.h"
 #include "history.h"
 #include "search.h"
+#include "regexp.h"
 #include "selection.h"
 #include "session.h"
 
@@ -103,8 +104,12 @@ CmdState YModeSearch::execCommand( YView* view, const YKeySequence& keys, YKeySe
                 incSearchFound = false;
             }
         }
+        YRegExp rx( what.isEmpty() ? YSession::self()->search()->currentSearch() : what,
+                    Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
         if ( found ) {
             view->gotoLinePosition(pos.y() , pos.x());
+        } else if ( !rx.isValid() ) {
+            view->displayInfo( rx.errorString() );
         } else {
             view->displayInfo(_("Pattern not found: ") + what);
         }
@@ -0,0 +1,441 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+/* Yzis */
+#include "regexp.h"
+#include "regexpnfa.h"
+#include "vimregexp.h"
+#include "debug.h"
+
+/* Qt */
+#include <QRegExp>
+
+#define dbg()    yzDebug("YRegExp")
+#define err()    yzError("YRegExp")
+
+/************************
+ * YQtRegExpEngine
+ ************************/
+
+/*
+ * QRegExp backend, used for the patterns the linear engine can't handle.
+ */
+class YQtRegExpEngine : public YRegExpEngine
+{
+public:
+    YQtRegExpEngine( const QRegExp& rx ) : mRegExp(rx)
+    {}
+
+    virtual YRegExpEngine* clone() const
+    {
+        return new YQtRegExpEngine(mRegExp);
+    }
+    virtual YRegExp::Engine type() const
+    {
+        return YRegExp::QtEngine;
+    }
+    virtual bool isValid() const
+    {
+        return mRegExp.isValid();
+    }
+    virtual QString errorString() const
+    {
+        return mRegExp.isValid() ? QString() : mRegExp.errorString();
+    }
+    virtual int numCaptures() const
+    {
+        return mRegExp.numCaptures();
+    }
+    virtual int indexIn( const QString& str, int offset, YRegExp::CaretMode caretMode, QVector<int>* caps ) const
+    {
+        int idx = mRegExp.indexIn(str, offset, caretMode == YRegExp::CaretAtOffset ? QRegExp::CaretAtOffset : QRegExp::CaretAtZero);
+        fillCaptures(idx, caps);
+        return idx;
+    }
+    virtual int lastIndexIn( const QString& str, int offset, YRegExp::CaretMode caretMode, QVector<int>* caps ) const
+    {
+        int idx = mRegExp.lastIndexIn(str, offset, caretMode == YRegExp::CaretAtOffset ? QRegExp::CaretAtOffset : QRegExp::CaretAtZero);
+        fillCaptures(idx, caps);
+        return idx;
+    }
+    virtual bool exactMatch( const QString& str, QVector<int>* caps ) const
+    {
+        bool ret = mRegExp.exactMatch(str);
+        fillCaptures(ret ? 0 : -1, caps);
+        return ret;
+    }
+
+private:
+    void fillCaptures( int idx, QVector<int>* caps ) const
+    {
+        if ( !caps || idx < 0 )
+            return;
+        int n = mRegExp.numCaptures() + 1;
+        caps->resize(2 * n);
+        for ( int i = 0; i < n; ++i ) {
+            int p = mRegExp.pos(i);
+            (*caps)[2 * i] = p;
+            (*caps)[2 * i + 1] = p < 0 ? -1 : p + mRegExp.cap(i).length();
+        }
+    }
+
+    /* QRegExp stores the captures of the last match */
+    mutable QRegExp mRegExp;
+};
+
+/*
+ * Engine of the patterns which failed to compile, it never matches.
+ */
+class YInvalidRegExpEngine : public YRegExpEngine
+{
+public:
+    YInvalidRegExpEngine( const QString& error ) : mError(error)
+    {}
+
+    virtual YRegExpEngine* clone() const
+    {
+        return new YInvalidRegExpEngine(mError);
+    }
+    virtual YRegExp::Engine type() const
+    {
+        return YRegExp::LinearEngine;
+    }
+    virtual bool isValid() const
+    {
+        return false;
+    }
+    virtual QString errorString() const
+    {
+        return mError;
+    }
+    virtual int numCaptures() const
+    {
+        return 0;
+    }
+    virtual int indexIn( const QString&, int, YRegExp::CaretMode, QVector<int>* ) const
+    {
+        return -1;
+    }
+    virtual int lastIndexIn( const QString&, int, YRegExp::CaretMode, QVector<int>* ) const
+    {
+        return -1;
+    }
+    virtual bool exactMatch( const QString&, QVector<int>* ) const
+    {
+        return false;
+    }
+
+private:
+    QString mError;
+};
+
+/************************
+ * YRegExpEngine
+ ************************/
+
+YRegExpEngine::~YRegExpEngine()
+{}
+
+QString YRegExpEngine::errorString() const
+{
+    return QString();
+}
+
+YRegExpEngine* YRegExpEngine::create( const QString& pattern, Qt::CaseSensitivity cs, bool minimal, YRegExp::Engine engine, YRegExp::PatternSyntax syntax )
+{
+    if ( syntax == YRegExp::VimSyntax ) {
+        QString error;
+        YRegExpEngine* e = YVimRegExp::compile(pattern, cs, minimal, engine, &error);
+        return e ? e : new YInvalidRegExpEngine(error);
+    }
+    if ( engine != YRegExp::QtEngine ) {
+        YRegExpEngine* e = YNfaRegExpEngine::fromPattern(pattern, cs, minimal);
+        if ( e )
+            return e;
+    }
+    QRegExp rx(pattern, cs);
+    rx.setMinimal(minimal);
+    return new YQtRegExpEngine(rx);
+}
+
+/************************
+ * YRegExp
+ ************************/
+
+struct YRegExp::Private
+{
+    Private() : cs(Qt::CaseSensitive), minimal(false), requested(YRegExp::AutoEngine), syntax(YRegExp::RegExpSyntax), engine(NULL)
+    {}
+
+    YRegExpEngine* compiled();
+    void invalidate();
+
+    QString pattern;
+    Qt::CaseSensitivity cs;
+    bool minimal;
+    YRegExp::Engine requested;
+    YRegExp::PatternSyntax syntax;
+    /* compiled lazily, NULL until needed */
+    YRegExpEngine* engine;
+
+    /* last match */
+    QString subject;
+    QVector<int> caps;
+};
+
+YRegExpEngine* YRegExp::Private::compiled()
+{
+    if ( !engine )
+        engine = YRegExpEngine::create(pattern, cs, minimal, requested, syntax);
+    return engine;
+}
+
+void YRegExp::Private::invalidate()
+{
+    delete engine;
+    engine = NULL;
+    caps.clear();
+}
+
+YRegExp::YRegExp()
+        : d(new Private)
+{}
+
+YRegExp::YRegExp( const QString& pattern, Qt::CaseSensitivity cs, Engine engine, PatternSyntax syntax )
+        : d(new Private)
+{
+    d->pattern = pattern;
+    d->cs = cs;
+    d->requested = engine;
+    d->syntax = syntax;
+}
+
+YRegExp::YRegExp( YRegExpEngine* engine, const QString& pattern )
+        : d(new Private)
+{
+    d->pattern = pattern;
+    d->engine = engine;
+}
+
+YRegExp::YRegExp( const YRegExp& rx )
+        : d(new Private)
+{
+    *this = rx;
+}
+
+YRegExp::~YRegExp()
+{
+    delete d->engine;
+    delete d;
+}
+
+YRegExp& YRegExp::operator=( const YRegExp& rx )
+{
+    if ( this == &rx )
+        return *this;
+    d->invalidate();
+    d->pattern = rx.d->pattern;
+    d->cs = rx.d->cs;
+    d->minimal = rx.d->minimal;
+    d->requested = rx.d->requested;
+    d->syntax = rx.d->syntax;
+    if ( rx.d->engine )
+        d->engine = rx.d->engine->clone();
+    d->subject = rx.d->subject;
+    d->caps = rx.d->caps;
+    return *this;
+}
+
+QString YRegExp::pattern() const
+{
+    return d->pattern;
+}
+void YRegExp::setPattern( const QString& pattern )
+{
+    if ( pattern == d->pattern )
+        return;
+    d->pattern = pattern;
+    d->invalidate();
+}
+
+Qt::CaseSensitivity YRegExp::caseSensitivity() const
+{
+    return d->cs;
+}
+void YRegExp::setCaseSensitivity( Qt::CaseSensitivity cs )
+{
+    if ( cs == d->cs )
+        return;
+    d->cs = cs;
+    d->invalidate();
+}
+
+bool YRegExp::isMinimal() const
+{
+    return d->minimal;
+}
+void YRegExp::setMinimal( bool minimal )
+{
+    if ( minimal == d->minimal )
+        return;
+    d->minimal = minimal;
+    d->invalidate();
+}
+
+YRegExp::PatternSyntax YRegExp::patternSyntax() const
+{
+    return d->syntax;
+}
+void YRegExp::setPatternSyntax( PatternSyntax syntax )
+{
+    if ( syntax == d->syntax )
+        return;
+    d->syntax = syntax;
+    d->invalidate();
+}
+
+void YRegExp::setEngine( Engine engine )
+{
+    if ( engine == d->requested )
+        return;
+    d->requested = engine;
+    d->invalidate();
+}
+YRegExp::Engine YRegExp::engine() const
+{
+    return d->compiled()->type();
+}
+
+bool YRegExp::isValid() const
+{
+    return d->compiled()->isValid();
+}
+bool YRegExp::isEmpty() const
+{
+    return d->pattern.isEmpty();
+}
+
+QString YRegExp::errorString() const
+{
+    return d->compiled()->errorString();
+}
+
+int YRegExp::indexIn( const QString& str, int offset, CaretMode caretMode ) const
+{
+    d->subject = str;
+    d->caps.clear();
+    if ( offset < 0 )
+        offset = qMax(0, offset + str.length());
+    if ( offset > str.length() )
+        return -1;
+    return d->compiled()->indexIn(str, offset, caretMode, &d->caps);
+}
+
+int YRegExp::lastIndexIn( const QString& str, int offset, CaretMode caretMode ) const
+{
+    d->subject = str;
+    d->caps.clear();
+    if ( offset < 0 )
+        offset += str.length();
+    if ( offset < 0 )
+        return -1;
+    offset = qMin(offset, str.length());
+    return d->compiled()->lastIndexIn(str, offset, caretMode, &d->caps);
+}
+
+bool YRegExp::exactMatch( const QString& str ) const
+{
+    d->subject = str;
+    d->caps.clear();
+    return d->compiled()->exactMatch(str, &d->caps);
+}
+
+int YRegExp::matchedLength() const
+{
+    if ( d->caps.size() < 2 )
+        return -1;
+    return d->caps[1] - d->caps[0];
+}
+
+int YRegExp::numCaptures() const
+{
+    return d->compiled()->numCaptures();
+}
+
+QString YRegExp::cap( int nth ) const
+{
+    if ( nth < 0 || 2 * nth + 1 >= d->caps.size() || d->caps[2 * nth] < 0 )
+        return QString();
+    return d->subject.mid(d->caps[2 * nth], d->caps[2 * nth + 1] - d->caps[2 * nth]);
+}
+
+int YRegExp::pos( int nth ) const
+{
+    if ( nth < 0 || 2 * nth >= d->caps.size() )
+        return -1;
+    return d->caps[2 * nth];
+}
+
+QStringList YRegExp::capturedTexts() const
+{
+    QStringList list;
+    for ( int i = 0; i <= numCaptures(); ++i )
+        list << cap(i);
+    return list;
+}
+
+QString YRegExp::expand( const QString& after ) const
+{
+    QString result;
+    for ( int i = 0; i < after.length(); ++i ) {
+        if ( after.at(i) == QLatin1Char('\\') && i + 1 < after.length() && after.at(i + 1).isDigit() ) {
+            result += cap(after.at(i + 1).digitValue());
+            ++i;
+        } else {
+            result += after.at(i);
+        }
+    }
+    return result;
+}
+
+QString YRegExp::replace( const QString& str, const QString& after ) const
+{
+    QString result;
+    int last = 0;
+    int index = 0;
+    while ( index <= str.length() ) {
+        int pos = indexIn(str, index);
+        if ( pos < 0 )
+            break;
+        int len = matchedLength();
+        result += str.mid(last, pos - last);
+        result += expand(after);
+        last = pos + len;
+        if ( len == 0 ) {
+            /* empty match: keep the char and go on with the next one */
+            if ( pos < str.length() )
+                result += str.at(pos);
+            last = pos + 1;
+        }
+        index = last;
+    }
+    result += str.mid(last);
+    return result;
+}
+
@@ -0,0 +1,186 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+#ifndef YZ_REGEXP_H
+#define YZ_REGEXP_H
+
+/* Qt */
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/* Yzis */
+#include "yzismacros.h"
+
+class YRegExpEngine;
+
+/**
+ * YRegExp : regular expression used by the search, the substitutions,
+ * the syntax highlighting and the lua Regexp class.
+ *
+ * The API mimics QRegExp (same pattern syntax, same matching methods), but
+ * the matching itself is delegated to a YRegExpEngine. By default, patterns
+ * are compiled for the linear-time NFA engine (see regexpnfa.h) which
+ * guarantees a matching time linear in the length of the subject. Patterns
+ * using features this engine doesn't support (back references, lookahead)
+ * automatically fall back to QRegExp.
+ *
+ * Patterns can also be written in the Vim syntax (see vimregexp.h), which
+ * is what the search, the substitutions and hlsearch use.
+ */
+class YZIS_EXPORT YRegExp
+{
+public:
+    enum CaretMode {
+        CaretAtZero, //!< ^ matches at the beginning of the string
+        CaretAtOffset, //!< ^ matches at the search offset
+    };
+
+    enum Engine {
+        AutoEngine, //!< linear engine if possible, QRegExp otherwise
+        LinearEngine, //!< Thompson NFA simulation, linear in the subject length
+        QtEngine, //!< QRegExp backtracking engine
+    };
+
+    enum PatternSyntax {
+        RegExpSyntax, //!< QRegExp syntax
+        VimSyntax, //!< Vim syntax, :help pattern
+    };
+
+    YRegExp();
+    explicit YRegExp( const QString& pattern, Qt::CaseSensitivity cs = Qt::CaseSensitive, Engine engine = AutoEngine, PatternSyntax syntax = RegExpSyntax );
+    YRegExp( const YRegExp& rx );
+    ~YRegExp();
+
+    YRegExp& operator=( const YRegExp& rx );
+
+    /**
+     * Takes ownership of an already compiled @arg engine.
+     * The pattern is only kept for information purpose.
+     */
+    YRegExp( YRegExpEngine* engine, const QString& pattern );
+
+    QString pattern() const;
+    void setPattern( const QString& pattern );
+
+    Qt::CaseSensitivity caseSensitivity() const;
+    void setCaseSensitivity( Qt::CaseSensitivity cs );
+
+    bool isMinimal() const;
+    void setMinimal( bool minimal );
+
+    PatternSyntax patternSyntax() const;
+    void setPatternSyntax( PatternSyntax syntax );
+
+    /**
+     * Engine requested for this regexp
+     */
+    void setEngine( Engine engine );
+
+    /**
+     * Engine which is actually used to match this regexp
+     */
+    Engine engine() const;
+
+    bool isValid() const;
+    bool isEmpty() const;
+
+    /**
+     * Why the pattern is not valid, empty if it is. Same as
+     * QRegExp::errorString, the Vim syntax gives the Vim messages.
+     */
+    QString errorString() const;
+
+    /**
+     * Same as QRegExp::indexIn
+     */
+    int indexIn( const QString& str, int offset = 0, CaretMode caretMode = CaretAtZero ) const;
+
+    /**
+     * Same as QRegExp::lastIndexIn
+     */
+    int lastIndexIn( const QString& str, int offset = -1, CaretMode caretMode = CaretAtZero ) const;
+
+    bool exactMatch( const QString& str ) const;
+
+    int matchedLength() const;
+    int numCaptures() const;
+    QString cap( int nth = 0 ) const;
+    int pos( int nth = 0 ) const;
+    QStringList capturedTexts() const;
+
+    /**
+     * Returns @arg str where each match is replaced by @arg after,
+     * \\1 to \\9 being replaced by the corresponding capture.
+     * Same as QString::replace( QRegExp, QString )
+     */
+    QString replace( const QString& str, const QString& after ) const;
+
+    /**
+     * Returns @arg after where \\1 to \\9 are replaced by the captures
+     * of the last match.
+     */
+    QString expand( const QString& after ) const;
+
+private:
+    struct Private;
+    Private *d;
+};
+
+/**
+ * Interface of the matching backends of YRegExp.
+ *
+ * Captures are returned as (start, end) pairs, the first one being the whole
+ * match, -1 meaning the capture didn't participate to the match.
+ */
+class YZIS_EXPORT YRegExpEngine
+{
+public:
+    virtual ~YRegExpEngine();
+
+    virtual YRegExpEngine* clone() const = 0;
+    virtual YRegExp::Engine type() const = 0;
+    virtual bool isValid() const = 0;
+    /**
+     * Empty for a valid engine
+     */
+    virtual QString errorString() const;
+    virtual int numCaptures() const = 0;
+
+    /**
+     * Returns the position of the first match starting at or after @arg offset
+     */
+    virtual int indexIn( const QString& str, int offset, YRegExp::CaretMode caretMode, QVector<int>* caps ) const = 0;
+
+    /**
+     * Returns the position of the last match starting at or before @arg offset
+     */
+    virtual int lastIndexIn( const QString& str, int offset, YRegExp::CaretMode caretMode, QVector<int>* caps ) const = 0;
+
+    virtual bool exactMatch( const QString& str, QVector<int>* caps ) const = 0;
+
+    /**
+     * Compiles @arg pattern with the requested @arg engine.
+     * Never returns NULL: falls back to QRegExp when needed.
+     */
+    static YRegExpEngine* create( const QString& pattern, Qt::CaseSensitivity cs, bool minimal, YRegExp::Engine engine, YRegExp::PatternSyntax syntax = YRegExp::RegExpSyntax );
+};
+
+#endif
+
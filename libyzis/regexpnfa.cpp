@@ -0,0 +1,916 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+/* Yzis */
+#include "regexpnfa.h"
+#include "debug.h"
+
+/* Qt */
+#include <QVarLengthArray>
+
+#define dbg()    yzDebug("YNfaRegExpEngine")
+#define err()    yzError("YNfaRegExpEngine")
+
+/* beyond this size, compiling is refused and QRegExp is used instead:
+ * huge counted repetitions would make the simulation too slow anyway */
+#define YZIS_NFA_MAX_PROGRAM 4096
+
+static inline bool isWordChar( QChar c )
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+static inline ushort foldChar( QChar c )
+{
+    return c.toLower().unicode();
+}
+
+/************************
+ * YNfaCharClass
+ ************************/
+
+void YNfaCharClass::addRange( ushort first, ushort last )
+{
+    ranges << first << last;
+}
+
+bool YNfaCharClass::contains( QChar c ) const
+{
+    ushort u = c.unicode();
+    bool in = false;
+    for ( int i = 0; !in && i < ranges.size(); i += 2 ) {
+        in = u >= ranges[i] && u <= ranges[i + 1];
+    }
+    if ( !in && categories ) {
+        in = ( (categories & Digit) && c.isDigit() )
+             || ( (categories & NotDigit) && !c.isDigit() )
+             || ( (categories & Space) && c.isSpace() )
+             || ( (categories & NotSpace) && !c.isSpace() )
+             || ( (categories & Word) && isWordChar(c) )
+             || ( (categories & NotWord) && !isWordChar(c) );
+    }
+    return in != negated;
+}
+
+/************************
+ * QRegExp syntax parser
+ ************************/
+
+namespace
+{
+class QRegExpSyntaxParser
+{
+public:
+    QRegExpSyntaxParser( const QString& pattern ) : mPattern(pattern), mPos(0), mCaptures(0)
+    {}
+
+    YRegExpNode* parse()
+    {
+        YRegExpNode* root = parseAlternation();
+        if ( root && mPos < mPattern.length() ) {
+            /* unbalanced ')' */
+            delete root;
+            root = NULL;
+        }
+        return root;
+    }
+
+    int captures() const
+    {
+        return mCaptures;
+    }
+
+private:
+    bool atEnd() const
+    {
+        return mPos >= mPattern.length();
+    }
+    QChar peek() const
+    {
+        return mPattern.at(mPos);
+    }
+
+    YRegExpNode* parseAlternation();
+    YRegExpNode* parseConcat();
+    YRegExpNode* parseRepeat();
+    YRegExpNode* parseAtom();
+    YRegExpNode* parseEscape();
+    bool parseClass( YNfaCharClass* cls );
+    bool parseCharEscape( QChar* c );
+    bool parseQuantifier( int* min, int* max );
+    int parseNumber( int base, int maxDigits );
+
+    QString mPattern;
+    int mPos;
+    int mCaptures;
+};
+
+YRegExpNode* QRegExpSyntaxParser::parseAlternation()
+{
+    YRegExpNode* first = parseConcat();
+    if ( !first )
+        return NULL;
+    YRegExpNode* alt = NULL;
+    while ( !atEnd() && peek() == QLatin1Char('|') ) {
+        ++mPos;
+        if ( !alt ) {
+            alt = new YRegExpNode(YRegExpNode::Alternation);
+            alt->children << first;
+        }
+        YRegExpNode* n = parseConcat();
+        if ( !n ) {
+            delete alt;
+            return NULL;
+        }
+        alt->children << n;
+    }
+    return alt ? alt : first;
+}
+
+YRegExpNode* QRegExpSyntaxParser::parseConcat()
+{
+    YRegExpNode* concat = new YRegExpNode(YRegExpNode::Concat);
+    while ( !atEnd() && peek() != QLatin1Char('|') && peek() != QLatin1Char(')') ) {
+        YRegExpNode* n = parseRepeat();
+        if ( !n ) {
+            delete concat;
+            return NULL;
+        }
+        concat->children << n;
+    }
+    return concat;
+}
+
+YRegExpNode* QRegExpSyntaxParser::parseRepeat()
+{
+    YRegExpNode* atom = parseAtom();
+    if ( !atom || atEnd() )
+        return atom;
+
+    int min, max;
+    QChar c = peek();
+    if ( c == QLatin1Char('*') ) {
+        min = 0;
+        max = -1;
+        ++mPos;
+    } else if ( c == QLatin1Char('+') ) {
+        min = 1;
+        max = -1;
+        ++mPos;
+    } else if ( c == QLatin1Char('?') ) {
+        min = 0;
+        max = 1;
+        ++mPos;
+    } else if ( c == QLatin1Char('{') ) {
+        if ( !parseQuantifier(&min, &max) ) {
+            delete atom;
+            return NULL;
+        }
+    } else {
+        return atom;
+    }
+
+    switch ( atom->type ) {
+    case YRegExpNode::LineStart:
+    case YRegExpNode::LineEnd:
+    case YRegExpNode::WordBoundary:
+    case YRegExpNode::NotWordBoundary:
+        /* nothing to repeat */
+        delete atom;
+        return NULL;
+    default:
+        break;
+    }
+
+    YRegExpNode* rep = new YRegExpNode(YRegExpNode::Repeat);
+    rep->min = min;
+    rep->max = max;
+    rep->children << atom;
+
+    /* stacked quantifiers are left to QRegExp */
+    if ( !atEnd() && QString("*+?{").contains(peek()) ) {
+        delete rep;
+        return NULL;
+    }
+    return rep;
+}
+
+YRegExpNode* QRegExpSyntaxParser::parseAtom()
+{
+    QChar c = peek();
+    YRegExpNode* n;
+    switch ( c.unicode() ) {
+    case '(': {
+        ++mPos;
+        int capture = -1;
+        if ( !atEnd() && peek() == QLatin1Char('?') ) {
+            /* (?:...) is supported, lookaheads are not */
+            if ( mPos + 1 < mPattern.length() && mPattern.at(mPos + 1) == QLatin1Char(':') ) {
+                mPos += 2;
+            } else {
+                return NULL;
+            }
+        } else {
+            capture = ++mCaptures;
+        }
+        YRegExpNode* inner = parseAlternation();
+        if ( !inner )
+            return NULL;
+        if ( atEnd() || peek() != QLatin1Char(')') ) {
+            delete inner;
+            return NULL;
+        }
+        ++mPos;
+        n = new YRegExpNode(YRegExpNode::Group);
+        n->capture = capture;
+        n->children << inner;
+        return n;
+    }
+    case '[':
+        ++mPos;
+        n = new YRegExpNode(YRegExpNode::Class);
+        if ( !parseClass(&n->cls) ) {
+            delete n;
+            return NULL;
+        }
+        return n;
+    case '.':
+        ++mPos;
+        return new YRegExpNode(YRegExpNode::AnyChar);
+    case '^':
+        ++mPos;
+        return new YRegExpNode(YRegExpNode::LineStart);
+    case '$':
+        ++mPos;
+        return new YRegExpNode(YRegExpNode::LineEnd);
+    case '\\':
+        ++mPos;
+        return parseEscape();
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+        return NULL;
+    default:
+        ++mPos;
+        n = new YRegExpNode(YRegExpNode::Char);
+        n->ch = c;
+        return n;
+    }
+}
+
+YRegExpNode* QRegExpSyntaxParser::parseEscape()
+{
+    if ( atEnd() )
+        return NULL;
+    QChar c = peek();
+    YRegExpNode* n;
+    int category = 0;
+    switch ( c.unicode() ) {
+    case 'b':
+        ++mPos;
+        return new YRegExpNode(YRegExpNode::WordBoundary);
+    case 'B':
+        ++mPos;
+        return new YRegExpNode(YRegExpNode::NotWordBoundary);
+    case 'd': category = YNfaCharClass::Digit; break;
+    case 'D': category = YNfaCharClass::NotDigit; break;
+    case 's': category = YNfaCharClass::Space; break;
+    case 'S': category = YNfaCharClass::NotSpace; break;
+    case 'w': category = YNfaCharClass::Word; break;
+    case 'W': category = YNfaCharClass::NotWord; break;
+    default:
+        if ( c >= QLatin1Char('1') && c <= QLatin1Char('9') ) {
+            /* back reference */
+            return NULL;
+        }
+        break;
+    }
+    if ( category ) {
+        ++mPos;
+        n = new YRegExpNode(YRegExpNode::Class);
+        n->cls.categories = category;
+        return n;
+    }
+
+    n = new YRegExpNode(YRegExpNode::Char);
+    if ( !parseCharEscape(&n->ch) ) {
+        delete n;
+        return NULL;
+    }
+    return n;
+}
+
+/*
+ * parses the escaped char at mPos (backslash already consumed)
+ */
+bool QRegExpSyntaxParser::parseCharEscape( QChar* c )
+{
+    QChar e = peek();
+    ++mPos;
+    switch ( e.unicode() ) {
+    case 'a': *c = QChar(7); break;
+    case 'f': *c = QChar(12); break;
+    case 'n': *c = QChar(10); break;
+    case 'r': *c = QChar(13); break;
+    case 't': *c = QChar(9); break;
+    case 'v': *c = QChar(11); break;
+    case '0': {
+        int v = parseNumber(8, 3);
+        *c = QChar(v < 0 ? 0 : v);
+        break;
+    }
+    case 'x': {
+        int v = parseNumber(16, 4);
+        if ( v < 0 )
+            return false;
+        *c = QChar(v);
+        break;
+    }
+    default:
+        *c = e;
+        break;
+    }
+    return true;
+}
+
+int QRegExpSyntaxParser::parseNumber( int base, int maxDigits )
+{
+    int v = -1;
+    for ( int i = 0; i < maxDigits && !atEnd(); ++i ) {
+        bool ok;
+        int digit = QString(peek()).toInt(&ok, base);
+        if ( !ok )
+            break;
+        v = (v < 0 ? 0 : v * base) + digit;
+        ++mPos;
+    }
+    return v;
+}
+
+bool QRegExpSyntaxParser::parseClass( YNfaCharClass* cls )
+{
+    if ( !atEnd() && peek() == QLatin1Char('^') ) {
+        cls->negated = true;
+        ++mPos;
+    }
+    bool first = true;
+    while ( !atEnd() ) {
+        QChar c = peek();
+        if ( c == QLatin1Char(']') && !first ) {
+            ++mPos;
+            return true;
+        }
+        first = false;
+        ++mPos;
+        if ( c == QLatin1Char('\\') ) {
+            if ( atEnd() )
+                return false;
+            QChar e = peek();
+            int category = 0;
+            switch ( e.unicode() ) {
+            case 'd': category = YNfaCharClass::Digit; break;
+            case 'D': category = YNfaCharClass::NotDigit; break;
+            case 's': category = YNfaCharClass::Space; break;
+            case 'S': category = YNfaCharClass::NotSpace; break;
+            case 'w': category = YNfaCharClass::Word; break;
+            case 'W': category = YNfaCharClass::NotWord; break;
+            default: break;
+            }
+            if ( category ) {
+                ++mPos;
+                cls->categories |= category;
+                continue;
+            }
+            if ( !parseCharEscape(&c) )
+                return false;
+        }
+        /* range */
+        if ( mPos + 1 < mPattern.length() && peek() == QLatin1Char('-') && mPattern.at(mPos + 1) != QLatin1Char(']') ) {
+            ++mPos;
+            QChar last = peek();
+            ++mPos;
+            if ( last == QLatin1Char('\\') ) {
+                if ( atEnd() || !parseCharEscape(&last) )
+                    return false;
+            }
+            if ( last < c )
+                return false;
+            cls->addRange(c.unicode(), last.unicode());
+        } else {
+            cls->addChar(c);
+        }
+    }
+    /* missing ']' */
+    return false;
+}
+
+bool QRegExpSyntaxParser::parseQuantifier( int* min, int* max )
+{
+    /* {n} {n,} {,m} {n,m} */
+    ++mPos;
+    int n = parseNumber(10, 5);
+    if ( atEnd() )
+        return false;
+    if ( peek() == QLatin1Char('}') ) {
+        if ( n < 0 )
+            return false;
+        ++mPos;
+        *min = *max = n;
+        return true;
+    }
+    if ( peek() != QLatin1Char(',') )
+        return false;
+    ++mPos;
+    int m = parseNumber(10, 5);
+    if ( atEnd() || peek() != QLatin1Char('}') )
+        return false;
+    ++mPos;
+    *min = n < 0 ? 0 : n;
+    *max = m;
+    return m < 0 || m >= *min;
+}
+}
+
+/************************
+ * YNfaRegExpEngine
+ ************************/
+
+struct YNfaRegExpEngine::ThreadList
+{
+    ThreadList( int programSize, int nsave ) : count(0), generation(1), nsave(nsave)
+    {
+        /* at most one thread per instruction */
+        pcs.resize(programSize);
+        caps.resize(programSize * nsave);
+        marks.fill(0, programSize);
+    }
+    void clear()
+    {
+        count = 0;
+        if ( ++generation == 0 ) {
+            /* the old marks could be taken for new ones */
+            marks.fill(0);
+            generation = 1;
+        }
+    }
+
+    QVector<int> pcs;
+    QVector<int> caps;
+    QVector<uint> marks;
+    int count;
+    uint generation;
+    int nsave;
+};
+
+YNfaRegExpEngine::YNfaRegExpEngine() :
+        mProgram(),
+        mClasses(),
+        mCaptures(0),
+        mCaseInsensitive(false),
+        mMinimal(false),
+        mFirstMatch(false),
+        mList1(NULL),
+        mList2(NULL)
+{}
+
+YNfaRegExpEngine::~YNfaRegExpEngine()
+{
+    delete mList1;
+    delete mList2;
+}
+
+void YNfaRegExpEngine::allocThreadLists()
+{
+    /* the captures, then the \zs and \ze positions */
+    int nsave = 2 * (mCaptures + 1) + 2;
+    mList1 = new ThreadList(mProgram.size(), nsave);
+    mList2 = new ThreadList(mProgram.size(), nsave);
+}
+
+YRegExpNode* YNfaRegExpEngine::parse( const QString& pattern, int* captures )
+{
+    QRegExpSyntaxParser parser(pattern);
+    YRegExpNode* root = parser.parse();
+    *captures = parser.captures();
+    return root;
+}
+
+YNfaRegExpEngine* YNfaRegExpEngine::fromPattern( const QString& pattern, Qt::CaseSensitivity cs, bool minimal )
+{
+    int captures;
+    YRegExpNode* root = parse(pattern, &captures);
+    if ( !root ) {
+        dbg() << "pattern '" << pattern << "' not supported, using QRegExp" << endl;
+        return NULL;
+    }
+    YNfaRegExpEngine* e = fromTree(root, captures, cs, minimal);
+    delete root;
+    return e;
+}
+
+YNfaRegExpEngine* YNfaRegExpEngine::fromTree( const YRegExpNode* root, int captures, Qt::CaseSensitivity cs, bool minimal, bool firstMatch )
+{
+    YNfaRegExpEngine* e = new YNfaRegExpEngine();
+    e->mCaptures = captures;
+    e->mCaseInsensitive = cs == Qt::CaseInsensitive;
+    e->mMinimal = minimal;
+    e->mFirstMatch = firstMatch;
+
+    e->emit(Inst::Save, 0);
+    if ( !e->compile(root) ) {
+        dbg() << "program too big or not regular, using QRegExp" << endl;
+        delete e;
+        return NULL;
+    }
+    e->emit(Inst::Save, 1);
+    e->emit(Inst::Match);
+    e->allocThreadLists();
+    return e;
+}
+
+int YNfaRegExpEngine::emit( Inst::Op op, int x, int y, ushort ch )
+{
+    Inst inst;
+    inst.op = op;
+    inst.x = x;
+    inst.y = y;
+    inst.ch = ch;
+    mProgram.append(inst);
+    return mProgram.size() - 1;
+}
+
+bool YNfaRegExpEngine::compile( const YRegExpNode* node )
+{
+    if ( mProgram.size() > YZIS_NFA_MAX_PROGRAM )
+        return false;
+
+    switch ( node->type ) {
+    case YRegExpNode::Empty:
+        break;
+    case YRegExpNode::Char:
+        emit(Inst::Char, 0, 0, mCaseInsensitive ? foldChar(node->ch) : node->ch.unicode());
+        break;
+    case YRegExpNode::AnyChar:
+        emit(Inst::AnyChar);
+        break;
+    case YRegExpNode::Class:
+        mClasses.append(node->cls);
+        emit(Inst::Class, mClasses.size() - 1);
+        break;
+    case YRegExpNode::Concat:
+        foreach( const YRegExpNode* child, node->children ) {
+            if ( !compile(child) )
+                return false;
+        }
+        break;
+    case YRegExpNode::Alternation: {
+        QList<int> jumps;
+        for ( int i = 0; i < node->children.size(); ++i ) {
+            if ( i == node->children.size() - 1 ) {
+                if ( !compile(node->children[i]) )
+                    return false;
+                break;
+            }
+            int split = emit(Inst::Split, mProgram.size() + 1);
+            if ( !compile(node->children[i]) )
+                return false;
+            jumps << emit(Inst::Jmp);
+            mProgram[split].y = mProgram.size();
+        }
+        foreach( int j, jumps ) {
+            mProgram[j].x = mProgram.size();
+        }
+        break;
+    }
+    case YRegExpNode::Group:
+        if ( node->capture >= 0 )
+            emit(Inst::Save, 2 * node->capture);
+        if ( !compile(node->children[0]) )
+            return false;
+        if ( node->capture >= 0 )
+            emit(Inst::Save, 2 * node->capture + 1);
+        break;
+    case YRegExpNode::Repeat: {
+        const YRegExpNode* child = node->children[0];
+        bool minimal = mMinimal || node->minimal;
+        for ( int i = 0; i < node->min; ++i ) {
+            if ( !compile(child) )
+                return false;
+        }
+        /* the preferred branch of a split is x */
+        if ( node->max < 0 ) {
+            int split = emit(Inst::Split);
+            if ( !compile(child) )
+                return false;
+            emit(Inst::Jmp, split);
+            mProgram[split].x = minimal ? mProgram.size() : split + 1;
+            mProgram[split].y = minimal ? split + 1 : mProgram.size();
+        } else {
+            QList<int> splits;
+            for ( int i = node->min; i < node->max; ++i ) {
+                splits << emit(Inst::Split);
+                if ( !compile(child) )
+                    return false;
+            }
+            foreach( int split, splits ) {
+                mProgram[split].x = minimal ? mProgram.size() : split + 1;
+                mProgram[split].y = minimal ? split + 1 : mProgram.size();
+            }
+        }
+        break;
+    }
+    case YRegExpNode::MatchStart:
+        emit(Inst::Save, 2 * (mCaptures + 1));
+        break;
+    case YRegExpNode::MatchEnd:
+        emit(Inst::Save, 2 * (mCaptures + 1) + 1);
+        break;
+    case YRegExpNode::LineStart:
+    case YRegExpNode::LineEnd:
+    case YRegExpNode::WordBoundary:
+    case YRegExpNode::NotWordBoundary:
+    case YRegExpNode::WordStart:
+    case YRegExpNode::WordEnd:
+        emit(Inst::Assert, node->type);
+        break;
+    case YRegExpNode::BackRef:
+    case YRegExpNode::LookAhead:
+    case YRegExpNode::NegativeLookAhead:
+        /* not regular */
+        return false;
+    }
+    return mProgram.size() <= YZIS_NFA_MAX_PROGRAM;
+}
+
+bool YNfaRegExpEngine::checkAssert( int type, const QString& str, int pos, int caretPos ) const
+{
+    if ( type == YRegExpNode::LineStart )
+        return pos == caretPos;
+    if ( type == YRegExpNode::LineEnd )
+        return pos == str.length();
+
+    bool before = pos > 0 && isWordChar(str.at(pos - 1));
+    bool after = pos < str.length() && isWordChar(str.at(pos));
+    switch ( type ) {
+    case YRegExpNode::WordBoundary:
+        return before != after;
+    case YRegExpNode::NotWordBoundary:
+        return before == after;
+    case YRegExpNode::WordStart:
+        return !before && after;
+    case YRegExpNode::WordEnd:
+        return before && !after;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Follows the empty transitions from @arg pc and adds the reached
+ * instructions to @arg list. Each instruction is added at most once, the
+ * first thread reaching it having the priority.
+ * @arg caps is used as working storage and restored on return.
+ */
+void YNfaRegExpEngine::addThread( ThreadList* list, int pc, int* caps, const QString& str, int pos, int caretPos ) const
+{
+    /* job with pc < 0 means: restore caps[slot] to value */
+    struct Job {
+        int pc;
+        int slot;
+        int value;
+    };
+    QVarLengthArray<Job, 64> stack;
+    Job job = { pc, 0, 0 };
+    stack.append(job);
+
+    while ( stack.size() ) {
+        job = stack[stack.size() - 1];
+        stack.resize(stack.size() - 1);
+        if ( job.pc < 0 ) {
+            caps[job.slot] = job.value;
+            continue;
+        }
+        pc = job.pc;
+        for ( ;; ) {
+            if ( list->marks[pc] == list->generation )
+                break;
+            list->marks[pc] = list->generation;
+            const Inst& inst = mProgram[pc];
+            if ( inst.op == Inst::Jmp ) {
+                pc = inst.x;
+            } else if ( inst.op == Inst::Split ) {
+                Job other = { inst.y, 0, 0 };
+                stack.append(other);
+                pc = inst.x;
+            } else if ( inst.op == Inst::Save ) {
+                Job restore = { -1, inst.x, caps[inst.x] };
+                stack.append(restore);
+                caps[inst.x] = pos;
+                ++pc;
+            } else if ( inst.op == Inst::Assert ) {
+                if ( !checkAssert(inst.x, str, pos, caretPos) )
+                    break;
+                ++pc;
+            } else {
+                int t = list->count++;
+                list->pcs[t] = pc;
+                qMemCopy(list->caps.data() + t * list->nsave, caps, list->nsave * sizeof(int));
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * Simulates the NFA over @arg str, for matches starting between @arg
+ * firstStart and @arg lastStart.
+ * If @arg latest is false, returns the start of the leftmost match and fills
+ * @arg caps with the longest (or shortest if @arg minimal) match at that start,
+ * or with the first one in mFirstMatch mode. \zs and \ze move the returned
+ * bounds.
+ * If @arg latest is true, returns the start of the rightmost match, caps
+ * are not filled.
+ * With @arg wholeString, only the matches ending at the end of @arg str count.
+ */
+int YNfaRegExpEngine::run( const QString& str, int firstStart, int lastStart, int caretPos, bool minimal, bool latest, bool wholeString, QVector<int>* caps ) const
+{
+    int len = str.length();
+    if ( firstStart > len )
+        return -1;
+    lastStart = qMin(lastStart, len);
+
+    int ncaps = 2 * (mCaptures + 1);
+    int nsave = ncaps + 2;
+    ThreadList* clist = mList1;
+    ThreadList* nlist = mList2;
+    clist->clear();
+    QVarLengthArray<int, 32> work(nsave);
+    QVarLengthArray<int, 32> best(nsave);
+
+    int found = -1;
+    int foundEnd = -1;
+
+    for ( int i = 0; i < nsave; ++i )
+        work[i] = -1;
+    addThread(clist, 0, work.data(), str, firstStart, caretPos);
+
+    for ( int pos = firstStart; ; ++pos ) {
+        nlist->clear();
+        bool seed = pos < lastStart && (latest || found < 0);
+        if ( seed && latest ) {
+            /* later starts have the priority */
+            for ( int i = 0; i < nsave; ++i )
+                work[i] = -1;
+            addThread(nlist, 0, work.data(), str, pos + 1, caretPos);
+        }
+
+        QChar c = pos < len ? str.at(pos) : QChar();
+        ushort fc = mCaseInsensitive ? foldChar(c) : c.unicode();
+        for ( int t = 0; t < clist->count; ++t ) {
+            const int* tcaps = clist->caps.constData() + t * nsave;
+            int start = tcaps[0];
+            if ( found >= 0 ) {
+                if ( latest && start <= found )
+                    continue;
+                if ( !latest && (start > found || (minimal && start == found)) )
+                    continue;
+            }
+            const Inst& inst = mProgram[clist->pcs[t]];
+            bool step = false;
+            bool cut = false;
+            switch ( inst.op ) {
+            case Inst::Match:
+                if ( wholeString && pos < len ) {
+                    break;
+                } else if ( latest ) {
+                    found = start;
+                } else if ( mFirstMatch ) {
+                    /* the threads left have a lower priority, the ones
+                     * kept may still find a better match */
+                    found = start;
+                    foundEnd = pos;
+                    qMemCopy(best.data(), tcaps, nsave * sizeof(int));
+                    cut = true;
+                } else if ( found < 0 || start < found || (start == found && pos > foundEnd) ) {
+                    found = start;
+                    foundEnd = pos;
+                    qMemCopy(best.data(), tcaps, nsave * sizeof(int));
+                }
+                break;
+            case Inst::Char:
+                step = pos < len && fc == inst.ch;
+                break;
+            case Inst::AnyChar:
+                step = pos < len;
+                break;
+            case Inst::Class:
+                step = pos < len && ( mClasses[inst.x].contains(c)
+                                      || ( mCaseInsensitive && ( mClasses[inst.x].contains(c.toLower())
+                                                                 || mClasses[inst.x].contains(c.toUpper()) ) ) );
+                break;
+            default:
+                break;
+            }
+            if ( step ) {
+                qMemCopy(work.data(), tcaps, nsave * sizeof(int));
+                addThread(nlist, clist->pcs[t] + 1, work.data(), str, pos + 1, caretPos);
+            }
+            if ( cut )
+                break;
+        }
+
+        if ( seed && !latest && found < 0 ) {
+            for ( int i = 0; i < nsave; ++i )
+                work[i] = -1;
+            addThread(nlist, 0, work.data(), str, pos + 1, caretPos);
+        }
+
+        if ( pos >= len || (nlist->count == 0 && !seed) )
+            break;
+        qSwap(clist, nlist);
+    }
+
+    if ( found < 0 || latest )
+        return found;
+    if ( best[ncaps] >= 0 )
+        best[0] = best[ncaps];
+    if ( best[ncaps + 1] >= 0 )
+        best[1] = qMax(best[0], best[ncaps + 1]);
+    if ( caps ) {
+        caps->resize(ncaps);
+        qMemCopy(caps->data(), best.data(), ncaps * sizeof(int));
+    }
+    return best[0];
+}
+
+YRegExpEngine* YNfaRegExpEngine::clone() const
+{
+    YNfaRegExpEngine* e = new YNfaRegExpEngine();
+    e->mProgram = mProgram;
+    e->mClasses = mClasses;
+    e->mCaptures = mCaptures;
+    e->mCaseInsensitive = mCaseInsensitive;
+    e->mMinimal = mMinimal;
+    e->mFirstMatch = mFirstMatch;
+    e->allocThreadLists();
+    return e;
+}
+
+YRegExp::Engine YNfaRegExpEngine::type() const
+{
+    return YRegExp::LinearEngine;
+}
+
+bool YNfaRegExpEngine::isValid() const
+{
+    return true;
+}
+
+int YNfaRegExpEngine::numCaptures() const
+{
+    return mCaptures;
+}
+
+int YNfaRegExpEngine::indexIn( const QString& str, int offset, YRegExp::CaretMode caretMode, QVector<int>* caps ) const
+{
+    int caretPos = caretMode == YRegExp::CaretAtOffset ? offset : 0;
+    return run(str, offset, str.length(), caretPos, mMinimal && !mFirstMatch, false, false, caps);
+}
+
+int YNfaRegExpEngine::lastIndexIn( const QString& str, int offset, YRegExp::CaretMode caretMode, QVector<int>* caps ) const
+{
+    int caretPos = caretMode == YRegExp::CaretAtOffset ? offset : 0;
+    bool minimal = mMinimal && !mFirstMatch;
+    int start = run(str, 0, offset, caretPos, minimal, true, false, NULL);
+    if ( start < 0 )
+        return -1;
+    return run(str, start, start, caretPos, minimal, false, false, caps);
+}
+
+bool YNfaRegExpEngine::exactMatch( const QString& str, QVector<int>* caps ) const
+{
+    QVector<int> c;
+    if ( run(str, 0, 0, 0, false, false, true, &c) < 0 || c.at(1) != str.length() )
+        return false;
+    if ( caps )
+        *caps = c;
+    return true;
+}
+
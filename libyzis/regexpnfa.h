@@ -0,0 +1,193 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+#ifndef YZ_REGEXPNFA_H
+#define YZ_REGEXPNFA_H
+
+/* Qt */
+#include <QChar>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+/* Yzis */
+#include "regexp.h"
+
+/**
+ * Set of characters matched by a [...] bracket expression or by one of the
+ * \\d \\s \\w escapes.
+ */
+struct YZIS_EXPORT YNfaCharClass
+{
+    enum Category {
+        Digit = 1,
+        NotDigit = 2,
+        Space = 4,
+        NotSpace = 8,
+        Word = 16,
+        NotWord = 32,
+    };
+
+    YNfaCharClass() : negated(false), categories(0)
+    {}
+
+    void addRange( ushort first, ushort last );
+    void addChar( QChar c )
+    {
+        addRange(c.unicode(), c.unicode());
+    }
+    bool contains( QChar c ) const;
+
+    bool negated;
+    int categories;
+    /* (first, last) pairs */
+    QVector<ushort> ranges;
+};
+
+/**
+ * Node of a parsed regular expression.
+ *
+ * The QRegExp syntax parser of YNfaRegExpEngine produces this tree, other
+ * pattern syntaxes can build it directly and get compiled to the same
+ * program.
+ */
+struct YZIS_EXPORT YRegExpNode
+{
+    enum Type {
+        Empty,
+        Char,
+        AnyChar,
+        Class,
+        Concat,
+        Alternation,
+        Repeat,
+        Group,
+        LineStart,
+        LineEnd,
+        WordBoundary,
+        NotWordBoundary,
+        WordStart,
+        WordEnd,
+        BackRef,
+        LookAhead,
+        NegativeLookAhead,
+        MatchStart, // \zs in the Vim syntax
+        MatchEnd, // \ze
+    };
+
+    YRegExpNode( Type t ) : type(t), min(0), max(-1), minimal(false), capture(-1)
+    {}
+    ~YRegExpNode()
+    {
+        qDeleteAll(children);
+    }
+
+    Type type;
+    QChar ch; // Char
+    YNfaCharClass cls; // Class
+    QList<YRegExpNode*> children; // Concat, Alternation, Repeat, Group, LookAhead, NegativeLookAhead
+    int min; // Repeat
+    int max; // Repeat, -1 for no upper bound
+    bool minimal; // Repeat, non greedy
+    int capture; // Group (-1 for non capturing groups), BackRef
+};
+
+/**
+ * Regexp engine simulating a Thompson NFA (Pike VM).
+ *
+ * All the alive NFA states are advanced together one character at a time,
+ * so the matching time is O(subject length * program size) whatever the
+ * pattern is: no backtracking can occur. The match is the leftmost-longest
+ * one (leftmost-shortest in minimal mode), as with QRegExp, or the one a
+ * backtracking engine finds first, as with Vim (see fromTree()).
+ *
+ * Back references and lookahead assertions cannot be simulated that way:
+ * fromPattern() returns NULL for such patterns and the caller is expected to
+ * fall back to another engine.
+ *
+ * The thread lists are kept from one match to the next, so an engine must
+ * not be used by two threads at once (each copy of a YRegExp has its own).
+ */
+class YZIS_EXPORT YNfaRegExpEngine : public YRegExpEngine
+{
+public:
+    virtual ~YNfaRegExpEngine();
+
+    /**
+     * Compiles @arg pattern written in the QRegExp syntax.
+     * Returns NULL if the pattern is invalid or not supported.
+     */
+    static YNfaRegExpEngine* fromPattern( const QString& pattern, Qt::CaseSensitivity cs, bool minimal );
+
+    /**
+     * Compiles the given tree, having @arg captures capturing groups.
+     * With @arg firstMatch, the match is the first one a backtracking
+     * engine would find, each repetition being greedy or not on its own
+     * (see YRegExpNode::minimal). Otherwise it is the leftmost-longest one.
+     * Returns NULL if the resulting program is too big or if the tree
+     * contains back references or lookaheads.
+     */
+    static YNfaRegExpEngine* fromTree( const YRegExpNode* root, int captures, Qt::CaseSensitivity cs, bool minimal, bool firstMatch = false );
+
+    /**
+     * Parses @arg pattern written in the QRegExp syntax.
+     * Returns NULL if the pattern is invalid or not supported.
+     */
+    static YRegExpNode* parse( const QString& pattern, int* captures );
+
+    virtual YRegExpEngine* clone() const;
+    virtual YRegExp::Engine type() const;
+    virtual bool isValid() const;
+    virtual int numCaptures() const;
+    virtual int indexIn( const QString& str, int offset, YRegExp::CaretMode caretMode, QVector<int>* caps ) const;
+    virtual int lastIndexIn( const QString& str, int offset, YRegExp::CaretMode caretMode, QVector<int>* caps ) const;
+    virtual bool exactMatch( const QString& str, QVector<int>* caps ) const;
+
+private:
+    YNfaRegExpEngine();
+
+    struct Inst {
+        enum Op { Char, AnyChar, Class, Split, Jmp, Save, Assert, Match };
+        Op op;
+        ushort ch;
+        int x;
+        int y;
+    };
+    struct ThreadList;
+
+    void allocThreadLists();
+    int emit( Inst::Op op, int x = 0, int y = 0, ushort ch = 0 );
+    bool compile( const YRegExpNode* node );
+    bool checkAssert( int type, const QString& str, int pos, int caretPos ) const;
+    void addThread( ThreadList* list, int pc, int* caps, const QString& str, int pos, int caretPos ) const;
+    int run( const QString& str, int firstStart, int lastStart, int caretPos, bool minimal, bool latest, bool wholeString, QVector<int>* caps ) const;
+
+    QVector<Inst> mProgram;
+    QVector<YNfaCharClass> mClasses;
+    int mCaptures;
+    bool mCaseInsensitive;
+    bool mMinimal;
+    bool mFirstMatch;
+    /* the thread lists of run(), sized once for the program */
+    ThreadList* mList1;
+    ThreadList* mList2;
+};
+
+#endif
+
@@ -28,6 +28,8 @@
 #include "session.h"
 #include "buffer.h"
 #include "selection.h"
+#include "line.h"
+#include "regexp.h"
 
 /* Qt */
 #include <QList>
@@ -39,16 +41,23 @@ struct YSearch::Private
 {
     void setCurrentSearch( const QString& pattern );
     YCursor doSearch( YBuffer *buffer, const YCursor from, const QString& pattern, bool reverse, bool skipline, bool* found );
-    void highlightSearch( YView *view, YSelectionMap searchMap );
+    void highlightSearch( YBuffer *buffer );
+    void scanLine( YBuffer *buffer, int line );
     bool active();
+    bool hlsearch();
 
     QString mCurrentSearch;
+    /* compiled mCurrentSearch, used to scan lines for hlsearch */
+    YRegExp mHlRegexp;
+    /* bumped each time the matches of all the lines become wrong */
+    int mHlVersion;
 };
 
 YSearch::YSearch()
         : d(new Private)
 {
     d->mCurrentSearch = QString();
+    d->mHlVersion = 1;
 }
 
 YSearch::~YSearch()
@@ -81,6 +90,11 @@ YCursor YSearch::replayBackward( YBuffer *buffer, bool* found, const YCursor fro
     return d->doSearch( buffer, from, d->mCurrentSearch, true, skipline, found );
 }
 
+void YSearch::setCurrentSearch( const QString& pattern )
+{
+    d->setCurrentSearch( pattern );
+}
+
 const QString& YSearch::currentSearch() const
 {
     return d->mCurrentSearch;
@@ -158,150 +172,75 @@ YCursor YSearch::Private::doSearch( YBuffer *buffer, const YCursor from, const Q
     return ret;
 }
 
+bool YSearch::Private::hlsearch()
+{
+    return active() && YSession::self()->getBooleanOption( "hlsearch" );
+}
+
 void YSearch::Private::setCurrentSearch( const QString& pattern )
 {
     if ( mCurrentSearch == pattern ) return ;
     mCurrentSearch = pattern;
+    mHlRegexp = YRegExp( pattern, Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax );
 
-    YSelectionMap searchMap;
-    foreach( YBuffer *b, YSession::self()->buffers() ) {
-        QList<YView*> views = b->views();
-
-        searchMap.clear();
-
-        /** search all **/
-        bool doIt = YSession::self()->getBooleanOption( "hlsearch" );
-        if ( doIt ) {
-            YView* v = views.front();
-            YCursor from( 0, 0 );
-            YCursor cur( from );
-            YCursor end;
-            end.setY( b->lineCount() - 1 );
-            end.setX( qMax( (int)(b->textline( end.y() ).length() - 1), 0 ) );
-
-            bool found = true;
-            int matchedLength = 0;
-            int pos = 0;
-            do {
-                from = b->action()->search( v->buffer(), mCurrentSearch, cur, end, &matchedLength, &found );
-                if ( found && matchedLength > 0 ) {
-                    cur = from;
-                    cur.setX( cur.x() + matchedLength - 1 );
-                    YInterval sel( from, cur );
-                    cur.setX( cur.x() + 1 );
-                    searchMap.insert( pos++, sel );
-                }
-            } while ( found );
-        }
-
-        foreach( YView *view, views )
-        highlightSearch( view, searchMap );
-    }
+    ++mHlVersion;
+    foreach( YBuffer *b, YSession::self()->buffers() )
+        highlightSearch( b );
 }
 
-void YSearch::highlightLine( YBuffer* buffer, int line )
-{
-    if ( d->mCurrentSearch.isNull() || d->mCurrentSearch.isEmpty() ) return ;
-    bool doIt = YSession::self()->getBooleanOption( "hlsearch" );
-    if ( doIt ) {
-        QList<YView*> views = buffer->views();
-        YView* v = views.front();
-        YCursor from( 0, line );
-        YCursor cur( from );
-        YCursor end( buffer->textline( line ).length(), line );
-
-        //XXX YSelection* searchMap = v->getSelectionPool()->search();
-        //XXX searchMap->delInterval( YInterval( from, end ) );
-
-        if ( end.x() > 0 ) end.setX( end.x() - 1 );
-
-        bool found;
-        int matchedLength = 0;
-        do {
-            from = buffer->action()->search( v->buffer(), d->mCurrentSearch, cur, end, &matchedLength, &found );
-            if ( found && matchedLength > 0 ) {
-                cur = from;
-                cur.setX( cur.x() + matchedLength - 1 );
-                //XXX searchMap->addInterval( YInterval( from, cur ) );
-                cur.setX( cur.x() + 1 );
-                //    dbg() << "cur = " << cur << "; end = " << end << endl;
-            }
-        } while ( found );
+/*
+ * Matches are stored on the YLine they belong to (see YLine::searchMatches),
+ * so the buffer line array is the line-keyed structure: lines moved by an
+ * insertion or a deletion carry their matches along and never need to be
+ * rescanned or relocated. A line whose text changed forgets its matches,
+ * and a new pattern bumps mHlVersion: either way the line is scanned
+ * again only once it is displayed.
+ */
+void YSearch::Private::scanLine( YBuffer *buffer, int line )
+{
+    YLine *yl = buffer->yzline( line );
+    if ( yl->searchVersion() == mHlVersion )
+        return ;
+    if ( ! hlsearch() ) {
+        yl->setSearchMatches( QVector<int>(), mHlVersion );
+        return ;
+    }
 
-        /*
-        foreach( YView *view, views ) {
-            XXX view->getSelectionPool()->setSearch( searchMap );
+    QVector<int> matches;
+    const QString& text = yl->data();
+    int pos = 0;
+    while ( pos <= text.length() ) {
+        int idx = mHlRegexp.indexIn( text, pos );
+        if ( idx < 0 )
+            break;
+        int len = mHlRegexp.matchedLength();
+        if ( len > 0 ) {
+            matches << idx << len;
+            pos = idx + len;
+        } else {
+            pos = idx + 1;
         }
-        */
     }
+    yl->setSearchMatches( matches, mHlVersion );
 }
 
-void YSearch::shiftHighlight( YBuffer* buffer, int fromLine, int shift )
+/* the displayed lines are scanned again while they are repainted */
+void YSearch::Private::highlightSearch( YBuffer *buffer )
 {
-    QList<YView*> views = buffer->views();
-    if ( views.isEmpty() ) // no views
-        return ;
-    YView* v = views.front();
-    if ( v ) {
-		//TODO
-#if 0
-        YSelectionMap searchMap = v->getSelectionPool()->search()->map();
-
-        if ( shift + fromLine < 0 ) fromLine = -shift;
-        int size = searchMap.size();
-        for ( int i = 0; i < size; i++ ) {
-            YCursor to = searchMap[ i ].toPos();
-            if ( to.y() < fromLine ) continue;
-
-            YCursor from = searchMap[ i ].fromPos();
-            from.setY( from.y() + shift);
-            to.setY( to.y() + shift);
-
-            searchMap[ i ].setFromPos( from );
-            searchMap[ i ].setToPos( to );
-        }
-
-        foreach( YView *view, views )
-        d->highlightSearch( view, searchMap );
-#else
-    Q_UNUSED(fromLine);
-    Q_UNUSED(shift);
-#endif
-    }
+    foreach( YView *view, buffer->views() )
+        view->updateBufferInterval( 0, buffer->lineCount() - 1 );
 }
 
-void YSearch::Private::highlightSearch( YView *view, YSelectionMap searchMap )
+void YSearch::highlightLine( YBuffer* buffer, int line )
 {
-	//TODO
-#if 0
-    view->setPaintAutoCommit( false );
-    YSelection* vMap = view->getSelectionPool()->search();
-    vMap->clear();
-    if ( YSession::self()->getBooleanOption( "hlsearch" ) ) {
-        vMap->setMap( searchMap );
-        //  dbg() << "new search Map : " << *(vMap) << endl;
-    }
-    view->commitPaintEvent();
-#else
-    Q_UNUSED(view);
-    Q_UNUSED(searchMap);
-#endif
+    if ( line < 0 || line >= buffer->lineCount() ) return ;
+    d->scanLine( buffer, line );
 }
 
 void YSearch::update()
 {
     if ( ! active() ) return ;
-    if ( YSession::self()->getBooleanOption( "hlsearch" ) ) {
-        // force creating hl selection
-        QString pattern = d->mCurrentSearch;
-        d->mCurrentSearch = "";
-        d->setCurrentSearch( pattern );
-    } else {
-        YSelectionMap searchMap;
-        // clear current hl search selection
-        foreach( YBuffer *b, YSession::self()->buffers())
-        foreach( YView *view, b->views() )
-        d->highlightSearch( view, searchMap );
-    }
+    ++d->mHlVersion;
+    foreach( YBuffer *b, YSession::self()->buffers() )
+        d->highlightSearch( b );
 }
-
@@ -60,14 +60,16 @@ public :
     YCursor replayBackward( YBuffer *buffer, bool* found, const YCursor from, bool skipline = false );
 
     /**
-     * Highlight given line
+     * Scans the given line for hlsearch matches, if the pattern or the
+     * line changed since it was last scanned. The views call it on the
+     * lines they display, the others are never scanned.
      */
     void highlightLine( YBuffer* buffer, int line );
 
     /**
-     * Shift @arg shift lines to the bottom the search highlight layout from @ærg line line
+     * Sets the pattern used by the search replays and hlsearch, without searching
      */
-    void shiftHighlight( YBuffer* buffer, int line, int shift );
+    void setCurrentSearch( const QString& pattern );
 
     /**
      * return current search
@@ -80,7 +82,8 @@ public :
     bool active();
 
     /**
-     * take care of correctly updating hl
+     * Forgets the hlsearch matches of all the lines (the pattern or the
+     * hlsearch option changed) and repaints the views
      */
     void update();
 
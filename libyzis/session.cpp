@@ -115,6 +115,9 @@ void YSession::init()
         dbg() << "Yzis SAFE MODE enabled." << endl;
     }
     mSearch = new YSearch();
+    mProcessingEvents = false;
+    mInterrupted = false;
+    mKeyDepth = 0;
     mCurView = 0;
     mCurBuffer = 0;
     events = new YEvents();
@@ -666,9 +669,51 @@ CmdState YSession::sendMultipleKeys( YView * view, YKeySequence & inputs)
     return state;
 }
 
+bool YSession::processPendingEvents()
+{
+    if ( !mProcessingEvents ) {
+        mProcessingEvents = true;
+        QCoreApplication::instance()->processEvents();
+        mProcessingEvents = false;
+    }
+    return mInterrupted;
+}
+
 CmdState YSession::sendKey( YView * view, YKey _key)
 {
     dbg() << "sendKey( " << view << ", key=" << _key.toString() << ")" << endl;
+
+    // a long operation is running, see processPendingEvents
+    if ( mProcessingEvents ) {
+        if ( _key.key() == Qt::Key_C && (_key.modifiers() & Qt::ControlModifier) ) {
+            mInterrupted = true;
+            mPendingKeys.clear();
+        } else {
+            mPendingKeys.append( qMakePair(view, _key) );
+        }
+        return CmdOk;
+    }
+
+    ++mKeyDepth;
+    CmdState state = execKey( view, _key );
+    --mKeyDepth;
+
+    // the keys typed during a long operation, in order
+    while ( mKeyDepth == 0 && state != CmdQuit && !mPendingKeys.isEmpty() ) {
+        QPair<YView*, YKey> pending = mPendingKeys.takeFirst();
+        if ( mViewList.contains(pending.first) ) {
+            ++mKeyDepth;
+            state = execKey( pending.first, pending.second );
+            --mKeyDepth;
+        }
+    }
+    if ( state == CmdQuit )
+        mPendingKeys.clear();
+    return state;
+}
+
+CmdState YSession::execKey( YView * view, YKey _key )
+{
     CmdState state;
 
     // Don't respond to pure modifier keys
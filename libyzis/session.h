@@ -26,6 +26,7 @@
 
 /* Qt */
 #include <QPoint>
+#include <QPair>
 
 /* yzis */
 //#include "cursor.h"
@@ -496,6 +497,41 @@ public:
     /** Copied from view */
     CmdState sendMultipleKeys( YView * view, YKeySequence &keys);
 
+    /**
+     * Long operations (like a :s on a huge range) call this regularly to
+     * let the gui refresh itself. Meanwhile, the keys sent by the gui are
+     * not executed: <C-c> interrupts the operation and drops the keys typed
+     * ahead, the others are queued and sent once the key which started the
+     * operation is done.
+     * @return true if the operation was interrupted
+     */
+    bool processPendingEvents();
+
+    /**
+     * Returns true while processPendingEvents runs the event loop, the
+     * timers must not touch the buffers then.
+     */
+    bool isProcessingEvents() const
+    {
+        return mProcessingEvents;
+    }
+
+    /**
+     * Returns true if <C-c> was pressed during processPendingEvents
+     */
+    bool isInterrupted() const
+    {
+        return mInterrupted;
+    }
+
+    /**
+     * Long operations call this once they are done (or cancelled)
+     */
+    void resetInterrupt()
+    {
+        mInterrupted = false;
+    }
+
     //-------------------------------------------------------
     // ----------------- Send events to GUI
     //-------------------------------------------------------
@@ -547,6 +583,11 @@ private:
      */
     static YSession* mInstance;
 
+    /**
+     * Does the work of sendKey for one key
+     */
+    CmdState execKey( YView * view, YKey _key );
+
     QString mInitkeys;
     QString mLuaScript;
     YView* mCurView;
@@ -562,6 +603,11 @@ private:
     YInfo* mYzisinfo;
     YTagStack *mTagStack;
     YResourceMgr * mResourceMgr;
+    bool mProcessingEvents;
+    bool mInterrupted;
+    /* nesting of sendKey, the queued keys are sent at the outermost one */
+    int mKeyDepth;
+    QList< QPair<YView*, YKey> > mPendingKeys;
 
 };
 
@@ -207,6 +207,9 @@ void YSwapFile::replay( YBufferOperation::OperationType type, const YInterval& i
     case YBufferOperation::OpDelRegion:
         mParent->deleteRegion(interval);
         break;
+    case YBufferOperation::OpReplaceLines:
+        mParent->replaceLines(interval.fromPos().line(), interval.toPos().line() - 1, data);
+        break;
     }
 }
 
@@ -37,6 +37,7 @@ QString YBufferOperation::toString() const
     switch ( type ) {
 		case OpAddRegion: ots = "OpAddText"; break;
 		case OpDelRegion: ots = "OpDelRegion"; break;
+		case OpReplaceLines: ots = "OpReplaceLines"; break;
     }
 	return QString("%1 %2 '%3'").arg(ots).arg(interval.toString()).arg(data.join("\\n"));
 }
@@ -51,6 +52,7 @@ void YBufferOperation::performOperation( YView* pView, bool opposite)
         switch ( type ) {
 			case OpAddRegion: t = OpDelRegion; break;
 			case OpDelRegion: t = OpAddRegion; break;
+			case OpReplaceLines: break;
         }
     }
 
@@ -61,6 +63,14 @@ void YBufferOperation::performOperation( YView* pView, bool opposite)
 		case OpDelRegion:
 			pView->buffer()->deleteRegion(interval);
 			break;
+		case OpReplaceLines:
+			if ( opposite ) {
+				int from = interval.fromPos().line();
+				pView->buffer()->replaceLines(from, from + data.count() - 1, replacedData);
+			} else {
+				pView->buffer()->replaceLines(interval.fromPos().line(), interval.toPos().line() - 1, data);
+			}
+			break;
     }
 
     // yzDebug("YZUndoBuffer") << "YBufferOperation::performOperation Buf -> '" << buf->getWholeText() << "'\n";
@@ -85,6 +95,7 @@ YZUndoBuffer::YZUndoBuffer( YBuffer * buffer )
 {
     mCurrentIndex = 0;
     mInsideUndo = false;
+    mGroupLevel = 0;
 
     // Create the mFutureUndoItem
     commitUndoItem(0, 0);
@@ -105,6 +116,7 @@ YZUndoBuffer::~YZUndoBuffer()
 void YZUndoBuffer::commitUndoItem(uint cursorX, uint cursorY )
 {
     if (mInsideUndo == true) return ;
+    if (mGroupLevel > 0) return ;
     if (mFutureUndoItem && mFutureUndoItem->count() == 0) return ;
 
     if (mFutureUndoItem) {
@@ -122,7 +134,8 @@ void YZUndoBuffer::commitUndoItem(uint cursorX, uint cursorY )
 
 void YZUndoBuffer::addBufferOperation( YBufferOperation::OperationType type,
                                        const YRawData& data,
-                                       const YInterval& interval )
+                                       const YInterval& interval,
+                                       const YRawData& replacedData )
 {
     if (mInsideUndo == true) return ;
     YASSERT( mFutureUndoItem != NULL );
@@ -130,6 +143,7 @@ void YZUndoBuffer::addBufferOperation( YBufferOperation::OperationType type,
     bufOperation->type = type;
     bufOperation->data = data;
     bufOperation->interval = interval;
+    bufOperation->replacedData = replacedData;
     mFutureUndoItem->push_back( bufOperation );
     removeUndoItemAfterCurrent();
 }
@@ -41,6 +41,7 @@ struct YBufferOperation
     enum OperationType {
 		OpAddRegion, //!< insert a block of text at a given position
 		OpDelRegion, //!< delete a block of text inside a given interval
+		OpReplaceLines, //!< replace the lines of the interval by the data lines
     };
 
     /**  Perform the buffer operation on the buffer passed in argument.
@@ -51,6 +52,8 @@ struct YBufferOperation
     OperationType type;
     YRawData data;
     YInterval interval;
+    /** For OpReplaceLines, the lines which were replaced by data */
+    YRawData replacedData;
 
     QString toString() const;
 };
@@ -83,7 +86,7 @@ public:
      */
     void commitUndoItem( uint cursorX, uint cursorY );
 
-	void addBufferOperation( YBufferOperation::OperationType type, const YRawData& data, const YInterval& interval );
+	void addBufferOperation( YBufferOperation::OperationType type, const YRawData& data, const YInterval& interval, const YRawData& replacedData = YRawData() );
 
     /**
      * Undo the last operations on the buffer, move backward in the undo list.
@@ -116,6 +119,17 @@ public:
         return mInsideUndo;
     }
 
+    /** While a group is open, commitUndoItem does nothing: all the
+     * operations (of a :global for instance) end up in a single undo item */
+    void beginGroup()
+    {
+        ++mGroupLevel;
+    }
+    void endGroup()
+    {
+        --mGroupLevel;
+    }
+
     void clearUndo()
     {
         mUndoItemList.clear();
@@ -144,6 +158,7 @@ protected:
     QList<UndoItem*> mUndoItemList;
     uint mCurrentIndex;
     bool mInsideUndo;
+    int mGroupLevel;
 };
 
 #endif // YZ_UNDO_H
@@ -35,6 +35,7 @@
 #include "mode_pool.h"
 #include "action.h"
 #include "session.h"
+#include "search.h"
 #include "kate/syntaxhighlight.h"
 #include "linesearch.h"
 #include "folding.h"
@@ -52,6 +53,9 @@ static const YColor blue(Qt::blue);
 #define dbg() yzDebug("YView")
 #define err() yzError("YView")
 
+/* number of line layouts kept by a view */
+#define LAYOUT_CACHE_SIZE 4096
+
 YViewIface::~YViewIface()
 {}
 
@@ -68,9 +72,13 @@ YView::YView(YBuffer *_b, YSession *sess, int cols, int lines)
 	mSession(sess),
 	mBuffer(_b),
 	mMainCursor(),
+	mHighlightAttributes(NULL),
 	mStickyColumn(0),
+	tabstop(0),
+	wrap(false),
 	mSelectionPool(),
 	mPaintSelection(),
+	opt_list(false),
 	id(nextId++)
 {
 	YASSERT(mSession);
@@ -122,6 +130,10 @@ void YView::setVisibleArea( int c, int l )
 {
     dbg() << "setVisibleArea(" << c << "," << l << ")" << endl;
 	if ( c != mDrawBuffer.screenWidth() || l != mDrawBuffer.screenHeight() ) {
+		/* the wrapped lines are laid out again */
+		if ( wrap && c != mDrawBuffer.screenWidth() ) {
+			mLayoutCache.clear();
+		}
 		mDrawBuffer.setScreenSize(c, l);
         recalcScreen();
 	}
@@ -129,19 +141,37 @@ void YView::setVisibleArea( int c, int l )
 
 void YView::updateInternalAttributes()
 {
+    /* the layouts kept were made with these settings */
+    int old_tabstop = tabstop;
+    bool old_wrap = wrap;
+    bool old_list = opt_list;
+    QString old_listchars = QString(opt_listchars_space) + opt_listchars_trail + opt_listchars_tab + opt_listchars_tabfill;
+    YzisAttribute* old_attributes = mHighlightAttributes;
+
     tabstop = getLocalIntegerOption("tabstop");
     wrap = getLocalBooleanOption( "wrap" );
     rightleft = getLocalBooleanOption( "rightleft" );
     opt_list = getLocalBooleanOption( "list" );
     opt_listchars = getLocalMapOption( "listchars" );
+    opt_listchars_space = opt_listchars[ "space" ].length() > 0 ? opt_listchars[ "space" ][ 0 ] : QChar(' ');
+    opt_listchars_trail = opt_listchars[ "trail" ].length() > 0 ? opt_listchars[ "trail" ][ 0 ] : opt_listchars_space;
+    opt_listchars_tab = opt_listchars[ "tab" ].length() > 0 ? opt_listchars[ "tab" ][ 0 ] : tabChar;
+    opt_listchars_tabfill = opt_listchars[ "tab" ].length() > 1 ? opt_listchars[ "tab" ][ 1 ] : QChar(' ');
 
     opt_schema = getLocalIntegerOption( "schema" );
+    mFoldPool->setSyntaxFolding( getLocalStringOption( "foldmethod" ) == "syntax" );
 	YzisHighlighting* highlight = mBuffer->highlight();
 	if ( highlight ) {
 		mHighlightAttributes = highlight->attributes(opt_schema)->data();
 	} else {
 		mHighlightAttributes = NULL;
 	}
+
+	QString listchars = QString(opt_listchars_space) + opt_listchars_trail + opt_listchars_tab + opt_listchars_tabfill;
+	if ( tabstop != old_tabstop || wrap != old_wrap || opt_list != old_list
+			|| listchars != old_listchars || mHighlightAttributes != old_attributes ) {
+		mLayoutCache.clear();
+	}
 }
 
 void YView::refreshScreen()
@@ -585,7 +615,7 @@ bool YView::isLineVisible( int l ) const
 
 const YColor& YView::drawColor ( int col, int line ) const
 {
-    YLine *yl = mBuffer->yzline( line );
+    YLine *yl = mBuffer->yzline( line, false );
     YzisHighlighting * highlight = mBuffer->highlight();
     const uchar* hl = NULL;
     YzisAttribute *at = NULL;
@@ -794,6 +824,17 @@ void YView::sendRefreshEvent( )
     sendPaintEvent(YInterval(YCursor(0,0), YBound(YCursor(0,mDrawBuffer.screenHeight()), true)));
 }
 
+void YView::highlightAttributesChanged()
+{
+	YzisHighlighting* highlight = mBuffer->highlight();
+	mHighlightAttributes = highlight ? highlight->attributes(opt_schema)->data() : NULL;
+	mLayoutCache.clear();
+	/* the cells of the draw buffer hold the old colors, only the lines it
+	 * holds are drawn again */
+	if ( mDrawBuffer.lastBufferLine() >= mDrawBuffer.firstBufferLine() )
+		updateBufferInterval(mDrawBuffer.firstBufferLine(), mDrawBuffer.lastBufferLine());
+}
+
 bool YView::stringHasOnlySpaces ( const QString& what ) const
 {
     for (int i = 0 ; i < what.length(); i++)
@@ -891,63 +932,57 @@ YDrawLine YView::drawLineFromYLine( const YLine* yl, int start_column ) const
 {
 	YDrawLine dl;
 
-	QString data = yl->data();
-    const uchar* hl = mHighlightAttributes ? yl->attributes() : NULL;
+	const QString& data = yl->data();
+	int length = data.length();
+	const uchar* hl = mHighlightAttributes ? yl->attributes() : NULL;
+
+	/* the spaces from there are trailing */
+	int trail = length;
+	while ( trail > 0 && data.at(trail - 1).isSpace() ) {
+		--trail;
+	}
 
-	QString text;
-	QChar fillChar;
 	YColor fg, bg, outline;
 	YFont font;
 	YzisAttribute* last_at = NULL;
 	YzisAttribute* at = NULL;
 	bool last_is_listchar = false;
-	bool is_listchar;
-	int drawLength;
+	const QVector<int>& matches = yl->searchMatches();
+	int match = 0;
+	bool last_is_match = false;
 	int column = start_column;
 
-	for ( int i = 0; i < data.length(); ++i ) {
-
-		text = data.at(i);
-
-		fillChar = ' ';
-		if ( text == tabChar ) {
-			drawLength = tabstop - column % tabstop;
-			/* column + drawLength = 0 mod tabstop */
-		} else {
-			drawLength = 1;
-		}
-
+	/* the characters are drawn by runs sharing the same attributes,
+	 * only tabs are drawn one by one */
+	int i = 0;
+	while ( i < length ) {
+		QChar c = data.at(i);
+		bool is_tab = c == tabChar;
 		/* :set list support */
-		is_listchar = opt_list && (text == " " || text == tabChar);
-		if ( is_listchar ) {
-			if ( text == " " ) {
-				if ( stringHasOnlySpaces(data.mid(i)) && opt_listchars[ "trail" ].length() > 0 ) {
-					text = opt_listchars["trail"][0];
-				} else if ( opt_listchars["space"].length() > 0 ) {
-					text = opt_listchars["space"][0];
-				}
-			} else if ( text == tabChar ) {
-				if ( opt_listchars["tab"].length() > 0 ) {
-					text = opt_listchars["tab"][0];
-					if ( opt_listchars["tab"].length() > 1 ) {
-						fillChar = opt_listchars["tab"][1];
-					}
-				}
-			}
-		} else {
-			if ( text == tabChar ) {
-				text = " ";
-			}
-		}
+		bool is_listchar = opt_list && (is_tab || c == ' ');
 
-		if ( drawLength > 1 ) {
-			text = text.leftJustified(drawLength, fillChar);
+		/* hlsearch, the run stops where the match starts or ends */
+		while ( match < matches.size() && i >= matches[match] + matches[match+1] ) {
+			match += 2;
+		}
+		bool is_match = match < matches.size() && i >= matches[match];
+		int run_end = length;
+		if ( match < matches.size() ) {
+			run_end = is_match ? matches[match] + matches[match+1] : matches[match];
 		}
 
 		/* syntax highlighting attributes */
 		if ( hl ) {
-			at = &mHighlightAttributes[*hl];
-			++hl;
+			at = &mHighlightAttributes[hl[i]];
+		}
+
+		if ( is_match != last_is_match ) {
+			if ( is_match ) {
+				dl.addSelection(yzis::SelectionSearch);
+			} else {
+				dl.delSelection(yzis::SelectionSearch);
+			}
+			last_is_match = is_match;
 		}
 
 		if ( i == 0 || last_at != at || is_listchar != last_is_listchar ) {
@@ -982,14 +1017,64 @@ YDrawLine YView::drawLineFromYLine( const YLine* yl, int start_column ) const
 			last_at = at;
 			last_is_listchar = is_listchar;
 		}
-		column += dl.step(text);
+
+		if ( is_tab ) {
+			/* column + drawLength = 0 mod tabstop */
+			int drawLength = tabstop - column % tabstop;
+			QString text;
+			if ( opt_list ) {
+				text = QString(drawLength, opt_listchars_tabfill);
+				text[0] = opt_listchars_tab;
+			} else {
+				text = QString(drawLength, ' ');
+			}
+			column += dl.step(text);
+			++i;
+			continue;
+		}
+
+		int j = i + 1;
+		if ( is_listchar ) {
+			/* spaces, the trailing ones are drawn apart */
+			if ( i < trail ) {
+				run_end = qMin(run_end, trail);
+			}
+			while ( j < run_end && data.at(j) == ' ' && ( !hl || hl[j] == hl[i] ) ) {
+				++j;
+			}
+			QChar lc = i >= trail ? opt_listchars_trail : opt_listchars_space;
+			column += dl.stepChars(QString(j - i, lc));
+		} else {
+			while ( j < run_end && ( !hl || hl[j] == hl[i] ) ) {
+				QChar n = data.at(j);
+				if ( n == tabChar || ( opt_list && n == ' ' ) ) {
+					break;
+				}
+				++j;
+			}
+			column += dl.stepChars(data.mid(i, j - i));
+		}
+		i = j;
 	}
 
 	return dl;
 }
 
 YDrawSection YView::drawSectionOfBufferLine( int bl ) const {
-	const YLine* yl = mBuffer->yzline(bl);
+	/* the line is highlighted only now that it is displayed, and so are
+	 * its search matches */
+	const YLine* yl = mBuffer->yzline(bl, false);
+	YSession::self()->search()->highlightLine(mBuffer, bl);
+
+	/* the layout of a line seen before is used again while the line keeps
+	 * the same text: its data is still the one shared with the layout */
+	QHash<const YLine*, YDrawLayout>::const_iterator it = mLayoutCache.constFind(yl);
+	if ( it != mLayoutCache.constEnd() && it.value().text.constData() == yl->data().constData()
+			&& it.value().matches == yl->searchMatches()
+			&& ( mHighlightAttributes == NULL || it.value().attributes == yl->attributeVector() ) ) {
+		return it.value().section;
+	}
+
 	YDrawLine dl = drawLineFromYLine(yl);
 	YDrawSection ds;
 	if ( wrap ) {
@@ -997,6 +1082,15 @@ YDrawSection YView::drawSectionOfBufferLine( int bl ) const {
 	} else {
 		ds << dl;
 	}
+
+	if ( mLayoutCache.size() >= LAYOUT_CACHE_SIZE ) {
+		mLayoutCache.clear();
+	}
+	YDrawLayout& layout = mLayoutCache[yl];
+	layout.text = yl->data();
+	layout.attributes = yl->attributeVector();
+	layout.matches = yl->searchMatches();
+	layout.section = ds;
 	return ds;
 }
 
@@ -24,6 +24,7 @@
 #define YZ_VIEW_H
 
 #include <QString>
+#include <QHash>
 
 /* yzis */
 #include "viewiface.h"
@@ -53,6 +54,19 @@ class YOptionValue;
 
 class YZFoldPool;
 
+/**
+ * The layout of a buffer line kept by a view. It holds the text,
+ * attributes and search matches it was made from: they are implicitly
+ * shared with the line as long as the line doesn't change.
+ */
+struct YDrawLayout
+{
+    QString text;
+    QVector<uchar> attributes;
+    QVector<int> matches;
+    YDrawSection section;
+};
+
 /**
  * MUST be reimplemented in the GUI. 
  * It's the basis to display the content of a buffer.
@@ -381,6 +395,13 @@ class YZIS_EXPORT YView : public YViewIface
      */
     void sendRefreshEvent();
 
+    /**
+     * The colors or fonts of the highlighting attributes changed, draws
+     * the displayed lines again with them. The lines are not highlighted
+     * again.
+     */
+    void highlightAttributesChanged();
+
 	/*
 	 * Ask for repainting interval @arg i of screen.
 	 */
@@ -642,8 +663,19 @@ private:
     int opt_schema;
     bool opt_list;
     MapOption opt_listchars;
+    /// the characters of listchars drawn for spaces and tabs
+    QChar opt_listchars_space;
+    QChar opt_listchars_trail;
+    QChar opt_listchars_tab;
+    QChar opt_listchars_tabfill;
     YZFoldPool* mFoldPool;
 
+    /**
+     * layouts of the lines seen, they are made again when the line or
+     * the settings of the view change
+     */
+    mutable QHash<const YLine*, YDrawLayout> mLayoutCache;
+
     const int id;
 };
 
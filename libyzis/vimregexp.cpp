@@ -0,0 +1,1050 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+/* Yzis */
+#include "vimregexp.h"
+#include "regexpnfa.h"
+#include "debug.h"
+#include "yzis.h"
+
+/* Qt */
+#include <QHash>
+#include <QMutex>
+
+/* Std */
+#include <string.h>
+
+#define dbg()    yzDebug("YVimRegExp")
+#define err()    yzError("YVimRegExp")
+
+/* compiled patterns kept around, the whole cache is dropped when full */
+#define YZIS_VIM_REGEXP_CACHE_SIZE 64
+
+namespace
+{
+/* the chars which may have a special meaning, with or without a backslash
+ * depending on the magic level */
+const char vimMetaChars[] = "^$.*[~()|+=?{@%<>&";
+
+enum MagicLevel {
+    VeryNoMagic, // \V
+    NoMagic, // \M
+    Magic, // \m
+    VeryMagic, // \v
+};
+
+/* (first, last) pairs of ascii chars */
+struct VimClass {
+    const char* name;
+    const char* ranges;
+    bool negated;
+    bool nonAscii;
+};
+
+const VimClass vimLetterClasses[] = {
+    { "d", "09", false, false },
+    { "D", "09", true, false },
+    /* all the blanks: the line break chars can't appear inside a line */
+    { "s", "\t\r  ", false, false },
+    { "S", "\t\r  ", true, false },
+    { "w", "09AZaz__", false, false },
+    { "W", "09AZaz__", true, false },
+    { "x", "09AFaf", false, false },
+    { "X", "09AFaf", true, false },
+    { "o", "07", false, false },
+    { "O", "07", true, false },
+    { "h", "AZaz__", false, false },
+    { "H", "AZaz__", true, false },
+    { "a", "AZaz", false, false },
+    { "A", "AZaz", true, false },
+    { "l", "az", false, false },
+    { "L", "az", true, false },
+    { "u", "AZ", false, false },
+    { "U", "AZ", true, false },
+    /* the uppercase versions of these ones exclude the digits, the
+     * 'iskeyword', 'isident', 'isfname' and 'isprint' default values
+     * are used */
+    { "i", "09AZaz__", false, true },
+    { "I", "AZaz__", false, true },
+    { "k", "09AZaz__", false, true },
+    { "K", "AZaz__", false, true },
+    { "f", "09AZaz//..--__++,,##$$%%~~==", false, true },
+    { "F", "AZaz//..--__++,,##$$%%~~==", false, true },
+    { "p", " ~", false, true },
+    { "P", " /:~", false, true },
+    { 0, 0, false, false },
+};
+
+const VimClass vimNamedClasses[] = {
+    { "alnum", "09AZaz", false, false },
+    { "alpha", "AZaz", false, false },
+    { "blank", "\t\t  ", false, false },
+    { "cntrl", "\x01\x1f\x7f\x7f", false, false },
+    { "digit", "09", false, false },
+    { "graph", "!~", false, false },
+    { "lower", "az", false, false },
+    { "print", " ~", false, false },
+    { "punct", "!/:@[`{~", false, false },
+    { "space", "\t\r  ", false, false },
+    { "upper", "AZ", false, false },
+    { "xdigit", "09AFaf", false, false },
+    { "return", "\r\r", false, false },
+    { "tab", "\t\t", false, false },
+    { "escape", "\x1b\x1b", false, false },
+    { "backspace", "\b\b", false, false },
+    { 0, 0, false, false },
+};
+
+const VimClass* findClass( const VimClass* table, const QString& name )
+{
+    for ( ; table->name; ++table ) {
+        if ( name == QLatin1String(table->name) )
+            return table;
+    }
+    return NULL;
+}
+
+void addClass( YNfaCharClass* cls, const VimClass* c )
+{
+    for ( const char* r = c->ranges; *r; r += 2 )
+        cls->addRange(r[0], r[1]);
+    if ( c->nonAscii )
+        cls->addRange(0xa0, 0xffff);
+}
+
+struct VimToken {
+    QChar c; // null at the end of the pattern
+    bool magic; // c has its special meaning
+    int end; // position following the token
+};
+
+class VimSyntaxParser
+{
+public:
+    VimSyntaxParser( const QString& pattern, Qt::CaseSensitivity cs, const QString& substitute ) :
+            mPattern(pattern), mSubstitute(substitute), mPos(0), mCaptures(0), mMaxBackRef(0),
+            mMagic(Magic), mCs(cs), mMinimal(false)
+    {}
+
+    YRegExpNode* parse()
+    {
+        YRegExpNode* root = parseAlternation();
+        if ( root && !peekToken().c.isNull() ) {
+            /* unbalanced \) */
+            delete root;
+            root = fail(_("E55: Unmatched \\)"));
+        }
+        if ( root && mMaxBackRef > mCaptures ) {
+            delete root;
+            root = fail(_("E65: Illegal back reference"));
+        }
+        return root;
+    }
+
+    int captures() const
+    {
+        return mCaptures;
+    }
+    Qt::CaseSensitivity caseSensitivity() const
+    {
+        return mCs;
+    }
+    bool minimal() const
+    {
+        return mMinimal;
+    }
+    QString error() const
+    {
+        return mError;
+    }
+
+private:
+    /* keeps the first error, the callers only see NULL */
+    YRegExpNode* fail( const QString& error )
+    {
+        if ( mError.isEmpty() )
+            mError = error;
+        return NULL;
+    }
+    bool atEnd() const
+    {
+        return mPos >= mPattern.length();
+    }
+    QChar peek() const
+    {
+        return mPattern.at(mPos);
+    }
+    bool isMagic( const VimToken& t, char c ) const
+    {
+        return t.magic && t.c == QLatin1Char(c);
+    }
+
+    VimToken peekToken();
+    bool dollarIsLineEnd();
+    YRegExpNode* parseAlternation();
+    YRegExpNode* parseBranch();
+    YRegExpNode* parseConcat();
+    YRegExpNode* parsePiece( bool atStart );
+    YRegExpNode* parseAtom( bool atStart );
+    YRegExpNode* parseLetter( QChar c );
+    YRegExpNode* parsePercent();
+    YRegExpNode* parseGroup( int capture );
+    YRegExpNode* parseCollection();
+    bool parseCollectionItems( YNfaCharClass* cls );
+    bool parseCollectionChar( QChar* c );
+    bool parseBrace( int* min, int* max, bool* minimal );
+    bool parseCharCode( QChar kind, QChar* c );
+    int parseNumber( int base, int maxDigits );
+
+    QString mPattern;
+    /* what ~ matches */
+    QString mSubstitute;
+    int mPos;
+    int mCaptures;
+    int mMaxBackRef;
+    MagicLevel mMagic;
+    Qt::CaseSensitivity mCs;
+    /* a non greedy repetition is used */
+    bool mMinimal;
+    QString mError;
+};
+
+/*
+ * Returns the token at mPos, telling whether it has its special meaning at
+ * the current magic level. The flag items (\v \m \M \V \c \C \Z) are
+ * consumed on the way.
+ */
+VimToken VimSyntaxParser::peekToken()
+{
+    while ( mPos + 1 < mPattern.length() && peek() == QLatin1Char('\\') ) {
+        QChar e = mPattern.at(mPos + 1);
+        if ( e == QLatin1Char('v') ) {
+            mMagic = VeryMagic;
+        } else if ( e == QLatin1Char('m') ) {
+            mMagic = Magic;
+        } else if ( e == QLatin1Char('M') ) {
+            mMagic = NoMagic;
+        } else if ( e == QLatin1Char('V') ) {
+            mMagic = VeryNoMagic;
+        } else if ( e == QLatin1Char('c') ) {
+            mCs = Qt::CaseInsensitive;
+        } else if ( e == QLatin1Char('C') ) {
+            mCs = Qt::CaseSensitive;
+        } else if ( e != QLatin1Char('Z') ) {
+            break;
+        }
+        mPos += 2;
+    }
+
+    VimToken t;
+    t.end = mPos;
+    t.magic = true;
+    if ( atEnd() )
+        return t;
+
+    /* metas which are special without a backslash */
+    const char* plain = "";
+    switch ( mMagic ) {
+    case VeryMagic: plain = vimMetaChars; break;
+    case Magic: plain = "^$.*[~"; break;
+    case NoMagic: plain = "^$"; break;
+    case VeryNoMagic: break;
+    }
+
+    QChar c = peek();
+    ushort u = c.unicode();
+    if ( c == QLatin1Char('\\') && mPos + 1 < mPattern.length() ) {
+        /* a backslash toggles the meaning of the metas, makes the
+         * letters and digits special and the other chars literal */
+        c = mPattern.at(mPos + 1);
+        u = c.unicode();
+        t.c = c;
+        t.end = mPos + 2;
+        if ( u != 0 && u < 0x80 && strchr(vimMetaChars, u) )
+            t.magic = !strchr(plain, u);
+        else
+            t.magic = u < 0x80 && ( c.isLetterOrNumber() || c == QLatin1Char('_') );
+        return t;
+    }
+    t.c = c;
+    t.end = mPos + 1;
+    t.magic = u != 0 && u < 0x80 && strchr(plain, u);
+    return t;
+}
+
+/*
+ * $ is an end of line only at the end of the pattern or of a branch
+ */
+bool VimSyntaxParser::dollarIsLineEnd()
+{
+    int pos = mPos;
+    MagicLevel magic = mMagic;
+    Qt::CaseSensitivity cs = mCs;
+
+    mPos = peekToken().end;
+    VimToken next = peekToken();
+    bool ret = next.c.isNull() || isMagic(next, '|') || isMagic(next, ')') || isMagic(next, '&') || isMagic(next, 'n');
+
+    mPos = pos;
+    mMagic = magic;
+    mCs = cs;
+    return ret;
+}
+
+YRegExpNode* VimSyntaxParser::parseAlternation()
+{
+    YRegExpNode* first = parseBranch();
+    if ( !first )
+        return NULL;
+    YRegExpNode* alt = NULL;
+    VimToken t;
+    while ( isMagic(t = peekToken(), '|') ) {
+        mPos = t.end;
+        if ( !alt ) {
+            alt = new YRegExpNode(YRegExpNode::Alternation);
+            alt->children << first;
+        }
+        YRegExpNode* n = parseBranch();
+        if ( !n ) {
+            delete alt;
+            return NULL;
+        }
+        alt->children << n;
+    }
+    return alt ? alt : first;
+}
+
+/*
+ * concat \& concat \& ... matches the last concat, but only if all the
+ * preceding ones also match at the same position
+ */
+YRegExpNode* VimSyntaxParser::parseBranch()
+{
+    YRegExpNode* last = parseConcat();
+    if ( !last )
+        return NULL;
+    YRegExpNode* branch = NULL;
+    VimToken t;
+    while ( isMagic(t = peekToken(), '&') ) {
+        mPos = t.end;
+        if ( !branch )
+            branch = new YRegExpNode(YRegExpNode::Concat);
+        YRegExpNode* ahead = new YRegExpNode(YRegExpNode::LookAhead);
+        ahead->children << last;
+        branch->children << ahead;
+        last = parseConcat();
+        if ( !last ) {
+            delete branch;
+            return NULL;
+        }
+    }
+    if ( !branch )
+        return last;
+    branch->children << last;
+    return branch;
+}
+
+YRegExpNode* VimSyntaxParser::parseConcat()
+{
+    YRegExpNode* concat = new YRegExpNode(YRegExpNode::Concat);
+    bool atStart = true;
+    for ( ;; ) {
+        VimToken t = peekToken();
+        if ( t.c.isNull() || isMagic(t, '|') || isMagic(t, '&') || isMagic(t, ')') )
+            break;
+        YRegExpNode* n = parsePiece(atStart);
+        if ( !n ) {
+            delete concat;
+            return NULL;
+        }
+        /* a * following the initial ^ is still literal */
+        atStart = atStart && n->type == YRegExpNode::LineStart;
+        concat->children << n;
+    }
+    return concat;
+}
+
+YRegExpNode* VimSyntaxParser::parsePiece( bool atStart )
+{
+    YRegExpNode* atom = parseAtom(atStart);
+    if ( !atom )
+        return NULL;
+
+    /* a * following the initial ^ is literal */
+    VimToken t = peekToken();
+    if ( !t.magic || t.c.isNull() || atom->type == YRegExpNode::LineStart )
+        return atom;
+
+    int min, max;
+    bool minimal = false;
+    switch ( t.c.unicode() ) {
+    case '*':
+        min = 0;
+        max = -1;
+        mPos = t.end;
+        break;
+    case '+':
+        min = 1;
+        max = -1;
+        mPos = t.end;
+        break;
+    case '=':
+    case '?':
+        min = 0;
+        max = 1;
+        mPos = t.end;
+        break;
+    case '{':
+        mPos = t.end;
+        if ( !parseBrace(&min, &max, &minimal) ) {
+            delete atom;
+            return fail(_("E554: Syntax error in \\{...}"));
+        }
+        break;
+    case '@': {
+        /* \@= and \@! only, lookbehinds and \@> are not supported */
+        mPos = t.end;
+        YRegExpNode* n = NULL;
+        if ( !atEnd() && peek() == QLatin1Char('=') )
+            n = new YRegExpNode(YRegExpNode::LookAhead);
+        else if ( !atEnd() && peek() == QLatin1Char('!') )
+            n = new YRegExpNode(YRegExpNode::NegativeLookAhead);
+        if ( !n ) {
+            delete atom;
+            if ( !atEnd() && ( peek() == QLatin1Char('<') || peek() == QLatin1Char('>') ) )
+                return fail(_("\\@<= \\@<! and \\@> are not supported"));
+            return fail(_("E59: invalid character after \\@"));
+        }
+        ++mPos;
+        n->children << atom;
+        return n;
+    }
+    default:
+        return atom;
+    }
+
+    switch ( atom->type ) {
+    case YRegExpNode::LineStart:
+    case YRegExpNode::LineEnd:
+    case YRegExpNode::WordStart:
+    case YRegExpNode::WordEnd:
+    case YRegExpNode::MatchStart:
+    case YRegExpNode::MatchEnd:
+        /* nothing to repeat */
+        delete atom;
+        return fail(_("E64: %1 follows nothing").arg(t.c));
+    default:
+        break;
+    }
+
+    YRegExpNode* rep = new YRegExpNode(YRegExpNode::Repeat);
+    rep->min = min;
+    rep->max = max;
+    rep->minimal = minimal;
+    rep->children << atom;
+
+    /* a multi can't follow another one */
+    VimToken next = peekToken();
+    if ( next.magic && !next.c.isNull() && strchr("*+=?{@", next.c.unicode()) ) {
+        delete rep;
+        return fail(_("E62: Nested %1").arg(next.c));
+    }
+    return rep;
+}
+
+YRegExpNode* VimSyntaxParser::parseAtom( bool atStart )
+{
+    VimToken t = peekToken();
+    YRegExpNode* n;
+    if ( !t.magic ) {
+        mPos = t.end;
+        n = new YRegExpNode(YRegExpNode::Char);
+        n->ch = t.c;
+        return n;
+    }
+
+    switch ( t.c.unicode() ) {
+    case '^':
+        mPos = t.end;
+        if ( atStart )
+            return new YRegExpNode(YRegExpNode::LineStart);
+        n = new YRegExpNode(YRegExpNode::Char);
+        n->ch = t.c;
+        return n;
+    case '$':
+        if ( dollarIsLineEnd() ) {
+            mPos = t.end;
+            return new YRegExpNode(YRegExpNode::LineEnd);
+        }
+        mPos = t.end;
+        n = new YRegExpNode(YRegExpNode::Char);
+        n->ch = t.c;
+        return n;
+    case '*':
+        /* literal at the start of a branch */
+        if ( !atStart )
+            return fail(_("E64: * follows nothing"));
+        mPos = t.end;
+        n = new YRegExpNode(YRegExpNode::Char);
+        n->ch = t.c;
+        return n;
+    case '.':
+        mPos = t.end;
+        return new YRegExpNode(YRegExpNode::AnyChar);
+    case '[':
+        mPos = t.end;
+        return parseCollection();
+    case '(':
+        mPos = t.end;
+        return parseGroup(++mCaptures);
+    case '%':
+        mPos = t.end;
+        return parsePercent();
+    case '~': {
+        /* the string of the last substitution, taken literally */
+        mPos = t.end;
+        n = new YRegExpNode(YRegExpNode::Concat);
+        for ( int i = 0; i < mSubstitute.length(); ++i ) {
+            YRegExpNode* c = new YRegExpNode(YRegExpNode::Char);
+            c->ch = mSubstitute.at(i);
+            n->children << c;
+        }
+        return n;
+    }
+    case '<':
+        mPos = t.end;
+        return new YRegExpNode(YRegExpNode::WordStart);
+    case '>':
+        mPos = t.end;
+        return new YRegExpNode(YRegExpNode::WordEnd);
+    case '_':
+        /* \_x: same as x, plus end of line, which can't match inside a line */
+        mPos = t.end;
+        if ( atEnd() )
+            return fail(_("E63: invalid use of \\_"));
+        switch ( peek().unicode() ) {
+        case '^':
+            ++mPos;
+            return new YRegExpNode(YRegExpNode::LineStart);
+        case '$':
+            ++mPos;
+            return new YRegExpNode(YRegExpNode::LineEnd);
+        case '.':
+            ++mPos;
+            return new YRegExpNode(YRegExpNode::AnyChar);
+        case '[':
+            ++mPos;
+            return parseCollection();
+        default: {
+            QChar c = peek();
+            ++mPos;
+            if ( !findClass(vimLetterClasses, QString(c)) )
+                return fail(_("E63: invalid use of \\_"));
+            return parseLetter(c);
+        }
+        }
+    default:
+        break;
+    }
+
+    if ( t.c >= QLatin1Char('1') && t.c <= QLatin1Char('9') ) {
+        mPos = t.end;
+        n = new YRegExpNode(YRegExpNode::BackRef);
+        n->capture = t.c.digitValue();
+        mMaxBackRef = qMax(mMaxBackRef, n->capture);
+        return n;
+    }
+    if ( t.c == QLatin1Char('z') ) {
+        /* \zs \ze, the other \z items are for the syntax highlighting */
+        mPos = t.end;
+        QChar c = atEnd() ? QChar() : peek();
+        ++mPos;
+        if ( c == QLatin1Char('s') )
+            return new YRegExpNode(YRegExpNode::MatchStart);
+        if ( c == QLatin1Char('e') )
+            return new YRegExpNode(YRegExpNode::MatchEnd);
+        return fail(_("E68: Invalid character after \\z"));
+    }
+    if ( t.c.isLetter() ) {
+        mPos = t.end;
+        return parseLetter(t.c);
+    }
+    /* a multi with nothing to repeat, a lonely \{ */
+    if ( t.c.unicode() < 0x80 && strchr("*+=?{@", t.c.unicode()) )
+        return fail(_("E64: %1 follows nothing").arg(t.c));
+    return fail(_("Invalid item \\%1").arg(t.c));
+}
+
+YRegExpNode* VimSyntaxParser::parseLetter( QChar c )
+{
+    YRegExpNode* n;
+    const VimClass* cls = findClass(vimLetterClasses, QString(c));
+    if ( cls ) {
+        n = new YRegExpNode(YRegExpNode::Class);
+        addClass(&n->cls, cls);
+        n->cls.negated = cls->negated;
+        return n;
+    }
+
+    ushort ch;
+    switch ( c.unicode() ) {
+    case 'e': ch = 27; break;
+    case 't': ch = 9; break;
+    case 'r': ch = 13; break;
+    case 'b': ch = 8; break;
+    case 'n': ch = 10; break;
+    default:
+        /* reserved letters */
+        return fail(_("Invalid item \\%1").arg(c));
+    }
+    n = new YRegExpNode(YRegExpNode::Char);
+    n->ch = QChar(ch);
+    return n;
+}
+
+YRegExpNode* VimSyntaxParser::parsePercent()
+{
+    if ( atEnd() )
+        return fail(_("E71: Invalid character after \\%"));
+    QChar c = peek();
+    ++mPos;
+    if ( c == QLatin1Char('(') )
+        return parseGroup(-1);
+
+    /* \%d123 \%x2a \%o40 \%u20AC \%U1234abcd, the other \% items
+     * depend on the cursor, the marks or the whole buffer */
+    QChar ch;
+    if ( !parseCharCode(c, &ch) ) {
+        if ( c.unicode() < 0x80 && strchr("dxouU", c.unicode()) )
+            return fail(_("E678: Invalid character after \\%[dxouU]"));
+        return fail(_("E71: Invalid character after \\%"));
+    }
+    YRegExpNode* n = new YRegExpNode(YRegExpNode::Char);
+    n->ch = ch;
+    return n;
+}
+
+YRegExpNode* VimSyntaxParser::parseGroup( int capture )
+{
+    YRegExpNode* inner = parseAlternation();
+    if ( !inner )
+        return NULL;
+    VimToken t = peekToken();
+    if ( !isMagic(t, ')') ) {
+        delete inner;
+        return fail(capture < 0 ? _("E53: Unmatched \\%(") : _("E54: Unmatched \\("));
+    }
+    mPos = t.end;
+    YRegExpNode* n = new YRegExpNode(YRegExpNode::Group);
+    n->capture = capture;
+    n->children << inner;
+    return n;
+}
+
+/*
+ * [ already consumed. Without a matching ], the [ is a literal char.
+ */
+YRegExpNode* VimSyntaxParser::parseCollection()
+{
+    int start = mPos;
+    YRegExpNode* n = new YRegExpNode(YRegExpNode::Class);
+    if ( parseCollectionItems(&n->cls) )
+        return n;
+    delete n;
+    mPos = start;
+    n = new YRegExpNode(YRegExpNode::Char);
+    n->ch = QLatin1Char('[');
+    return n;
+}
+
+bool VimSyntaxParser::parseCollectionItems( YNfaCharClass* cls )
+{
+    if ( !atEnd() && peek() == QLatin1Char('^') ) {
+        cls->negated = true;
+        ++mPos;
+    }
+    bool first = true;
+    while ( !atEnd() ) {
+        QChar c = peek();
+        if ( c == QLatin1Char(']') && !first ) {
+            ++mPos;
+            return true;
+        }
+        first = false;
+
+        if ( c == QLatin1Char('[') && mPos + 1 < mPattern.length() ) {
+            QChar kind = mPattern.at(mPos + 1);
+            if ( kind == QLatin1Char(':') ) {
+                /* [:alpha:] */
+                int close = mPattern.indexOf(":]", mPos + 2);
+                const VimClass* named = close < 0 ? NULL : findClass(vimNamedClasses, mPattern.mid(mPos + 2, close - mPos - 2));
+                if ( named ) {
+                    addClass(cls, named);
+                    mPos = close + 2;
+                    continue;
+                }
+            } else if ( ( kind == QLatin1Char('=') || kind == QLatin1Char('.') )
+                        && mPos + 4 < mPattern.length() && mPattern.at(mPos + 3) == kind
+                        && mPattern.at(mPos + 4) == QLatin1Char(']') ) {
+                /* [=a=] [.a.] */
+                cls->addChar(mPattern.at(mPos + 2));
+                mPos += 5;
+                continue;
+            }
+        }
+
+        if ( !parseCollectionChar(&c) )
+            return false;
+        if ( mPos + 1 < mPattern.length() && peek() == QLatin1Char('-') && mPattern.at(mPos + 1) != QLatin1Char(']') ) {
+            ++mPos;
+            QChar last;
+            if ( !parseCollectionChar(&last) || last < c )
+                return false;
+            cls->addRange(c.unicode(), last.unicode());
+        } else {
+            cls->addChar(c);
+        }
+    }
+    /* missing ] */
+    return false;
+}
+
+bool VimSyntaxParser::parseCollectionChar( QChar* c )
+{
+    *c = peek();
+    ++mPos;
+    if ( *c != QLatin1Char('\\') || atEnd() )
+        return true;
+
+    QChar e = peek();
+    switch ( e.unicode() ) {
+    case 'e': *c = QChar(27); break;
+    case 't': *c = QChar(9); break;
+    case 'r': *c = QChar(13); break;
+    case 'b': *c = QChar(8); break;
+    case 'n': *c = QChar(10); break;
+    case '\\':
+    case ']':
+    case '^':
+    case '-':
+        *c = e;
+        break;
+    case 'd':
+    case 'o':
+    case 'x':
+    case 'u':
+    case 'U':
+        ++mPos;
+        return parseCharCode(e, c);
+    default:
+        /* the backslash is taken literally */
+        return true;
+    }
+    ++mPos;
+    return true;
+}
+
+bool VimSyntaxParser::parseBrace( int* min, int* max, bool* minimal )
+{
+    /* \{n,m} \{n} \{n,} \{,m} \{} and the \{-...} non greedy forms */
+    if ( !atEnd() && peek() == QLatin1Char('-') ) {
+        mMinimal = true;
+        *minimal = true;
+        ++mPos;
+    }
+    int n = parseNumber(10, 5);
+    int m = n;
+    if ( !atEnd() && peek() == QLatin1Char(',') ) {
+        ++mPos;
+        m = parseNumber(10, 5);
+    }
+    if ( !atEnd() && peek() == QLatin1Char('\\') )
+        ++mPos;
+    if ( atEnd() || peek() != QLatin1Char('}') )
+        return false;
+    ++mPos;
+
+    *min = n < 0 ? 0 : n;
+    *max = m;
+    if ( *max >= 0 && *max < *min )
+        qSwap(*min, *max);
+    return true;
+}
+
+bool VimSyntaxParser::parseCharCode( QChar kind, QChar* c )
+{
+    int v;
+    switch ( kind.unicode() ) {
+    case 'd': v = parseNumber(10, 5); break;
+    case 'o': v = parseNumber(8, 6); break;
+    case 'x': v = parseNumber(16, 2); break;
+    case 'u': v = parseNumber(16, 4); break;
+    case 'U': v = parseNumber(16, 8); break;
+    default: return false;
+    }
+    if ( v < 0 || v > 0xffff )
+        return false;
+    *c = QChar(v);
+    return true;
+}
+
+int VimSyntaxParser::parseNumber( int base, int maxDigits )
+{
+    int v = -1;
+    for ( int i = 0; i < maxDigits && !atEnd(); ++i ) {
+        bool ok;
+        int digit = QString(peek()).toInt(&ok, base);
+        if ( !ok )
+            break;
+        v = (v < 0 ? 0 : v * base) + digit;
+        ++mPos;
+    }
+    return v;
+}
+
+/************************
+ * QRegExp serialization
+ ************************/
+
+QString escapeChar( QChar c, bool inClass )
+{
+    ushort u = c.unicode();
+    if ( u < 0x20 || u == 0x7f )
+        return QString("\\x%1").arg(u, 4, 16, QLatin1Char('0'));
+    const char* specials = inClass ? "\\[]^-" : "\\^$.*+?()[]{}|";
+    if ( u < 0x80 && strchr(specials, u) )
+        return QString(QLatin1Char('\\')) + c;
+    return QString(c);
+}
+
+void serialize( const YRegExpNode* n, QString* out )
+{
+    switch ( n->type ) {
+    case YRegExpNode::Empty:
+        break;
+    case YRegExpNode::Char:
+        *out += escapeChar(n->ch, false);
+        break;
+    case YRegExpNode::AnyChar:
+        *out += '.';
+        break;
+    case YRegExpNode::Class: {
+        *out += n->cls.negated ? "[^" : "[";
+        const QVector<ushort>& r = n->cls.ranges;
+        for ( int i = 0; i < r.size(); i += 2 ) {
+            *out += escapeChar(QChar(r[i]), true);
+            if ( r[i + 1] != r[i] )
+                *out += '-' + escapeChar(QChar(r[i + 1]), true);
+        }
+        int cat = n->cls.categories;
+        if ( cat & YNfaCharClass::Digit ) *out += "\\d";
+        if ( cat & YNfaCharClass::NotDigit ) *out += "\\D";
+        if ( cat & YNfaCharClass::Space ) *out += "\\s";
+        if ( cat & YNfaCharClass::NotSpace ) *out += "\\S";
+        if ( cat & YNfaCharClass::Word ) *out += "\\w";
+        if ( cat & YNfaCharClass::NotWord ) *out += "\\W";
+        *out += ']';
+        break;
+    }
+    case YRegExpNode::Concat:
+        foreach( const YRegExpNode* child, n->children ) {
+            bool wrap = child->type == YRegExpNode::Alternation;
+            if ( wrap ) *out += "(?:";
+            serialize(child, out);
+            if ( wrap ) *out += ')';
+        }
+        break;
+    case YRegExpNode::Alternation:
+        for ( int i = 0; i < n->children.size(); ++i ) {
+            if ( i ) *out += '|';
+            serialize(n->children[i], out);
+        }
+        break;
+    case YRegExpNode::Repeat: {
+        const YRegExpNode* child = n->children[0];
+        bool wrap = child->type == YRegExpNode::Concat || child->type == YRegExpNode::Alternation || child->type == YRegExpNode::Repeat;
+        if ( wrap ) *out += "(?:";
+        serialize(child, out);
+        if ( wrap ) *out += ')';
+        if ( n->min == 0 && n->max < 0 )
+            *out += '*';
+        else if ( n->min == 1 && n->max < 0 )
+            *out += '+';
+        else if ( n->min == 0 && n->max == 1 )
+            *out += '?';
+        else if ( n->max < 0 )
+            *out += QString("{%1,}").arg(n->min);
+        else if ( n->min == n->max )
+            *out += QString("{%1}").arg(n->min);
+        else
+            *out += QString("{%1,%2}").arg(n->min).arg(n->max);
+        break;
+    }
+    case YRegExpNode::Group:
+        *out += n->capture >= 0 ? "(" : "(?:";
+        serialize(n->children[0], out);
+        *out += ')';
+        break;
+    case YRegExpNode::LineStart:
+        *out += '^';
+        break;
+    case YRegExpNode::LineEnd:
+        *out += '$';
+        break;
+    case YRegExpNode::WordBoundary:
+        *out += "\\b";
+        break;
+    case YRegExpNode::NotWordBoundary:
+        *out += "\\B";
+        break;
+    case YRegExpNode::WordStart:
+        *out += "\\b(?=\\w)";
+        break;
+    case YRegExpNode::WordEnd:
+        *out += "\\b(?!\\w)";
+        break;
+    case YRegExpNode::BackRef:
+        *out += QString("\\%1").arg(n->capture);
+        break;
+    case YRegExpNode::LookAhead:
+    case YRegExpNode::NegativeLookAhead:
+        *out += n->type == YRegExpNode::LookAhead ? "(?=" : "(?!";
+        serialize(n->children[0], out);
+        *out += ')';
+        break;
+    case YRegExpNode::MatchStart:
+    case YRegExpNode::MatchEnd:
+        /* no QRegExp equivalent, see YVimRegExp::compile */
+        break;
+    }
+}
+
+bool containsType( const YRegExpNode* n, YRegExpNode::Type type )
+{
+    if ( n->type == type )
+        return true;
+    foreach( const YRegExpNode* child, n->children ) {
+        if ( containsType(child, type) )
+            return true;
+    }
+    return false;
+}
+
+struct CompiledPattern {
+    YRegExpEngine* engine; // NULL for invalid patterns
+    QString error;
+};
+
+/* the patterns are compiled by the worker threads too */
+QMutex cacheMutex;
+QString lastSubstitute;
+
+/* pattern -> compiled engine, only used with cacheMutex locked */
+QHash<QString, CompiledPattern>& compiledPatterns()
+{
+    static QHash<QString, CompiledPattern> cache;
+    return cache;
+}
+
+void dropCache()
+{
+    foreach( const CompiledPattern& c, compiledPatterns() )
+        delete c.engine;
+    compiledPatterns().clear();
+}
+}
+
+/************************
+ * YVimRegExp
+ ************************/
+
+YRegExpNode* YVimRegExp::parse( const QString& pattern, int* captures, Qt::CaseSensitivity* cs, bool* minimal, QString* error )
+{
+    VimSyntaxParser parser(pattern, *cs, lastSubstitute);
+    YRegExpNode* root = parser.parse();
+    *captures = parser.captures();
+    *cs = parser.caseSensitivity();
+    *minimal = parser.minimal();
+    if ( error )
+        *error = parser.error();
+    return root;
+}
+
+QString YVimRegExp::toQRegExpSyntax( const YRegExpNode* root )
+{
+    QString out;
+    serialize(root, &out);
+    return out;
+}
+
+YRegExpEngine* YVimRegExp::compile( const QString& pattern, Qt::CaseSensitivity cs, bool minimal, YRegExp::Engine engine, QString* error )
+{
+    QMutexLocker locker(&cacheMutex);
+    QHash<QString, CompiledPattern>& cache = compiledPatterns();
+    QString key = QString("%1%2%3").arg(int(cs)).arg(int(minimal)).arg(int(engine)) + pattern;
+    if ( pattern.contains(QLatin1Char('~')) )
+        key += QChar(0) + lastSubstitute;
+    QHash<QString, CompiledPattern>::const_iterator it = cache.constFind(key);
+    if ( it != cache.constEnd() ) {
+        if ( error )
+            *error = it.value().error;
+        return it.value().engine ? it.value().engine->clone() : NULL;
+    }
+
+    int captures;
+    bool nonGreedy;
+    CompiledPattern c;
+    c.engine = NULL;
+    YRegExpNode* root = parse(pattern, &captures, &cs, &nonGreedy, &c.error);
+    if ( root ) {
+        if ( engine != YRegExp::QtEngine )
+            c.engine = YNfaRegExpEngine::fromTree(root, captures, cs, minimal, true);
+        bool bounds = containsType(root, YRegExpNode::MatchStart) || containsType(root, YRegExpNode::MatchEnd);
+        if ( !c.engine && bounds ) {
+            c.error = _("\\zs and \\ze can't be used with back references or \\@");
+        } else if ( !c.engine ) {
+            /* QRegExp has no non greedy repetition of its own, and it
+             * matches leftmost-longest */
+            c.engine = YRegExpEngine::create(toQRegExpSyntax(root), cs, minimal || nonGreedy, YRegExp::QtEngine);
+        }
+        delete root;
+    }
+    if ( !c.engine )
+        dbg() << "invalid pattern '" << pattern << "': " << c.error << endl;
+
+    if ( cache.size() >= YZIS_VIM_REGEXP_CACHE_SIZE )
+        dropCache();
+    cache.insert(key, c);
+    if ( error )
+        *error = c.error;
+    return c.engine ? c.engine->clone() : NULL;
+}
+
+void YVimRegExp::setLastSubstitute( const QString& substitute )
+{
+    QMutexLocker locker(&cacheMutex);
+    lastSubstitute = substitute;
+}
+
+void YVimRegExp::clearCache()
+{
+    QMutexLocker locker(&cacheMutex);
+    dropCache();
+}
+
@@ -0,0 +1,91 @@
+/*  This file is part of the Yzis libraries
+*  Copyright (C) 2008 The Yzis developers
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+**/
+
+#ifndef YZ_VIMREGEXP_H
+#define YZ_VIMREGEXP_H
+
+/* Qt */
+#include <QString>
+
+/* Yzis */
+#include "regexp.h"
+
+struct YRegExpNode;
+
+/**
+ * Compiler for the Vim pattern syntax (see :help pattern).
+ *
+ * The pattern is parsed straight into a YRegExpNode tree which is compiled
+ * for the linear engine, or serialized in the QRegExp syntax when it uses
+ * back references or lookaheads. The result is cached by pattern, so the
+ * search, the substitutions, hlsearch and the lua VimRegexp class share the
+ * same compiled program and never parse a pattern twice.
+ *
+ * Supported: \\v \\m \\M \\V, \\c \\C, \\( \\%( \\| \\&, * \\+ \\= \\?
+ * \\{n,m} \\{-n,m}, \\@= \\@!, \\< \\>, ^ $ \\_^ \\_$, [] collections with
+ * the [:name:] classes, the \\d \\s \\w \\x \\o \\h \\a \\l \\u \\i \\k \\f \\p
+ * classes (and their \\_ and negated forms), \\e \\t \\r \\b \\n,
+ * \\%d \\%x \\%o \\%u \\%U, back references \\1 to \\9, \\zs \\ze and ~
+ * (see setLastSubstitute()).
+ *
+ * The match is the one Vim finds: the first alternative which matches wins
+ * and each repetition is greedy unless written \\{-...}. The patterns which
+ * fall back on QRegExp (back references, lookaheads) are matched
+ * leftmost-longest, and minimal as a whole if they use \\{-...}. \\zs and
+ * \\ze can't fall back.
+ *
+ * Not supported (the pattern is invalid): \\z( \\z1, \\@> \\@<= \\@<!, \\%[
+ * \\%^ \\%$ \\%# and the line/column items.
+ *
+ * The cache is locked, patterns can be compiled from any thread.
+ */
+class YZIS_EXPORT YVimRegExp
+{
+public:
+    /**
+     * Parses @arg pattern written in the Vim syntax.
+     * @arg cs is updated by \\c and \\C, @arg minimal is set when a
+     * non greedy repetition is used.
+     * Returns NULL if the pattern is invalid or not supported, @arg error
+     * then tells why, with the Vim message when there is one.
+     */
+    static YRegExpNode* parse( const QString& pattern, int* captures, Qt::CaseSensitivity* cs, bool* minimal, QString* error = NULL );
+
+    /**
+     * Returns a new engine for @arg pattern, copied from the cache.
+     * Returns NULL if the pattern is invalid or not supported, @arg error
+     * is set as by parse().
+     */
+    static YRegExpEngine* compile( const QString& pattern, Qt::CaseSensitivity cs, bool minimal, YRegExp::Engine engine, QString* error = NULL );
+
+    /**
+     * Sets what ~ matches, the replacement string of the last substitution.
+     */
+    static void setLastSubstitute( const QString& substitute );
+
+    /**
+     * Writes the tree back in the QRegExp syntax, used to fall back on QRegExp.
+     */
+    static QString toQRegExpSyntax( const YRegExpNode* root );
+
+    static void clearCache();
+};
+
+#endif
+
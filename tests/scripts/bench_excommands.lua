@@ -0,0 +1,47 @@
+--[[
+
+Description: Micro-benchmark of the ex command dispatch: runs cheap ex
+commands many times and prints how many are executed per second.
+It is not part of test_all, run it alone:
+    ./run_scripttests.sh bench_excommands.lua
+
+License: LGPL
+
+]]--
+
+require('utils')
+
+-- commands which do (almost) nothing, so that the parsing of the range and
+-- the lookup of the command dominate
+local commands = {
+    ":3<Cr>",
+    ":$<Cr>",
+    ":.,$-1s/nomatch/x/<Cr>",
+    ":%s/nomatch/x/g<Cr>",
+    ":'a<Cr>",
+    ":/line/<Cr>",
+    ":se ts=8<Cr>",
+    ":setlocal ts=8<Cr>",
+}
+
+local repeats = tonumber(os.getenv('YZIS_BENCH_REPEATS') or '') or 2000
+
+clearBuffer()
+sendkeys("iline 1<Cr>line 2<Cr>line 3<Cr>line 4<Cr>line 5<ESC>")
+sendkeys("gg")
+sendkeys("ma")
+
+local start = os.clock()
+for i = 1, repeats do
+    for _, cmd in ipairs(commands) do
+        sendkeys(cmd)
+    end
+end
+local elapsed = os.clock() - start
+local count = repeats * #commands
+
+print(string.format("ex dispatch: %d commands in %.3f s, %.0f commands/s",
+    count, elapsed, count / math.max(elapsed, 1e-6)))
+
+clearBuffer()
+setLuaReturnValue( 0 )
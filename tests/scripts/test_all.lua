@@ -15,6 +15,7 @@ require('test_vim_pattern')
 require('test_insert_mode')
 require('test_mode_command_parser')
 require('test_undo')
+require('test_folding')
 
 -- ret = LuaUnit:run('TestLuaBinding:test_setline') -- will execute only one test
 -- ret = LuaUnit:run('TestMovements') -- will execute only one class of test
@@ -16,6 +16,180 @@ TestExCommands = {} --class
         assertEquals(bufferContent(),"")
     end
 
+    function TestExCommands:test_delete()
+        sendkeys("i1<Cr>2<Cr>3<Cr>4<ESC>")
+        sendkeys(":2,3d<Cr>")
+        assertEquals(bufferContent(),"1\n4")
+    end
+
+    function TestExCommands:test_global_delete()
+        sendkeys("ia1<Cr>b2<Cr>a3<Cr>b4<Cr>a5<ESC>")
+        sendkeys(":g/a/d<Cr>")
+        assertEquals(bufferContent(),"b2\nb4")
+        sendkeys("u")
+        assertEquals(bufferContent(),"a1\nb2\na3\nb4\na5")
+    end
+
+    function TestExCommands:test_global_delete_runs()
+        sendkeys("ia1<Cr>a2<Cr>b3<Cr>a4<Cr>a5<Cr>b6<Cr>a7<ESC>")
+        sendkeys(":g/a/d<Cr>")
+        assertEquals(bufferContent(),"b3\nb6")
+        sendkeys("u")
+        assertEquals(bufferContent(),"a1\na2\nb3\na4\na5\nb6\na7")
+        sendkeys("<C-r>")
+        assertEquals(bufferContent(),"b3\nb6")
+        -- all the lines, undo leaves no extra line
+        sendkeys(":g/./d<Cr>")
+        assertEquals(bufferContent(),"")
+        sendkeys("u")
+        assertEquals(bufferContent(),"b3\nb6")
+    end
+
+    function TestExCommands:test_vglobal_delete()
+        sendkeys("ia1<Cr>b2<Cr>a3<Cr>b4<Cr>a5<ESC>")
+        sendkeys(":v/a/d<Cr>")
+        assertEquals(bufferContent(),"a1\na3\na5")
+        sendkeys(":g!/1/d<Cr>")
+        assertEquals(bufferContent(),"a1")
+    end
+
+    function TestExCommands:test_global_substitute()
+        sendkeys("ia1 x<Cr>b2 x<Cr>a3 x<ESC>")
+        sendkeys(":g/a/s/x/y/<Cr>")
+        assertEquals(bufferContent(),"a1 y\nb2 x\na3 y")
+        sendkeys(":g/y/s//z/<Cr>")
+        assertEquals(bufferContent(),"a1 z\nb2 x\na3 z")
+        sendkeys("u")
+        assertEquals(bufferContent(),"a1 y\nb2 x\na3 y")
+    end
+
+    function TestExCommands:test_global_range()
+        sendkeys("ia1<Cr>a2<Cr>a3<Cr>a4<ESC>")
+        sendkeys(":2,3g/a/d<Cr>")
+        assertEquals(bufferContent(),"a1\na4")
+    end
+
+    function TestExCommands:test_global_other_command()
+        sendkeys("ia1<Cr>b2<Cr>a3<ESC>")
+        -- on a3, the last line, .+1 is an invalid range which stops :g
+        sendkeys(":g/a/.,.+1d<Cr>")
+        assertEquals(bufferContent(),"a3")
+        sendkeys("u")
+        assertEquals(bufferContent(),"a1\nb2\na3")
+    end
+
+    function TestExCommands:test_substitute_last_pattern()
+        sendkeys("ia1 xxx<Cr>b2 yy<Cr>a3 x<ESC>")
+        sendkeys(":%s/x/z/<Cr>")
+        assertEquals(bufferContent(),"a1 zxx\nb2 yy\na3 z")
+        -- an empty pattern is the last one, which stays the last one
+        sendkeys(":%s//w/<Cr>")
+        assertEquals(bufferContent(),"a1 zwx\nb2 yy\na3 z")
+        sendkeys(":%s//w/g<Cr>")
+        assertEquals(bufferContent(),"a1 zww\nb2 yy\na3 z")
+        sendkeys("gg/y<Cr>")
+        sendkeys(":2s//v/<Cr>")
+        assertEquals(bufferContent(),"a1 zww\nb2 vy\na3 z")
+        sendkeys(":2s//v/g<Cr>")
+        assertEquals(bufferContent(),"a1 zww\nb2 vv\na3 z")
+    end
+
+    function TestExCommands:test_substitute_tilde_zs()
+        sendkeys("ia xy a<ESC>")
+        sendkeys(":s/a/xy/<Cr>")
+        assertEquals(bufferContent(),"xy xy a")
+        -- ~ is the string of the previous substitution
+        sendkeys(":s/~ \\zsa/b/<Cr>")
+        assertEquals(bufferContent(),"xy xy b")
+        sendkeys(":s/y\\zs x/z/g<Cr>")
+        assertEquals(bufferContent(),"xyzy b")
+    end
+
+    function TestExCommands:test_sort()
+        sendkeys("ib<Cr>a<Cr>C<Cr>a<Cr>B<ESC>")
+        sendkeys(":sort<Cr>")
+        assertEquals(bufferContent(),"B\nC\na\na\nb")
+        sendkeys("u")
+        assertEquals(bufferContent(),"b\na\nC\na\nB")
+        -- the sorted order backwards, then the first of the equal lines
+        sendkeys(":sort! iu<Cr>")
+        assertEquals(bufferContent(),"C\nB\na")
+    end
+
+    function TestExCommands:test_sort_numeric()
+        sendkeys("ix10<Cr>x9<Cr>none<Cr>y-3<Cr>z99999999999999999999<ESC>")
+        sendkeys(":sort n<Cr>")
+        assertEquals(bufferContent(),"none\ny-3\nx9\nx10\nz99999999999999999999")
+    end
+
+    function TestExCommands:test_sort_numeric_unique()
+        -- only the identical lines go, not the ones with the same number
+        sendkeys("ia2<Cr>b1<Cr>none<Cr>c1<Cr>b1<Cr>none<ESC>")
+        sendkeys(":sort nu<Cr>")
+        assertEquals(bufferContent(),"none\nb1\nc1\nb1\na2")
+        sendkeys(":sort! n<Cr>")
+        assertEquals(bufferContent(),"a2\nb1\nc1\nb1\nnone")
+    end
+
+    function TestExCommands:test_sort_pattern()
+        sendkeys("ia,3<Cr>b,1<Cr>nomatch<Cr>c,2<ESC>")
+        sendkeys(":sort /,/<Cr>")
+        assertEquals(bufferContent(),"nomatch\nb,1\nc,2\na,3")
+        sendkeys(":sort /\\a,/ r<Cr>")
+        assertEquals(bufferContent(),"nomatch\na,3\nb,1\nc,2")
+        sendkeys("ggdd")
+        sendkeys("God,1<ESC>")
+        sendkeys(":sort u /,/<Cr>")
+        assertEquals(bufferContent(),"b,1\nd,1\nc,2\na,3")
+    end
+
+    function TestExCommands:test_sort_range()
+        sendkeys("i4<Cr>3<Cr>2<Cr>1<ESC>")
+        sendkeys(":2,3sort<Cr>")
+        assertEquals(bufferContent(),"4\n2\n3\n1")
+    end
+    function TestExCommands:test_abbreviations()
+        sendkeys("ic<Cr>b x<Cr>a<ESC>")
+        sendkeys(":sor<Cr>")
+        assertEquals(bufferContent(),"a\nb x\nc")
+        sendkeys(":2su/x/y/<Cr>")
+        assertEquals(bufferContent(),"a\nb y\nc")
+        sendkeys(":3del<Cr>")
+        assertEquals(bufferContent(),"a\nb y")
+        sendkeys(":substitutex/y/z/<Cr>")
+        assertEquals(bufferContent(),"a\nb y")
+    end
+
+    function TestExCommands:test_relative_range()
+        sendkeys("i1<Cr>2<Cr>3<Cr>4<Cr>5<ESC>")
+        sendkeys("gg")
+        sendkeys(":+1,+2d<Cr>")
+        assertEquals(bufferContent(),"1\n4\n5")
+        sendkeys(":/5/d<Cr>")
+        assertEquals(bufferContent(),"1\n4")
+    end
+    function TestExCommands:test_filter()
+        sendkeys("ic<Cr>b<Cr>a<ESC>")
+        sendkeys(":%!sort<Cr>")
+        assertEquals(bufferContent(),"a\nb\nc")
+        sendkeys("u")
+        assertEquals(bufferContent(),"c\nb\na")
+        sendkeys(":2,3!tr a-z A-Z<Cr>")
+        assertEquals(bufferContent(),"c\nB\nA")
+        sendkeys(":1!!<Cr>")
+        assertEquals(bufferContent(),"C\nB\nA")
+        sendkeys(":1,2!true<Cr>")
+        assertEquals(bufferContent(),"A")
+        -- stderr is reported, not put in the buffer
+        sendkeys(":%!echo out; echo err >&2<Cr>")
+        assertEquals(bufferContent(),"out")
+        -- the whole buffer, undo leaves no extra line
+        sendkeys(":%!true<Cr>")
+        assertEquals(bufferContent(),"")
+        sendkeys("u")
+        assertEquals(bufferContent(),"out")
+    end
+
 
 if not _REQUIREDNAME then
     -- ret = LuaUnit:run('TestExCommands:test_initial_state') -- will execute only one test
@@ -0,0 +1,262 @@
+--[[
+Description: Test the manual folds: creation, opening and closing, and how
+they follow the lines inserted or deleted around them.
+]]--
+
+require('luaunit')
+require('utils')
+
+TestFolding = {} --class
+    function TestFolding:setUp()
+        clearBuffer()
+        -- a last line outside of the folds, so that clearBuffer removes them
+        sendkeys("i1<Cr>2<Cr>3<Cr>4<Cr>5<Cr>6<Cr>7<Cr>8<ESC>")
+    end
+
+    function TestFolding:tearDown()
+        clearBuffer()
+    end
+
+    function TestFolding:test_nesting()
+        sendkeys(":2,6fold<Cr>")
+        assertEquals(foldlevel(1),0)
+        assertEquals(foldlevel(2),1)
+        assertEquals(foldlevel(6),1)
+        assertEquals(foldlevel(7),0)
+        -- a new fold is closed
+        assertEquals(foldclosed(4),2)
+        assertEquals(foldclosedend(4),6)
+        assertEquals(foldclosed(7),-1)
+
+        -- inside the first one
+        sendkeys(":3,4fold<Cr>")
+        assertEquals(foldlevel(2),1)
+        assertEquals(foldlevel(3),2)
+        assertEquals(foldlevel(4),2)
+        assertEquals(foldlevel(5),1)
+        assertEquals(foldclosed(3),2)
+        assertEquals(foldclosedend(3),6)
+
+        -- around both
+        sendkeys(":1,7fold<Cr>")
+        assertEquals(foldlevel(1),1)
+        assertEquals(foldlevel(2),2)
+        assertEquals(foldlevel(3),3)
+        assertEquals(foldlevel(7),1)
+        assertEquals(foldlevel(8),0)
+        assertEquals(foldclosed(4),1)
+        assertEquals(foldclosedend(4),7)
+        assertEquals(foldclosed(8),-1)
+    end
+
+    function TestFolding:test_nesting_overlap()
+        sendkeys(":2,4fold<Cr>")
+        -- the fold it partly covers goes inside the new one
+        sendkeys(":4,6fold<Cr>")
+        assertEquals(foldlevel(2),2)
+        assertEquals(foldlevel(5),1)
+        assertEquals(foldlevel(6),1)
+        assertEquals(foldclosed(2),2)
+        assertEquals(foldclosedend(2),6)
+    end
+
+    function TestFolding:test_foldopen_foldclose()
+        sendkeys(":2,6fold<Cr>")
+        sendkeys(":3,4fold<Cr>")
+
+        -- only the fold headed by the line is opened
+        sendkeys(":2foldopen<Cr>")
+        assertEquals(foldclosed(2),-1)
+        assertEquals(foldclosed(3),3)
+        assertEquals(foldclosedend(4),4)
+        assertEquals(foldclosed(5),-1)
+
+        -- inside a fold, the innermost one is opened
+        sendkeys(":4foldopen<Cr>")
+        assertEquals(foldclosed(3),-1)
+        assertEquals(foldclosed(4),-1)
+
+        sendkeys(":2,6foldclose<Cr>")
+        assertEquals(foldclosed(3),2)
+        assertEquals(foldclosedend(3),6)
+
+        sendkeys(":3foldopen<Cr>")
+        assertEquals(foldclosed(3),2)
+        sendkeys(":2foldopen<Cr>")
+        assertEquals(foldclosed(3),-1)
+    end
+
+    function TestFolding:test_zo_zc_zR_zM()
+        sendkeys(":2,6fold<Cr>")
+        sendkeys(":3,4fold<Cr>")
+
+        goto(1,4)
+        sendkeys("zo")
+        assertEquals(foldclosed(4),2)
+        goto(1,2)
+        sendkeys("zo")
+        assertEquals(foldclosed(2),-1)
+        assertEquals(foldclosed(4),-1)
+
+        goto(1,3)
+        sendkeys("zc")
+        assertEquals(foldclosed(2),-1)
+        assertEquals(foldclosed(4),3)
+        assertEquals(foldclosedend(4),4)
+
+        sendkeys("zR")
+        assertEquals(foldclosed(3),-1)
+        assertEquals(foldclosed(4),-1)
+        assertEquals(foldlevel(3),2)
+
+        sendkeys("zM")
+        assertEquals(foldclosed(4),2)
+        assertEquals(foldclosedend(4),6)
+        assertEquals(foldclosed(8),-1)
+    end
+
+    function TestFolding:test_insert_inside()
+        sendkeys(":2,6fold<Cr>")
+        sendkeys("zR")
+        goto(1,4)
+        sendkeys("oa<ESC>")
+        assertEquals(foldlevel(7),1)
+        assertEquals(foldlevel(8),0)
+        goto(1,2)
+        sendkeys("ob<ESC>")
+        goto(1,4)
+        sendkeys("Oc<ESC>")
+        assertEquals(bufferContent(),"1\n2\nb\nc\n3\n4\na\n5\n6\n7\n8")
+        sendkeys("zM")
+        assertEquals(foldclosed(2),2)
+        assertEquals(foldclosedend(2),9)
+        assertEquals(foldclosed(10),-1)
+
+        -- pasted lines
+        sendkeys("zR")
+        goto(1,10)
+        sendkeys("2yy")
+        goto(1,5)
+        sendkeys("p")
+        sendkeys("zM")
+        assertEquals(foldclosedend(2),11)
+        assertEquals(foldlevel(12),0)
+    end
+
+    function TestFolding:test_insert_before()
+        sendkeys(":3,6fold<Cr>")
+        sendkeys("zR")
+        goto(1,1)
+        sendkeys("oa<ESC>")
+        assertEquals(foldlevel(3),0)
+        assertEquals(foldlevel(4),1)
+
+        -- a line opened above the head
+        goto(1,4)
+        sendkeys("Ob<ESC>")
+        assertEquals(bufferContent(),"1\na\n2\nb\n3\n4\n5\n6\n7\n8")
+        assertEquals(foldlevel(4),0)
+        assertEquals(foldlevel(5),1)
+
+        -- pasted above the head
+        goto(1,1)
+        sendkeys("yy")
+        goto(1,5)
+        sendkeys("P")
+        assertEquals(foldlevel(5),0)
+
+        -- after the fold
+        goto(1,11)
+        sendkeys("oc<ESC>")
+        sendkeys("zM")
+        assertEquals(foldclosed(6),6)
+        assertEquals(foldclosedend(6),9)
+        assertEquals(foldclosed(12),-1)
+    end
+
+    function TestFolding:test_delete_inside()
+        sendkeys(":2,6fold<Cr>")
+        sendkeys(":3,4fold<Cr>")
+        sendkeys("zR")
+        goto(1,3)
+        sendkeys("dd")
+        assertEquals(foldlevel(3),2)
+        assertEquals(foldlevel(4),1)
+        -- the inner fold loses all its lines
+        sendkeys("dd")
+        assertEquals(bufferContent(),"1\n2\n5\n6\n7\n8")
+        assertEquals(foldlevel(3),1)
+        sendkeys("zM")
+        assertEquals(foldclosed(2),2)
+        assertEquals(foldclosedend(2),4)
+        assertEquals(foldlevel(5),0)
+
+        -- its head
+        sendkeys("zR")
+        goto(1,2)
+        sendkeys("dd")
+        sendkeys("zM")
+        assertEquals(foldclosed(2),2)
+        assertEquals(foldclosedend(2),3)
+        assertEquals(foldclosed(1),-1)
+    end
+
+    function TestFolding:test_delete_before()
+        sendkeys(":3,6fold<Cr>")
+        sendkeys("zR")
+        goto(1,1)
+        sendkeys("dd")
+        assertEquals(bufferContent(),"2\n3\n4\n5\n6\n7\n8")
+        assertEquals(foldlevel(1),0)
+        assertEquals(foldlevel(2),1)
+        sendkeys("dd")
+        sendkeys("zM")
+        assertEquals(foldclosed(1),1)
+        assertEquals(foldclosedend(1),4)
+        assertEquals(foldclosed(5),-1)
+    end
+
+    function TestFolding:test_delete_across()
+        sendkeys(":3,5fold<Cr>")
+        sendkeys("zR")
+        -- from the line before the fold to its last line but one
+        sendkeys(":2,4d<Cr>")
+        assertEquals(bufferContent(),"1\n5\n6\n7\n8")
+        assertEquals(foldlevel(1),0)
+        assertEquals(foldlevel(2),1)
+        assertEquals(foldlevel(3),0)
+
+        -- its last line
+        goto(1,2)
+        sendkeys("dd")
+        assertEquals(foldlevel(2),0)
+        sendkeys("zM")
+        assertEquals(foldclosed(2),-1)
+    end
+
+    function TestFolding:test_delete_across_end()
+        sendkeys(":3,5fold<Cr>")
+        -- from the middle of the fold to after it
+        sendkeys(":4,6d<Cr>")
+        assertEquals(bufferContent(),"1\n2\n3\n7\n8")
+        assertEquals(foldclosed(3),3)
+        assertEquals(foldclosedend(3),3)
+        assertEquals(foldlevel(4),0)
+    end
+
+    function TestFolding:test_delete_whole()
+        sendkeys(":3,5fold<Cr>")
+        sendkeys(":4fold<Cr>")
+        sendkeys(":3,5d<Cr>")
+        assertEquals(bufferContent(),"1\n2\n6\n7\n8")
+        for line = 1, 5 do
+            assertEquals(foldlevel(line),0)
+        end
+    end
+
+
+if not _REQUIREDNAME then
+    -- ret = LuaUnit:run('TestFolding:test_nesting') -- will execute only one test
+    ret = LuaUnit:run() -- will execute all tests
+    setLuaReturnValue( ret )
+end
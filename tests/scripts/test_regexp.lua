@@ -30,10 +30,11 @@ Regexp() as the constructor.
 Supported Vim regexp syntax:
 - \*, \+, \=, \? 
 - \{}, \{n,m}, ...
+- \v, \m, \M, \V, \c, \C, \<, \>, \@=, \@!, \&
+See libyzis/vimregexp.h for the complete list.
 
-Non supported Vim regexp syntax:
-- non greedy matching: \{-n,m}, \{-n,}, ... 
-This can be adjusted globally on a regexp with setMinimal()
+Non greedy matching (\{-n,m}, \{-n,}, ...) makes the whole regexp minimal,
+as setMinimal() does.
 
 
 ]]
@@ -63,6 +63,16 @@ TestUndo = {} --class
         assertEquals(bufferContent(), "FirstSecond")
     end
 
+    function TestUndo:test_undo_ex_s_range()
+        sendkeys("ione two<Cr>three<Cr>one one<ESC>")
+        sendkeys(":%s/one/1/g<Cr>")
+        assertEquals(bufferContent(), "1 two\nthree\n1 1")
+        sendkeys("u")
+        assertEquals(bufferContent(), "one two\nthree\none one")
+        sendkeys("<C-r>")
+        assertEquals(bufferContent(), "1 two\nthree\n1 1")
+    end
+
     function TestUndo:test_undo_shift_indent() 
         sendkeys("iFirst<ESC>")
         sendkeys(">>")
@@ -164,6 +174,19 @@ TestUndo = {} --class
         assertEquals(bufferContent(), "First")
     end
 
+    function TestUndo:test_undo_redo_replace_all_lines()
+        -- the empty line left in the buffer is not kept by undo
+        sendkeys("iFirst<Cr>Second<ESC>")
+        sendkeys(":%!true<Cr>")
+        assertEquals(bufferContent(), "")
+        sendkeys("u")
+        assertEquals(bufferContent(), "First\nSecond")
+        sendkeys("<C-r>")
+        assertEquals(bufferContent(), "")
+        sendkeys("u")
+        assertEquals(bufferContent(), "First\nSecond")
+    end
+
 if not _REQUIREDNAME then
    ret = LuaUnit:run()
    setLuaReturnValue( ret )
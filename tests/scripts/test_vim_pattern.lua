@@ -430,52 +430,54 @@ TestVimRegexp = {} --class
 	end
 
 	function TestVimRegexp:test34()
+		--vim syntax
+		assertEquals(VimRegexp([[\cfoobar]]):match('FooBar'), true )
+		assertEquals(VimRegexp([[foobar\c]]):match('FooBar'), true )
+		assertEquals(VimRegexp([[\Cfoobar]]):match('FooBar'), false )
+		assertEquals(VimRegexp([[\v^\a+\d{2}$]]):match('ab12'), true )
+		assertEquals(VimRegexp([[\v^\a+\d{2}$]]):match('ab123'), false )
+		assertEquals(VimRegexp([[\Va+b]]):match('a+b'), true )
+		assertEquals(VimRegexp([[\Va+b]]):match('aab'), false )
+		assertEquals(VimRegexp([[\Ma.b]]):match('a.b'), true )
+		assertEquals(VimRegexp([[\Ma.b]]):match('axb'), false )
+		assertEquals(VimRegexp([[\Ma\.b]]):match('axb'), true )
+		assertEquals(VimRegexp([[\Vfoo$]]):match('foo$'), true )
+		assertEquals(VimRegexp([[\Vfoo\$]]):match('foo'), true )
+		assertEquals(VimRegexp([[\<bar\>]]):match('foo bar'), true )
+		assertEquals(VimRegexp([[\<bar\>]]):match('foobar'), false )
+		assertEquals(VimRegexp([[^a\{3}$]]):match('aaa'), true )
+		assertEquals(VimRegexp([[^a\{3}$]]):match('aa'), false )
+		assertEquals(VimRegexp([[^a\{2,3}$]]):match('aaaa'), false )
+		assertEquals(VimRegexp([[^a\{-1,}$]]):match('aaa'), true )
+		assertEquals(VimRegexp([[x\~y]]):match('x~y'), true )
+		assertEquals(VimRegexp([[^[_[:alpha:]x]\+$]]):match('ab_c'), true )
+		assertEquals(VimRegexp([[^[_[:alpha:]x]\+$]]):match('a1'), false )
+		assertEquals(VimRegexp([[\%x41]]):match('A'), true )
+		assertEquals(VimRegexp([[\%d65]]):match('A'), true )
+		assertEquals(VimRegexp([[foo\(bar\)\@=]]):match('foobar'), true )
+		assertEquals(VimRegexp([[foo\(bar\)\@=]]):match('foobaz'), false )
+		assertEquals(VimRegexp([[foo\(bar\)\@!]]):match('foobaz'), true )
+		assertEquals(VimRegexp([[.*bar\&foo.*]]):match('foobar'), true )
+		assertEquals(VimRegexp([[.*bar\&foo.*]]):match('foobaz'), false )
+	end
+
+	function TestVimRegexp:test35()
 		--unsupported
-		assertError( VimRegexp, [[ [:return:] ]] )
-		assertError( VimRegexp, [[ [:tab:] ]] )
-		assertError( VimRegexp, [[ [:graph:] ]] )
-		assertError( VimRegexp, [[ [:print:] ]] )
-		assertError( VimRegexp, [[ [:punct:] ]] )
-		assertError( VimRegexp, [[ \& ]] )
-		assertError( VimRegexp, [[ {- ]] )
 		assertError( VimRegexp, [[ \@>	 ]] )
-		assertError( VimRegexp, [[ \@= ]] )
-		assertError( VimRegexp, [[ \@! ]] )
 		assertError( VimRegexp, [[ \@<= ]] )
 		assertError( VimRegexp, [[ \@<! ]] )
 		assertError( VimRegexp, [[ \zs ]] )
 		assertError( VimRegexp, [[ \ze ]] )
-		assertError( VimRegexp, [[ \_. ]] )
 		assertError( VimRegexp, [[ \%^ ]] )
 		assertError( VimRegexp, [[ \%$ ]] )
 		assertError( VimRegexp, [[ \%# ]] )
 		assertError( VimRegexp, [[ \%23l ]] )
 		assertError( VimRegexp, [[ \%23c ]] )
 		assertError( VimRegexp, [[ \%23v ]] )
-		assertError( VimRegexp, [[ \i ]] )
-		assertError( VimRegexp, [[ \I ]] )
-		assertError( VimRegexp, [[ \k ]] )
-		assertError( VimRegexp, [[ \K ]] )
-		assertError( VimRegexp, [[ \f ]] )
-		assertError( VimRegexp, [[ \F ]] )
-		assertError( VimRegexp, [[ \p ]] )
-		assertError( VimRegexp, [[ \P ]] )
-		assertError( VimRegexp, [[ \t ]] )
-		assertError( VimRegexp, [[ \e ]] )
-		assertError( VimRegexp, [[ \r ]] )
-		assertError( VimRegexp, [[ \b ]] )
-		assertError( VimRegexp, [[ \n ]] )
-		assertError( VimRegexp, [[ \~ ]] )
 		assertError( VimRegexp, [[ \z1 ]] )
 		assertError( VimRegexp, [[ \z9 ]] )
 		assertError( VimRegexp, [[ \%[ ]] )
-		assertError( VimRegexp, [[ \c ]] )
-		assertError( VimRegexp, [[ \C ]] )
-		assertError( VimRegexp, [[ \Z ]] )
-		assertError( VimRegexp, [[ \v ]] )
-		assertError( VimRegexp, [[ \V ]] )
-		assertError( VimRegexp, [[ \m ]] )
-		assertError( VimRegexp, [[ \M ]] )
+		assertError( VimRegexp, [[ x~y ]] )
 	end
 
 
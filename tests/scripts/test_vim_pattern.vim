@@ -447,50 +447,50 @@ call AssertEquals( 'bb' =~ 'aa\_$bb', 0 )
 call AssertEquals( 'aa$bb' =~ 'aa\$bb', 1 )
 call AssertEquals( 'aa$bb' =~ 'aa$bb', 1 )
 
+echo 'vim syntax'
+let g:count = 0
+call AssertEquals( 'FooBar' =~ '\cfoobar', 1 )
+call AssertEquals( 'FooBar' =~ 'foobar\c', 1 )
+call AssertEquals( 'FooBar' =~ '\Cfoobar', 0 )
+call AssertEquals( 'ab12' =~ '\v^\a+\d{2}$', 1 )
+call AssertEquals( 'ab123' =~ '\v^\a+\d{2}$', 0 )
+call AssertEquals( 'a+b' =~ '\Va+b', 1 )
+call AssertEquals( 'aab' =~ '\Va+b', 0 )
+call AssertEquals( 'a.b' =~ '\Ma.b', 1 )
+call AssertEquals( 'axb' =~ '\Ma.b', 0 )
+call AssertEquals( 'axb' =~ '\Ma\.b', 1 )
+call AssertEquals( 'foo$' =~ '\Vfoo$', 1 )
+call AssertEquals( 'foo' =~ '\Vfoo\$', 1 )
+call AssertEquals( 'foo bar' =~ '\<bar\>', 1 )
+call AssertEquals( 'foobar' =~ '\<bar\>', 0 )
+call AssertEquals( 'aaa' =~ '^a\{3}$', 1 )
+call AssertEquals( 'aa' =~ '^a\{3}$', 0 )
+call AssertEquals( 'aaaa' =~ '^a\{2,3}$', 0 )
+call AssertEquals( 'aaa' =~ '^a\{-1,}$', 1 )
+call AssertEquals( 'x~y' =~ 'x\~y', 1 )
+call AssertEquals( 'ab_c' =~ '^[_[:alpha:]x]\+$', 1 )
+call AssertEquals( 'a1' =~ '^[_[:alpha:]x]\+$', 0 )
+call AssertEquals( 'A' =~ '\%x41', 1 )
+call AssertEquals( 'A' =~ '\%d65', 1 )
+call AssertEquals( 'foobar' =~ 'foo\(bar\)\@=', 1 )
+call AssertEquals( 'foobaz' =~ 'foo\(bar\)\@=', 0 )
+call AssertEquals( 'foobaz' =~ 'foo\(bar\)\@!', 1 )
+call AssertEquals( 'foobar' =~ '.*bar\&foo.*', 1 )
+call AssertEquals( 'foobaz' =~ '.*bar\&foo.*', 0 )
+
 echo 'unsupported'
-" unsupported [:return:]
-" unsupported [:tab:]
-" unsupported [:graph:]
-" unsupported [:print:]
-" unsupported [:punct:]
-" unsupported \&
-" unsupported {-
 " unsupported \@>	
-" unsupported \@=
-" unsupported \@!
 " unsupported \@<=
 " unsupported \@<!
 " unsupported \zs
 " unsupported \ze
-" unsupported \_.
 " unsupported \%^
 " unsupported \%$
 " unsupported \%#
 " unsupported \%23l
 " unsupported \%23c
 " unsupported \%23v
-" unsupported \i
-" unsupported \I
-" unsupported \k
-" unsupported \K
-" unsupported \f
-" unsupported \F
-" unsupported \p
-" unsupported \P
-" unsupported \t
-" unsupported \e
-" unsupported \r
-" unsupported \b
-" unsupported \n
-" unsupported \~
 " unsupported \z1
 " unsupported \z9
 " unsupported \%[
-" unsupported \c
-" unsupported \C
-" unsupported \Z
-" unsupported \v
-" unsupported \V
-" unsupported \m
-" unsupported \M
-
+" unsupported x~y
@@ -0,0 +1,109 @@
+/*
+ * Throughput of the construction of the draw lines from long buffer lines.
+ *
+ * Each kind of line (code, runs of spaces, tabs, trailing spaces...) is
+ * drawn with and without :set list. The result is printed as JSON on
+ * stdout, one entry per kind of line and list setting:
+ *  - characters: length of the line
+ *  - cells: number of draw cells made for the line
+ *  - usec_per_line: time to make the draw line
+ *  - characters_per_second
+ *
+ * Usage: yzis_bench_drawline [length]
+ * YZIS_BENCH_REPEATS sets how many times each line is drawn.
+ */
+
+#include <libyzis/session.h>
+#include <libyzis/view.h>
+#include <libyzis/line.h>
+#include <libyzis/drawline.h>
+#include <libyzis/internal_options.h>
+#include <libyzis/debug.h>
+
+#include "NoGuiSession.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+
+#include <stdio.h>
+#include <sys/time.h>
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* repeats pattern up to length characters */
+static QString repeated( const QString& pattern, int length )
+{
+	QString s;
+	while ( s.length() < length )
+		s += pattern;
+	s.truncate( length );
+	return s;
+}
+
+int main( int argc, char * argv[] )
+{
+	YSession::initDebug( argc, argv );
+	QCoreApplication app( argc, argv );
+	NoGuiSession::createInstance();
+
+	QStringList args = app.arguments();
+	int length = args.count() > 1 ? qMax( 1, args[ 1 ].toInt() ) : 100000;
+	QByteArray repeatsEnv = qgetenv( "YZIS_BENCH_REPEATS" );
+	int repeats = repeatsEnv.isEmpty() ? 20 : qMax( 1, repeatsEnv.toInt() );
+
+	QStringList names;
+	QList<YLine*> lines;
+	names << "code";
+	lines << new YLine( repeated( "foo = bar(baz, \"qux\"); ", length ) );
+	names << "spaces";
+	lines << new YLine( repeated( "a    b ", length ) );
+	names << "tabs";
+	lines << new YLine( repeated( "\tx\t\tyz", length ) );
+	names << "trailing_spaces";
+	lines << new YLine( "end" + QString( length - 3, ' ' ) );
+	names << "no_space";
+	lines << new YLine( QString( length, 'x' ) );
+
+	YView* view = YSession::self()->createBufferAndView();
+	YInternalOptionPool* options = YSession::self()->getOptions();
+
+	QTextStream out( stdout );
+	out << "{\n";
+	out << "  \"benchmark\": \"drawline\",\n";
+	out << "  \"length\": " << length << ", \"repeats\": " << repeats << ",\n";
+	out << "  \"lines\": [";
+
+	bool first = true;
+	for ( int list = 0; list < 2; ++list ) {
+		options->setOptionFromString( list ? "list" : "nolist", yzis::ScopeLocal, view->buffer(), view );
+		for ( int n = 0; n < lines.count(); ++n ) {
+			int cells = 0;
+			double start = now();
+			for ( int r = 0; r < repeats; ++r )
+				cells = view->drawLineFromYLine( lines[ n ] ).count();
+			double t = ( now() - start ) / repeats;
+
+			out << ( first ? "\n" : ",\n" );
+			first = false;
+			out << "    { \"name\": \"" << names[ n ] << "\""
+				<< ", \"list\": " << ( list ? "true" : "false" )
+				<< ", \"characters\": " << lines[ n ]->data().length()
+				<< ", \"cells\": " << cells
+				<< ", \"usec_per_line\": " << QString::number( t * 1e6, 'f', 1 )
+				<< ", \"characters_per_second\": " << QString::number( lines[ n ]->data().length() / qMax( t, 1e-9 ), 'f', 0 )
+				<< " }";
+			out.flush();
+		}
+	}
+	out << "\n  ]\n}\n";
+
+	foreach( YLine* l, lines )
+		delete l;
+	return 0;
+}
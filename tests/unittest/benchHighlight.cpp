@@ -0,0 +1,231 @@
+/*
+ * Highlighting throughput of every syntax definition.
+ *
+ * Each language highlights the same corpus: the files of tests/files, the
+ * files given on the command line and generated text mixing the constructs
+ * of many languages (comments, strings, numbers, long lines...). The result
+ * is printed as JSON on stdout, one entry per language:
+ *  - load_msec: time to load the definition
+ *  - lines_per_second
+ *  - allocations_per_line: heap allocations done by doHighlight (glibc only)
+ *  - worst_line_usec: highlighting time of the slowest line
+ *
+ * The results memoized by the highlighting are dropped before each
+ * repeat, so that every repeat goes through the items again.
+ *
+ * Usage: yzis_bench_highlight [-l language]... [file]...
+ * YZIS_BENCH_REPEATS sets how many times the corpus is highlighted.
+ */
+
+#include <libyzis/session.h>
+#include <libyzis/line.h>
+#include <libyzis/debug.h>
+#include <libyzis/kate/syntaxhighlight.h>
+
+#include "NoGuiSession.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+#include <stdio.h>
+#include <sys/time.h>
+
+/* number of heap allocations, counted by wrapping malloc */
+static long allocations = 0;
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc( size_t size );
+extern "C" void *__libc_calloc( size_t n, size_t size );
+extern "C" void *__libc_realloc( void *ptr, size_t size );
+
+extern "C" void *malloc( size_t size )
+{
+	++allocations;
+	return __libc_malloc( size );
+}
+
+extern "C" void *calloc( size_t n, size_t size )
+{
+	++allocations;
+	return __libc_calloc( n, size );
+}
+
+extern "C" void *realloc( void *ptr, size_t size )
+{
+	++allocations;
+	return __libc_realloc( ptr, size );
+}
+#define HAS_ALLOCATION_COUNT true
+#else
+#define HAS_ALLOCATION_COUNT false
+#endif
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static QString jsonString( const QString& s )
+{
+	QString r = s;
+	r.replace( '\\', "\\\\" ).replace( '"', "\\\"" );
+	return '"' + r + '"';
+}
+
+static void readFile( const QString& path, QStringList* lines )
+{
+	QFile f( path );
+	if ( !f.open( QIODevice::ReadOnly ) ) {
+		fprintf( stderr, "cannot read %s\n", qPrintable(path) );
+		return;
+	}
+	QTextStream stream( &f );
+	while ( !stream.atEnd() )
+		*lines << stream.readLine();
+}
+
+/*
+ * Text exercising the usual rules of the definitions, made from a fixed
+ * seed so that all the runs highlight the same lines
+ */
+static QStringList generatedCorpus()
+{
+	static const char* words[] = {
+		"if", "else", "for", "while", "return", "function", "class", "int",
+		"def", "end", "begin", "var", "let", "struct", "public", "static",
+		"foo", "bar_baz", "Qux", "x1", "self", "this", "nil", "null",
+		"42", "0x1f", "3.14e-2", "0755", "'c'", "'\\n'", "\"a \\\"string\\\"\"",
+		"(", ")", "[", "]", "{", "}", ";", ",", "=", "==", "+=", "->", "::",
+		"<", ">", "<tag attr=\"v\">", "</tag>", "&amp;", "$var", "@attr", "%hash",
+	};
+	static const char* comments[] = {
+		"// a comment", "# a comment", "-- a comment", "; a comment",
+		"/* a comment */", "<!-- a comment -->", "% a comment", "(* a comment *)",
+	};
+	const int nWords = sizeof( words ) / sizeof( words[ 0 ] );
+	const int nComments = sizeof( comments ) / sizeof( comments[ 0 ] );
+
+	QStringList lines;
+	unsigned int seed = 12345;
+	for ( int i = 0; i < 2000; ++i ) {
+		QString line( QString( ( i % 8 ) * 4, ' ' ) );
+		seed = seed * 1103515245 + 12345;
+		int n = ( seed >> 16 ) % 16;
+		for ( int j = 0; j < n; ++j ) {
+			seed = seed * 1103515245 + 12345;
+			line += words[ ( seed >> 16 ) % nWords ];
+			line += ' ';
+		}
+		if ( i % 5 == 0 )
+			line += comments[ ( i / 5 ) % nComments ];
+		lines << line;
+	}
+	/* a multiline comment and string, then a very long line */
+	lines << "/* a comment" << "   on several lines" << "*/";
+	lines << "\"\"\"a string" << "on several lines\"\"\"";
+	QString longLine;
+	for ( int i = 0; i < 500; ++i )
+		longLine += QString( "%1 = foo(%2, \"bar\"); " ).arg( words[ i % nWords ] ).arg( i );
+	lines << longLine;
+	return lines;
+}
+
+int main( int argc, char * argv[] )
+{
+	YSession::initDebug( argc, argv );
+	QCoreApplication app( argc, argv );
+	NoGuiSession::createInstance();
+
+	QStringList languages;
+	QStringList files;
+	QDir dir( YZIS_BENCH_FILES_DIR );
+	foreach( QString name, dir.entryList( QDir::Files, QDir::Name ) )
+		files << dir.filePath( name );
+	QStringList args = app.arguments();
+	for ( int i = 1; i < args.count(); ++i ) {
+		if ( args[ i ] == "-l" && i + 1 < args.count() )
+			languages << args[ ++i ];
+		else
+			files << args[ i ];
+	}
+
+	QStringList corpus;
+	foreach( QString path, files )
+		readFile( path, &corpus );
+	corpus += generatedCorpus();
+	int bytes = 0;
+	foreach( QString line, corpus )
+		bytes += line.length() + 1;
+
+	QByteArray repeatsEnv = qgetenv( "YZIS_BENCH_REPEATS" );
+	int repeats = repeatsEnv.isEmpty() ? 3 : qMax( 1, repeatsEnv.toInt() );
+
+	YzisHlManager* manager = YzisHlManager::self();
+	QTextStream out( stdout );
+	out << "{\n";
+	out << "  \"benchmark\": \"highlight\",\n";
+	out << "  \"corpus\": { \"files\": " << files.count() << ", \"lines\": " << corpus.count()
+		<< ", \"characters\": " << bytes << ", \"repeats\": " << repeats << " },\n";
+	out << "  \"languages\": [";
+
+	bool first = true;
+	/* 0 is the "None" highlighting */
+	for ( int n = 1; n < manager->highlights(); ++n ) {
+		YzisHighlighting* hl = manager->getHl( n );
+		if ( !languages.isEmpty() && !languages.contains( hl->name(), Qt::CaseInsensitive ) )
+			continue;
+
+		double start = now();
+		hl->use();
+		double loadTime = now() - start;
+
+		double total = 0;
+		double worst = 0;
+		int worstLine = 0;
+		long allocated = 0;
+		for ( int r = 0; r < repeats; ++r ) {
+			QVector<YLine*> lines( corpus.count() );
+			for ( int i = 0; i < corpus.count(); ++i )
+				lines[ i ] = new YLine( corpus[ i ] );
+			YLine empty;
+			hl->clearLineMemo();
+			for ( int i = 0; i < lines.count(); ++i ) {
+				QVector<uint> foldingList;
+				long allocationsBefore = allocations;
+				double t = now();
+				hl->doHighlight( i > 0 ? lines[ i - 1 ] : &empty, lines[ i ], &foldingList, NULL );
+				t = now() - t;
+				allocated += allocations - allocationsBefore;
+				total += t;
+				if ( t > worst ) {
+					worst = t;
+					worstLine = i;
+				}
+			}
+			foreach( YLine* l, lines )
+				delete l;
+		}
+		hl->release();
+
+		int highlighted = corpus.count() * repeats;
+		out << ( first ? "\n" : ",\n" );
+		first = false;
+		out << "    { \"name\": " << jsonString( hl->name() )
+			<< ", \"load_msec\": " << QString::number( loadTime * 1000, 'f', 3 )
+			<< ", \"lines_per_second\": " << QString::number( highlighted / qMax( total, 1e-9 ), 'f', 0 );
+		if ( HAS_ALLOCATION_COUNT )
+			out << ", \"allocations_per_line\": " << QString::number( double( allocated ) / highlighted, 'f', 2 );
+		else
+			out << ", \"allocations_per_line\": null";
+		out << ", \"worst_line_usec\": " << QString::number( worst * 1e6, 'f', 1 )
+			<< ", \"worst_line\": " << worstLine << " }";
+		out.flush();
+	}
+	out << "\n  ]\n}\n";
+	return 0;
+}
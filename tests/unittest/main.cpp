@@ -5,6 +5,7 @@
 #include "testBufferChanges.h"
 #include "testDrawCell.h"
 #include "testDrawBuffer.h"
+#include "testRegExp.h"
 
 #include <QRegExp>
 
@@ -93,6 +94,7 @@ int main( int argc, char * argv[] )
     //RUN_MY_TEST( TestBufferChanges )
 	RUN_MY_TEST( TestDrawCell )
 	RUN_MY_TEST( TestDrawBuffer )
+	RUN_MY_TEST( TestRegExp )
 
     printf("Unittest status: %d failed tests\n", result );
 
@@ -23,5 +23,18 @@ void TestDrawCell::testDrawCell()
 	QCOMPARE(c2.stepsShift(), 3);
 }
 
+void TestDrawCell::testStepChars()
+{
+	YDrawCell cell;
+	QCOMPARE(cell.stepChars("hello"), 5);
+	cell.step("    ");
+	QCOMPARE(cell.stepChars("world"), 5);
+	QCOMPARE(cell.content(), QString("hello    world"));
+	QCOMPARE(cell.width(), 14);
+	QCOMPARE(cell.length(), 11);
+	QCOMPARE(cell.widthForLength(7), 10);
+	QCOMPARE(cell.lengthForWidth(10), 7);
+}
+
 #include "testDrawCell.moc"
 
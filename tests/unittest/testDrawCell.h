@@ -9,6 +9,7 @@ class TestDrawCell : public QObject
 
 private slots:
 	void testDrawCell();
+	void testStepChars();
 
 };
 
@@ -0,0 +1,161 @@
+#include "testRegExp.h"
+
+#include <libyzis/regexp.h>
+#include <libyzis/vimregexp.h>
+
+void TestRegExp::testEngineSelection()
+{
+	QCOMPARE(YRegExp("a(b|c)*d").engine(), YRegExp::LinearEngine);
+	QCOMPARE(YRegExp("[a-z]+\\d{2,3}$").engine(), YRegExp::LinearEngine);
+	QCOMPARE(YRegExp("a(b|c)*d", Qt::CaseSensitive, YRegExp::QtEngine).engine(), YRegExp::QtEngine);
+	/* back references and lookaheads fall back to QRegExp */
+	QCOMPARE(YRegExp("(a)\\1").engine(), YRegExp::QtEngine);
+	QCOMPARE(YRegExp("a(?=b)").engine(), YRegExp::QtEngine);
+}
+
+void TestRegExp::testSameAsQRegExp_data()
+{
+	QTest::addColumn<QString>("pattern");
+	QTest::addColumn<QString>("subject");
+	QTest::addColumn<bool>("insensitive");
+	QTest::addColumn<bool>("minimal");
+
+	QTest::newRow("literal") << "abc" << "xxabcxx" << false << false;
+	QTest::newRow("alternation") << "a|ab" << "xab" << false << false;
+	QTest::newRow("star") << "b*" << "abbbc" << false << false;
+	QTest::newRow("plus") << "b+" << "abbbc" << false << false;
+	QTest::newRow("caret") << "^b" << "abc" << false << false;
+	QTest::newRow("dollar") << "c$" << "abcc" << false << false;
+	QTest::newRow("class") << "[a-c]+" << "xxcabz" << false << false;
+	QTest::newRow("negated class") << "[^a-c]+" << "abcxyz" << false << false;
+	QTest::newRow("digits") << "\\d+" << "ab123c" << false << false;
+	QTest::newRow("word boundary") << "\\bfoo\\b" << "afoo foo" << false << false;
+	QTest::newRow("counted") << "x{2,3}" << "axxxxb" << false << false;
+	QTest::newRow("insensitive") << "ABC" << "xaBc" << true << false;
+	QTest::newRow("greedy") << "a.*c" << "abcabc" << false << false;
+	QTest::newRow("minimal") << "a.*c" << "abcabc" << false << true;
+	QTest::newRow("group") << "(foo|bar)baz" << "xbarbaz" << false << false;
+	QTest::newRow("escaped") << "a\\.b" << "axb a.b" << false << false;
+	QTest::newRow("no match") << "xyz" << "abc" << false << false;
+}
+
+void TestRegExp::testSameAsQRegExp()
+{
+	QFETCH(QString, pattern);
+	QFETCH(QString, subject);
+	QFETCH(bool, insensitive);
+	QFETCH(bool, minimal);
+
+	Qt::CaseSensitivity cs = insensitive ? Qt::CaseInsensitive : Qt::CaseSensitive;
+	YRegExp linear(pattern, cs, YRegExp::LinearEngine);
+	linear.setMinimal(minimal);
+	QRegExp qt(pattern, cs);
+	qt.setMinimal(minimal);
+
+	QCOMPARE(linear.engine(), YRegExp::LinearEngine);
+	QCOMPARE(linear.indexIn(subject), qt.indexIn(subject));
+	QCOMPARE(linear.matchedLength(), qt.matchedLength());
+	QCOMPARE(linear.capturedTexts(), qt.capturedTexts());
+}
+
+void TestRegExp::testLastIndexIn()
+{
+	YRegExp rx("ab*");
+	QCOMPARE(rx.lastIndexIn("abbxab"), 4);
+	QCOMPARE(rx.matchedLength(), 2);
+	QCOMPARE(rx.lastIndexIn("abbxab", 3), 0);
+	QCOMPARE(rx.matchedLength(), 3);
+	QCOMPARE(rx.lastIndexIn("xxx"), -1);
+}
+
+void TestRegExp::testCaptures()
+{
+	YRegExp rx("(a+)(b*)(c+)");
+	QCOMPARE(rx.numCaptures(), 3);
+	QCOMPARE(rx.indexIn("   aabbcc  "), 3);
+	QCOMPARE(rx.cap(0), QString("aabbcc"));
+	QCOMPARE(rx.cap(1), QString("aa"));
+	QCOMPARE(rx.cap(2), QString("bb"));
+	QCOMPARE(rx.cap(3), QString("cc"));
+	QCOMPARE(rx.pos(3), 7);
+	QCOMPARE(rx.cap(4), QString());
+
+	YRegExp opt("(x)?y");
+	QCOMPARE(opt.indexIn("y"), 0);
+	QCOMPARE(opt.pos(1), -1);
+}
+
+void TestRegExp::testReplace()
+{
+	YRegExp rx("(aaa) (bbb) (ccc)");
+	QCOMPARE(rx.replace("aaa bbb ccc", "\\3 \\2 \\1"), QString("ccc bbb aaa"));
+	YRegExp o("o");
+	QCOMPARE(o.replace("foo bor", "0"), QString("f00 b0r"));
+}
+
+void TestRegExp::testLinearTime()
+{
+	/* exponential for a backtracking engine */
+	YRegExp rx("(a*)*b");
+	QCOMPARE(rx.engine(), YRegExp::LinearEngine);
+	QString subject(100000, QChar('a'));
+	QTime t;
+	t.start();
+	QCOMPARE(rx.indexIn(subject), -1);
+	QVERIFY(t.elapsed() < 5000);
+}
+
+void TestRegExp::testVimSyntax()
+{
+	YRegExp word("\\<bar\\>", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(word.engine(), YRegExp::LinearEngine);
+	QCOMPARE(word.indexIn("foobar bar"), 7);
+
+	YRegExp magic("a\\(b\\|c\\)\\{2}d\\c", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(magic.indexIn("xxABCD"), 2);
+	QCOMPARE(magic.cap(1), QString("C"));
+
+	YRegExp veryMagic("\\v(a|b)+$", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(veryMagic.indexIn("a+b abba"), 4);
+
+	/* ^ and $ are literal inside the pattern */
+	YRegExp anchors("a^b$c", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(anchors.indexIn("xa^b$c"), 1);
+
+	/* back references go through QRegExp */
+	YRegExp backref("\\(a\\)\\1", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(backref.engine(), YRegExp::QtEngine);
+	QCOMPARE(backref.indexIn("xaa"), 1);
+
+	/* \zs and \ze move the bounds of the match */
+	YRegExp bounds("foo\\zsbar\\zebaz", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(bounds.indexIn("xfoobarbaz"), 4);
+	QCOMPARE(bounds.matchedLength(), 3);
+	QCOMPARE(bounds.indexIn("xfoobarbax"), -1);
+
+	/* only the \{-} repetition is non greedy, the first alternative wins */
+	YRegExp lazy("\\(a.\\{-}b\\).*", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(lazy.indexIn("xa1b2b3"), 1);
+	QCOMPARE(lazy.matchedLength(), 6);
+	QCOMPARE(lazy.cap(1), QString("a1b"));
+	YRegExp alternatives("a\\|ab", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(alternatives.indexIn("ab"), 0);
+	QCOMPARE(alternatives.matchedLength(), 1);
+
+	/* ~ is the last substitute string */
+	YVimRegExp::setLastSubstitute("xy");
+	YRegExp tilde("a~b", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QCOMPARE(tilde.indexIn("zaxyb"), 1);
+	YVimRegExp::setLastSubstitute(QString());
+
+	/* the errors are the Vim ones */
+	YRegExp unmatched("a\\(b", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax);
+	QVERIFY(!unmatched.isValid());
+	QCOMPARE(unmatched.errorString(), QString("E54: Unmatched \\("));
+	QString error;
+	QCOMPARE(YVimRegExp::compile("a**", Qt::CaseSensitive, false, YRegExp::AutoEngine, &error), (YRegExpEngine*)NULL);
+	QCOMPARE(error, QString("E62: Nested *"));
+	QVERIFY(YRegExp("a\\zsb", Qt::CaseSensitive, YRegExp::AutoEngine, YRegExp::VimSyntax).errorString().isEmpty());
+}
+
+#include "testRegExp.moc"
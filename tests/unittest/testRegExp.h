@@ -0,0 +1,23 @@
+#ifndef TEST_REGEXP_H
+#define TEST_REGEXP_H
+
+#include <QtTest/QtTest>
+
+class TestRegExp : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void testEngineSelection();
+	void testSameAsQRegExp_data();
+	void testSameAsQRegExp();
+	void testLastIndexIn();
+	void testCaptures();
+	void testReplace();
+	void testLinearTime();
+	void testVimSyntax();
+
+};
+
+#endif // TEST_REGEXP_H
+